@@ -0,0 +1,127 @@
+/*
+ * benchcontext.cpp
+ *
+ * Offscreen OpenGL context for the imgx benchmark.
+ */
+
+#include "benchcontext.h"
+#include "imggl.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstdio>
+
+/// \file
+/// This file contains the definition of the BenchContext class
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+static std::string eglErrorString(const char *call) {
+    char text[64];
+    snprintf(text, sizeof(text), "%s failed (0x%x)", call, eglGetError());
+    return text;
+}
+
+static EGLDisplay openDisplay() {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay != nullptr) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                                EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+            return display;
+    }
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+        return display;
+    return EGL_NO_DISPLAY;
+}
+
+BenchContext::~BenchContext() {
+    destroy();
+}
+
+bool BenchContext::Create(int width, int height, std::string &outError) {
+    destroy();
+
+    EGLDisplay display = openDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        outError = eglErrorString("eglInitialize");
+        return false;
+    }
+    mDisplay = display;
+
+    // ImgWindow needs desktop OpenGL with the compatibility profile, which
+    // EGL creates when no profile is requested
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        outError = eglErrorString("eglBindAPI");
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+            configCount == 0) {
+        outError = eglErrorString("eglChooseConfig");
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = {
+        EGL_WIDTH, width,
+        EGL_HEIGHT, height,
+        EGL_NONE
+    };
+    mSurface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (mSurface == EGL_NO_SURFACE) {
+        outError = eglErrorString("eglCreatePbufferSurface");
+        return false;
+    }
+
+    mContext = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (mContext == EGL_NO_CONTEXT) {
+        outError = eglErrorString("eglCreateContext");
+        return false;
+    }
+
+    if (!eglMakeCurrent(display, mSurface, mSurface, mContext)) {
+        outError = eglErrorString("eglMakeCurrent");
+        return false;
+    }
+    return true;
+}
+
+std::string BenchContext::GetVersion() {
+    auto version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    return version != nullptr ? version : "";
+}
+
+std::string BenchContext::GetRenderer() {
+    auto renderer = reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+    return renderer != nullptr ? renderer : "";
+}
+
+void BenchContext::destroy() {
+    if (mDisplay == nullptr)
+        return;
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (mContext != nullptr)
+        eglDestroyContext(mDisplay, mContext);
+    if (mSurface != nullptr)
+        eglDestroySurface(mDisplay, mSurface);
+    eglTerminate(mDisplay);
+    mDisplay = nullptr;
+    mSurface = nullptr;
+    mContext = nullptr;
+}
@@ -0,0 +1,53 @@
+/*
+ * benchcontext.h
+ *
+ * Offscreen OpenGL context for the imgx benchmark.
+ */
+
+#ifndef BENCHCONTEXT_H
+#define BENCHCONTEXT_H
+
+#include <string>
+
+/// \file
+/// This file contains the declaration of the BenchContext class
+/// \brief BenchContext creates an OpenGL compatibility context rendering
+/// into an offscreen pbuffer, the stand-in for the X-Plane window.
+///
+/// The context is created through EGL. The Mesa surfaceless platform is
+/// tried first, it needs neither an X server nor a GPU and renders with
+/// llvmpipe in software. Otherwise the default EGL display is used, which
+/// benchmarks the installed driver.
+class BenchContext {
+public:
+    BenchContext() = default;
+    ~BenchContext();
+
+    BenchContext(const BenchContext &) = delete;
+    BenchContext &operator=(const BenchContext &) = delete;
+
+    /// Creates the context and makes it current
+    /// \param width pbuffer width
+    /// \param height pbuffer height
+    /// \param outError reason of a failure
+    /// \return false if no context could be created
+    bool Create(int width, int height, std::string &outError);
+
+    /// Returns the OpenGL version string of the current context
+    /// \return GL_VERSION
+    static std::string GetVersion();
+
+    /// Returns the OpenGL renderer string of the current context
+    /// \return GL_RENDERER
+    static std::string GetRenderer();
+
+private:
+    void destroy();
+
+    /// EGLDisplay, EGLSurface and EGLContext
+    void *mDisplay = nullptr;
+    void *mSurface = nullptr;
+    void *mContext = nullptr;
+};
+
+#endif //BENCHCONTEXT_H
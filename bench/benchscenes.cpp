@@ -0,0 +1,306 @@
+/*
+ * benchscenes.cpp
+ *
+ * Widget scenes drawn by the imgx benchmark.
+ */
+
+#include "benchscenes.h"
+#include "imgiconregistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+/// \file
+/// This file contains the definition of the BenchWindow class
+
+static const int gTextLines = 60;
+static const int gTableRows = 40;
+static const int gPlotSamples = 120;
+static const int gToolbarIcons = 40;
+static const int gIconSize = 16;
+static int gIcons[gToolbarIcons];
+static const uint32_t gLargeTableRows = 1000000;
+static const int gLargeTableFrames = 120;
+
+// rows shared by all windows of the LargeTable scene, the same on every run
+static std::shared_ptr<const ImgTableData> largeTableData() {
+    static std::shared_ptr<const ImgTableData> shared;
+    if (shared)
+        return shared;
+
+    static const char *airlines[] = {"DLH", "BAW", "AFR", "UAL", "DAL", "KLM", "SWR", "EZY"};
+    static const char *types[] = {"A320", "A321", "B738", "B77W", "A359", "E190", "CRJ9", "B789"};
+    std::shared_ptr<ImgTableData> data(new ImgTableData());
+    int callsign = data->AddTextColumn("Callsign");
+    int type = data->AddTextColumn("Type");
+    int altitude = data->AddNumberColumn("Altitude", "%.0f");
+    int speed = data->AddNumberColumn("Speed", "%.0f");
+    int distance = data->AddNumberColumn("Distance", "%.1f");
+    data->Reserve(gLargeTableRows, gLargeTableRows * 8);
+    uint32_t seed = 1;
+    char text[16];
+    for (uint32_t i = 0; i < gLargeTableRows; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t row = data->AddRow();
+        snprintf(text, sizeof(text), "%s%u", airlines[seed >> 29], (seed >> 8) % 10000);
+        data->SetText(callsign, text);
+        data->SetText(type, types[(seed >> 4) & 7]);
+        data->SetNumber(row, altitude, (seed >> 12) % 410 * 100.0);
+        data->SetNumber(row, speed, 120 + (seed >> 3) % 380);
+        data->SetNumber(row, distance, (seed >> 6) % 40000 / 10.0);
+    }
+    shared = std::move(data);
+    return shared;
+}
+
+BenchWindow::BenchWindow(Scene scene, int left, int top, int width,
+                         int height) : mScene(scene) {
+    if (scene == Instruments)
+        mInstruments.reset(new InstrumentBindings());
+    if (scene == LargeTable) {
+        mLargeTable.reset(new ImgTable());
+        mLargeTable->SetData(largeTableData());
+    }
+    Init(width, height, left, top);
+    SetWindowTitle(GetSceneName(scene));
+    SetVisible(true);
+}
+
+const char *BenchWindow::GetSceneName(Scene scene) {
+    switch (scene) {
+    case Widgets:
+        return "widgets";
+    case Text:
+        return "text";
+    case Plots:
+        return "plots";
+    case Table:
+        return "table";
+    case Tree:
+        return "tree";
+    case Instruments:
+        return "instruments";
+    case Toolbar:
+        return "toolbar";
+    case LargeTable:
+        return "large_table";
+    default:
+        return "";
+    }
+}
+
+bool BenchWindow::FindScene(const std::string &name, Scene &outScene) {
+    for (int s = 0; s < SceneCount; s++) {
+        if (name == GetSceneName(static_cast<Scene>(s))) {
+            outScene = static_cast<Scene>(s);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BenchWindow::RegisterIcons() {
+    // simple shapes standing in for an icon set, a ring, a box and a
+    // diamond with a varying stroke
+    unsigned char alpha[gIconSize * gIconSize];
+    char name[16];
+    for (int i = 0; i < gToolbarIcons; i++) {
+        float stroke = 1.0f + i / 3 % 4;
+        for (int y = 0; y < gIconSize; y++) {
+            for (int x = 0; x < gIconSize; x++) {
+                float dx = std::fabs(x + 0.5f - gIconSize / 2.0f);
+                float dy = std::fabs(y + 0.5f - gIconSize / 2.0f);
+                float distance;
+                if (i % 3 == 0)
+                    distance = std::sqrt(dx * dx + dy * dy);
+                else if (i % 3 == 1)
+                    distance = std::max(dx, dy);
+                else
+                    distance = (dx + dy) * 0.75f;
+                float edge = std::fabs(distance - gIconSize / 2.0f + stroke + 1.0f);
+                alpha[y * gIconSize + x] = edge < stroke ? 255 : 0;
+            }
+        }
+        snprintf(name, sizeof(name), "icon%d", i);
+        gIcons[i] = ImgIconRegistry::Get().AddIcon(name, gIconSize, gIconSize, alpha);
+    }
+}
+
+void BenchWindow::ConfigureImGuiContext() {
+    // runs must not depend on window state saved by an earlier run
+    ImGui::GetIO().IniFilename = nullptr;
+}
+
+void BenchWindow::BuildInterface() {
+    switch (mScene) {
+    case Widgets:
+        buildWidgets();
+        break;
+    case Text:
+        buildText();
+        break;
+    case Plots:
+        buildPlots();
+        break;
+    case Table:
+        buildTable();
+        break;
+    case Tree:
+        buildTree();
+        break;
+    case Instruments:
+        buildInstruments();
+        break;
+    case Toolbar:
+        buildToolbar();
+        break;
+    case LargeTable:
+        buildLargeTable();
+        break;
+    default:
+        break;
+    }
+    mFrame++;
+}
+
+void BenchWindow::buildWidgets() {
+    ImGui::Text("Frame %d", mFrame);
+    if (ImGui::Button("Increment"))
+        mCounter++;
+    ImGui::SameLine();
+    ImGui::Text("Counter: %d", mCounter);
+    for (int i = 0; i < 8; i++) {
+        ImGui::PushID(i);
+        ImGui::Checkbox("##check", &mChecks[i]);
+        ImGui::SameLine();
+        // sliders follow the sim like gauges
+        mSliders[i] = 0.5f + 0.5f * std::sin(0.02f * (mFrame + 10 * i));
+        ImGui::SliderFloat("Value", &mSliders[i], 0.0f, 1.0f);
+        ImGui::PopID();
+    }
+    ImGui::InputText("Airport", mInput, sizeof(mInput));
+    ImGui::ProgressBar(mSliders[0]);
+}
+
+void BenchWindow::buildText() {
+    for (int i = 0; i < gTextLines; i++) {
+        ImGui::Text("%02d  ALT %5.0f ft  IAS %3.0f kt  HDG %03d", i,
+                    5000.0f + 10.0f * (mFrame + i), 250.0f - 0.1f * i,
+                    (mFrame + 7 * i) % 360);
+    }
+}
+
+void BenchWindow::buildPlots() {
+    float samples[gPlotSamples];
+    for (int i = 0; i < gPlotSamples; i++)
+        samples[i] = std::sin(0.1f * (mFrame + i)) + 0.3f * std::sin(0.7f * i);
+    ImGui::PlotLines("Pitch", samples, gPlotSamples, 0, nullptr, -1.5f, 1.5f,
+                     ImVec2(0, 80));
+    ImGui::PlotHistogram("Load", samples, gPlotSamples, 0, nullptr, -1.5f,
+                         1.5f, ImVec2(0, 80));
+    for (int i = 0; i < gPlotSamples; i++)
+        samples[i] = std::cos(0.05f * (mFrame + 2 * i));
+    ImGui::PlotLines("Roll", samples, gPlotSamples, 0, nullptr, -1.0f, 1.0f,
+                     ImVec2(0, 80));
+}
+
+void BenchWindow::buildTable() {
+    ImGui::Columns(4, "table");
+    ImGui::Separator();
+    ImGui::Text("Fix");
+    ImGui::NextColumn();
+    ImGui::Text("Distance");
+    ImGui::NextColumn();
+    ImGui::Text("Course");
+    ImGui::NextColumn();
+    ImGui::Text("ETA");
+    ImGui::NextColumn();
+    ImGui::Separator();
+    char label[16];
+    for (int row = 0; row < gTableRows; row++) {
+        snprintf(label, sizeof(label), "WPT%02d", row);
+        if (ImGui::Selectable(label, mSelectedRow == row,
+                              ImGuiSelectableFlags_SpanAllColumns))
+            mSelectedRow = row;
+        ImGui::NextColumn();
+        ImGui::Text("%.1f nm", 12.5f * row + 0.01f * mFrame);
+        ImGui::NextColumn();
+        ImGui::Text("%03d", (row * 37) % 360);
+        ImGui::NextColumn();
+        ImGui::Text("%02d:%02d", (row + mFrame / 3600) % 24, (row * 7) % 60);
+        ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void BenchWindow::buildTree() {
+    for (int i = 0; i < 6; i++) {
+        ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+        if (ImGui::TreeNode(reinterpret_cast<void *>(static_cast<intptr_t>(i)),
+                            "System %d", i)) {
+            for (int j = 0; j < 4; j++) {
+                ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+                if (ImGui::TreeNode(reinterpret_cast<void *>(static_cast<intptr_t>(j)),
+                                    "Unit %d", j)) {
+                    ImGui::BulletText("Status %s", (mFrame / 60 + i + j) % 5 ? "OK" : "FAULT");
+                    ImGui::BulletText("Temperature %.1f C",
+                                      40.0f + 5.0f * std::sin(0.01f * mFrame + j));
+                    ImGui::TreePop();
+                }
+            }
+            ImGui::TreePop();
+        }
+    }
+}
+
+void BenchWindow::buildInstruments() {
+    ImgWidgets::Value("Altitude", mInstruments->altitude, "%.0f");
+    ImgWidgets::Value("Airspeed", mInstruments->airspeed, "%.0f");
+    ImgWidgets::Value("Heading", mInstruments->heading, "%.0f");
+    ImgWidgets::Checkbox("Beacon", mInstruments->beacon);
+    char label[16];
+    for (int i = 0; i < mInstruments->throttles.GetCount(); i++) {
+        snprintf(label, sizeof(label), "Throttle %d", i + 1);
+        ImgWidgets::SliderFloat(label, mInstruments->throttles, i, 0.0f, 1.0f);
+    }
+    // an autothrottle moving the levers like a slider drag, several sets
+    // per frame end up in one write
+    for (int step = 0; step < 4; step++)
+        mInstruments->throttles.Set(0, 0.5f + 0.4f * std::sin(0.02f * mFrame + 0.1f * step));
+}
+
+void BenchWindow::buildToolbar() {
+    ImgIconRegistry &icons = ImgIconRegistry::Get();
+    char label[32];
+    for (int i = 0; i < gToolbarIcons; i++) {
+        if (i % 10 != 0)
+            ImGui::SameLine();
+        // icons and text come from the same texture and batch together
+        snprintf(label, sizeof(label), "%s##%d", icons.GetText(gIcons[i]), i);
+        ImGui::Button(label);
+    }
+    for (int row = 0; row < 8; row++) {
+        for (int i = 0; i < gToolbarIcons / 4; i++) {
+            if (i > 0)
+                ImGui::SameLine();
+            icons.Image(gIcons[(row * 7 + i + mFrame / 30) % gToolbarIcons]);
+        }
+        ImGui::SameLine();
+        ImGui::Text("Row %d  %5.1f", row, 0.1f * (mFrame + row));
+    }
+}
+
+void BenchWindow::buildLargeTable() {
+    // a user narrowing the filter one character at a time and then
+    // sorting by another column
+    static const char *filters[] = {"", "d", "dl", "dlh", "dlh1", "dlh12", "a3", ""};
+    const int steps = sizeof(filters) / sizeof(filters[0]);
+    if (mFrame % gLargeTableFrames == 0) {
+        int step = mFrame / gLargeTableFrames;
+        mLargeTable->SetFilter(filters[step % steps]);
+        mLargeTable->SetSort(step / steps % 5, step % 2 == 0);
+    }
+    mLargeTable->Draw("flights");
+}
@@ -0,0 +1,115 @@
+/*
+ * benchscenes.h
+ *
+ * Widget scenes drawn by the imgx benchmark.
+ */
+
+#ifndef BENCHSCENES_H
+#define BENCHSCENES_H
+
+#include "imgdataref.h"
+#include "imgtable.h"
+#include "imgwindow.h"
+
+#include <memory>
+
+/// \file
+/// This file contains the declaration of the BenchWindow class
+/// \brief BenchWindow is an ImgWindow showing one of a few typical plugin
+/// interfaces. The values shown change every frame like live sim data, so
+/// every built frame produces new vertices.
+class BenchWindow : public ImgWindow {
+public:
+    /// Interface drawn by a window
+    enum Scene {
+        /// buttons, checkboxes, sliders and input fields
+        Widgets,
+        /// long list of formatted text lines
+        Text,
+        /// line plots and histograms
+        Plots,
+        /// multi-column table with selectable rows
+        Table,
+        /// nested tree nodes
+        Tree,
+        /// aircraft datarefs through ImgDataRef bindings
+        Instruments,
+        /// buttons and rows of icons from the font atlas
+        Toolbar,
+        /// a million rows in an ImgTable, filtered and sorted in the
+        /// background, not part of the default scenes
+        LargeTable,
+        SceneCount
+    };
+
+    /// Creates a visible window
+    /// \param scene interface to draw
+    /// \param left left edge in boxels
+    /// \param top top edge in boxels
+    /// \param width width in boxels
+    /// \param height height in boxels
+    BenchWindow(Scene scene, int left, int top, int width, int height);
+
+    /// Returns the name of a scene used on the command line
+    /// \param scene scene
+    /// \return scene name
+    static const char *GetSceneName(Scene scene);
+
+    /// Looks up a scene by name
+    /// \param name scene name
+    /// \param outScene scene with that name
+    /// \return false if there is no such scene
+    static bool FindScene(const std::string &name, Scene &outScene);
+
+    /// Registers the icons of the Toolbar scene, must be called before the
+    /// first window is created
+    static void RegisterIcons();
+
+protected:
+    void ConfigureImGuiContext() override;
+
+    void BuildInterface() override;
+
+private:
+    void buildWidgets();
+
+    void buildText();
+
+    void buildPlots();
+
+    void buildTable();
+
+    void buildTree();
+
+    void buildInstruments();
+
+    void buildToolbar();
+
+    void buildLargeTable();
+
+    Scene mScene;
+    /// frames built so far, drives the displayed values
+    int mFrame = 0;
+
+    /// widget state of the Widgets scene
+    bool mChecks[8] = {};
+    float mSliders[8] = {};
+    int mCounter = 0;
+    char mInput[64] = "KSEA";
+    int mSelectedRow = -1;
+
+    /// dataref bindings of the Instruments scene
+    struct InstrumentBindings {
+        ImgDataRef<float> altitude{"sim/cockpit2/gauges/indicators/altitude_ft_pilot"};
+        ImgDataRef<float> airspeed{"sim/cockpit2/gauges/indicators/airspeed_kts_pilot"};
+        ImgDataRef<float> heading{"sim/cockpit2/gauges/indicators/heading_AHARS_deg_mag_pilot"};
+        ImgDataRefArray<float> throttles{"sim/cockpit2/engine/actuators/throttle_ratio", 8};
+        ImgDataRef<int> beacon{"sim/cockpit/electrical/beacon_lights_on"};
+    };
+    std::unique_ptr<InstrumentBindings> mInstruments;
+
+    /// table of the LargeTable scene
+    std::unique_ptr<ImgTable> mLargeTable;
+};
+
+#endif //BENCHSCENES_H
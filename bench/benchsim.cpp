@@ -0,0 +1,666 @@
+/*
+ * benchsim.cpp
+ *
+ * Stand-in for the X-Plane plugin SDK used by the imgx benchmark.
+ */
+
+#include "XPLMDataAccess.h"
+#include "XPLMDisplay.h"
+#include "XPLMGraphics.h"
+#include "XPLMProcessing.h"
+#include "XPLMUtilities.h"
+
+#include "benchsim.h"
+#include "imggl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \file
+/// This file contains the definition of the BenchSim class and of the XPLM
+/// functions imgx calls
+
+// sim clock rate, one frame per tick
+static const float gFrameRate = 60.0f;
+
+struct SimWindow {
+    XPLMCreateWindow_t params;
+    int left, top, right, bottom;
+    bool visible;
+    // destroyed windows are removed once no frame is running
+    bool destroyed;
+};
+
+struct SimFlightLoop {
+    XPLMCreateFlightLoop_t params;
+    bool scheduled;
+    // > 0 - call at sim time, otherwise call at cycle
+    float dueTime;
+    int dueCycle;
+    float lastCallTime;
+    int counter;
+    bool destroyed;
+};
+
+struct SimDataRef {
+    std::string name;
+    XPLMDataTypeID type;
+    bool writable;
+    XPLMGetDatai_f readInt;
+    XPLMGetDataf_f readFloat;
+    XPLMGetDatad_f readDouble;
+    XPLMGetDatavi_f readIntArray;
+    XPLMGetDatavf_f readFloatArray;
+    XPLMGetDatab_f readData;
+    XPLMSetDatai_f writeInt;
+    XPLMSetDataf_f writeFloat;
+    XPLMSetDatad_f writeDouble;
+    XPLMSetDatavi_f writeIntArray;
+    XPLMSetDatavf_f writeFloatArray;
+    void *refcon;
+    void *writeRefcon;
+};
+
+static std::vector<std::unique_ptr<SimWindow>> gWindows;
+static std::vector<std::unique_ptr<SimFlightLoop>> gFlightLoops;
+static std::vector<std::unique_ptr<SimDataRef>> gDataRefs;
+
+static int gCycle = 0;
+static bool gInFrame = false;
+static int gScreenWidth = 1920, gScreenHeight = 1080;
+static int gMouseX = -1, gMouseY = -1;
+static XPLMWindowID gKeyboardFocus = nullptr;
+// window receiving the drag and release of the pressed mouse button
+static SimWindow *gMouseCapture = nullptr;
+
+// scene data of the boxel projection
+static float gModelViewMatrix[16];
+static float gProjectionMatrix[16];
+
+// aircraft state shown by the instruments scene, the throttles and the
+// beacon switch are writable
+static float gAltitude = 0.0f, gAirspeed = 0.0f, gHeading = 0.0f;
+static float gThrottles[8] = {};
+static int gBeacon = 0;
+
+static SimWindow *simWindow(XPLMWindowID inWindowID) {
+    return static_cast<SimWindow *>(inWindowID);
+}
+
+static float simTime() {
+    return static_cast<float>(gCycle) / gFrameRate;
+}
+
+static void purgeDestroyed() {
+    gWindows.erase(std::remove_if(gWindows.begin(), gWindows.end(),
+                                  [](const std::unique_ptr<SimWindow> &w) {
+                                      return w->destroyed;
+                                  }),
+                   gWindows.end());
+    gFlightLoops.erase(std::remove_if(gFlightLoops.begin(), gFlightLoops.end(),
+                                      [](const std::unique_ptr<SimFlightLoop> &l) {
+                                          return l->destroyed;
+                                      }),
+                       gFlightLoops.end());
+}
+
+static void updateMatrices() {
+    // glOrtho(0, width, 0, height, -1, 1), column-major
+    std::fill(gModelViewMatrix, gModelViewMatrix + 16, 0.0f);
+    std::fill(gProjectionMatrix, gProjectionMatrix + 16, 0.0f);
+    gModelViewMatrix[0] = gModelViewMatrix[5] = 1.0f;
+    gModelViewMatrix[10] = gModelViewMatrix[15] = 1.0f;
+    gProjectionMatrix[0] = 2.0f / static_cast<float>(gScreenWidth);
+    gProjectionMatrix[5] = 2.0f / static_cast<float>(gScreenHeight);
+    gProjectionMatrix[10] = -1.0f;
+    gProjectionMatrix[12] = -1.0f;
+    gProjectionMatrix[13] = -1.0f;
+    gProjectionMatrix[15] = 1.0f;
+}
+
+static int readMatrix(void *inRefcon, float *outValues, int inOffset,
+                      int inMax) {
+    auto matrix = static_cast<const float *>(inRefcon);
+    if (outValues == nullptr)
+        return 16;
+    int count = 0;
+    for (int i = inOffset; i < 16 && count < inMax; i++)
+        outValues[count++] = matrix[i];
+    return count;
+}
+
+static int readViewport(void *inRefcon, int *outValues, int inOffset,
+                        int inMax) {
+    const int viewport[4] = {0, 0, gScreenWidth, gScreenHeight};
+    if (outValues == nullptr)
+        return 4;
+    int count = 0;
+    for (int i = inOffset; i < 4 && count < inMax; i++)
+        outValues[count++] = viewport[i];
+    return count;
+}
+
+static int readZero(void *inRefcon) {
+    return 0;
+}
+
+static float readFloat(void *inRefcon) {
+    return *static_cast<const float *>(inRefcon);
+}
+
+static int readInt(void *inRefcon) {
+    return *static_cast<const int *>(inRefcon);
+}
+
+static void writeInt(void *inRefcon, int inValue) {
+    *static_cast<int *>(inRefcon) = inValue;
+}
+
+static int readThrottles(void *inRefcon, float *outValues, int inOffset,
+                         int inMax) {
+    if (outValues == nullptr)
+        return 8;
+    int count = 0;
+    for (int i = inOffset; i < 8 && count < inMax; i++)
+        outValues[count++] = gThrottles[i];
+    return count;
+}
+
+static void writeThrottles(void *inRefcon, float *inValues, int inOffset,
+                           int inCount) {
+    for (int i = 0; i < inCount && inOffset + i < 8; i++)
+        gThrottles[inOffset + i] = inValues[i];
+}
+
+static void updateAircraft() {
+    float time = simTime();
+    gAltitude = 5000.0f + 1000.0f * std::sin(0.05f * time);
+    gAirspeed = 250.0f + 20.0f * std::sin(0.3f * time);
+    gHeading = std::fmod(10.0f * time, 360.0f);
+}
+
+static SimDataRef *addDataRef(const char *inName, XPLMDataTypeID inType,
+                              void *inRefcon) {
+    std::unique_ptr<SimDataRef> ref(new SimDataRef());
+    ref->name = inName;
+    ref->type = inType;
+    ref->refcon = inRefcon;
+    ref->writeRefcon = inRefcon;
+    gDataRefs.push_back(std::move(ref));
+    return gDataRefs.back().get();
+}
+
+static void registerSceneDataRefs() {
+    if (!gDataRefs.empty())
+        return;
+    updateMatrices();
+    addDataRef("sim/graphics/view/modelview_matrix", xplmType_FloatArray,
+               gModelViewMatrix)->readFloatArray = readMatrix;
+    addDataRef("sim/graphics/view/projection_matrix", xplmType_FloatArray,
+               gProjectionMatrix)->readFloatArray = readMatrix;
+    addDataRef("sim/graphics/view/viewport", xplmType_IntArray,
+               nullptr)->readIntArray = readViewport;
+    addDataRef("sim/graphics/VR/enabled", xplmType_Int,
+               nullptr)->readInt = readZero;
+
+    updateAircraft();
+    addDataRef("sim/cockpit2/gauges/indicators/altitude_ft_pilot", xplmType_Float,
+               &gAltitude)->readFloat = readFloat;
+    addDataRef("sim/cockpit2/gauges/indicators/airspeed_kts_pilot", xplmType_Float,
+               &gAirspeed)->readFloat = readFloat;
+    addDataRef("sim/cockpit2/gauges/indicators/heading_AHARS_deg_mag_pilot",
+               xplmType_Float, &gHeading)->readFloat = readFloat;
+    SimDataRef *throttles = addDataRef("sim/cockpit2/engine/actuators/throttle_ratio",
+                                       xplmType_FloatArray, nullptr);
+    throttles->readFloatArray = readThrottles;
+    throttles->writeFloatArray = writeThrottles;
+    throttles->writable = true;
+    SimDataRef *beacon = addDataRef("sim/cockpit/electrical/beacon_lights_on",
+                                    xplmType_Int, &gBeacon);
+    beacon->readInt = readInt;
+    beacon->writeInt = writeInt;
+    beacon->writable = true;
+}
+
+// returns the frontmost visible window of the highest layer under the point
+static SimWindow *windowAt(int x, int y) {
+    SimWindow *found = nullptr;
+    for (auto &window : gWindows) {
+        if (window->destroyed || !window->visible)
+            continue;
+        if (x < window->left || x >= window->right ||
+                y < window->bottom || y >= window->top)
+            continue;
+        if (found == nullptr || window->params.layer >= found->params.layer)
+            found = window.get();
+    }
+    return found;
+}
+
+BenchSim &BenchSim::Get() {
+    static BenchSim sim;
+    return sim;
+}
+
+void BenchSim::SetScreenSize(int width, int height) {
+    gScreenWidth = width;
+    gScreenHeight = height;
+    updateMatrices();
+}
+
+void BenchSim::SetMouseLocation(int x, int y) {
+    gMouseX = x;
+    gMouseY = y;
+}
+
+void BenchSim::SetMouseButton(bool inPressed) {
+    if (inPressed) {
+        gMouseCapture = windowAt(gMouseX, gMouseY);
+        if (gMouseCapture != nullptr)
+            gMouseCapture->params.handleMouseClickFunc(
+                    gMouseCapture, gMouseX, gMouseY, xplm_MouseDown,
+                    gMouseCapture->params.refcon);
+    } else if (gMouseCapture != nullptr) {
+        gMouseCapture->params.handleMouseClickFunc(
+                gMouseCapture, gMouseX, gMouseY, xplm_MouseUp,
+                gMouseCapture->params.refcon);
+        gMouseCapture = nullptr;
+    }
+}
+
+void BenchSim::RunFrame() {
+    gInFrame = true;
+    gCycle++;
+    float time = simTime();
+    updateAircraft();
+
+    // flight loops may create or destroy other loops, new loops start with
+    // the next frame
+    size_t loopCount = gFlightLoops.size();
+    for (size_t i = 0; i < loopCount; i++) {
+        SimFlightLoop *loop = gFlightLoops[i].get();
+        if (loop->destroyed || !loop->scheduled)
+            continue;
+        if (loop->dueTime > 0.0f ? time < loop->dueTime : gCycle < loop->dueCycle)
+            continue;
+        float interval = loop->params.callbackFunc(
+                time - loop->lastCallTime, 1.0f / gFrameRate,
+                ++loop->counter, loop->params.refcon);
+        if (loop->destroyed)
+            continue;
+        loop->lastCallTime = time;
+        XPLMScheduleFlightLoop(loop, interval, 1);
+    }
+
+    if (gMouseCapture != nullptr)
+        gMouseCapture->params.handleMouseClickFunc(
+                gMouseCapture, gMouseX, gMouseY, xplm_MouseDrag,
+                gMouseCapture->params.refcon);
+
+    SimWindow *hovered = windowAt(gMouseX, gMouseY);
+    if (hovered != nullptr && hovered->params.handleCursorFunc != nullptr)
+        hovered->params.handleCursorFunc(hovered, gMouseX, gMouseY,
+                                         hovered->params.refcon);
+
+    // X-Plane draws the windows with a boxel projection of the screen
+    glViewport(0, 0, gScreenWidth, gScreenHeight);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(gProjectionMatrix);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(gModelViewMatrix);
+    glClearColor(0.2f, 0.3f, 0.4f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    std::vector<SimWindow *> order;
+    for (auto &window : gWindows)
+        order.push_back(window.get());
+    std::stable_sort(order.begin(), order.end(),
+                     [](const SimWindow *a, const SimWindow *b) {
+                         return a->params.layer < b->params.layer;
+                     });
+    for (SimWindow *window : order) {
+        if (!window->destroyed && window->visible)
+            window->params.drawWindowFunc(window, window->params.refcon);
+    }
+
+    gInFrame = false;
+    purgeDestroyed();
+}
+
+int BenchSim::GetWindowCount() const {
+    int count = 0;
+    for (auto &window : gWindows) {
+        if (!window->destroyed)
+            count++;
+    }
+    return count;
+}
+
+/* XPLMUtilities */
+
+void XPLMDebugString(const char *inString) {
+    fputs(inString, stderr);
+}
+
+/* XPLMProcessing */
+
+float XPLMGetElapsedTime() {
+    return simTime();
+}
+
+int XPLMGetCycleNumber() {
+    return gCycle;
+}
+
+XPLMFlightLoopID XPLMCreateFlightLoop(XPLMCreateFlightLoop_t *inParams) {
+    std::unique_ptr<SimFlightLoop> loop(new SimFlightLoop());
+    loop->params = *inParams;
+    loop->scheduled = false;
+    loop->dueTime = 0.0f;
+    loop->dueCycle = 0;
+    loop->lastCallTime = simTime();
+    loop->counter = 0;
+    loop->destroyed = false;
+    gFlightLoops.push_back(std::move(loop));
+    return gFlightLoops.back().get();
+}
+
+void XPLMDestroyFlightLoop(XPLMFlightLoopID inFlightLoopID) {
+    static_cast<SimFlightLoop *>(inFlightLoopID)->destroyed = true;
+    if (!gInFrame)
+        purgeDestroyed();
+}
+
+void XPLMScheduleFlightLoop(XPLMFlightLoopID inFlightLoopID, float inInterval,
+                            int inRelativeToNow) {
+    auto loop = static_cast<SimFlightLoop *>(inFlightLoopID);
+    loop->scheduled = inInterval != 0.0f;
+    if (inInterval > 0.0f) {
+        loop->dueTime = simTime() + inInterval;
+    } else {
+        loop->dueTime = 0.0f;
+        loop->dueCycle = gCycle - static_cast<int>(inInterval);
+    }
+}
+
+/* XPLMDataAccess */
+
+XPLMDataRef XPLMFindDataRef(const char *inDataRefName) {
+    registerSceneDataRefs();
+    for (auto &ref : gDataRefs) {
+        if (ref->name == inDataRefName)
+            return ref.get();
+    }
+    return nullptr;
+}
+
+XPLMDataTypeID XPLMGetDataRefTypes(XPLMDataRef inDataRef) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    return ref == nullptr ? xplmType_Unknown : ref->type;
+}
+
+int XPLMCanWriteDataRef(XPLMDataRef inDataRef) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    return ref != nullptr && ref->writable;
+}
+
+int XPLMGetDatai(XPLMDataRef inDataRef) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readInt == nullptr)
+        return 0;
+    return ref->readInt(ref->refcon);
+}
+
+void XPLMSetDatai(XPLMDataRef inDataRef, int inValue) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref != nullptr && ref->writeInt != nullptr)
+        ref->writeInt(ref->writeRefcon, inValue);
+}
+
+float XPLMGetDataf(XPLMDataRef inDataRef) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readFloat == nullptr)
+        return 0.0f;
+    return ref->readFloat(ref->refcon);
+}
+
+void XPLMSetDataf(XPLMDataRef inDataRef, float inValue) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref != nullptr && ref->writeFloat != nullptr)
+        ref->writeFloat(ref->writeRefcon, inValue);
+}
+
+double XPLMGetDatad(XPLMDataRef inDataRef) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readDouble == nullptr)
+        return 0.0;
+    return ref->readDouble(ref->refcon);
+}
+
+void XPLMSetDatad(XPLMDataRef inDataRef, double inValue) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref != nullptr && ref->writeDouble != nullptr)
+        ref->writeDouble(ref->writeRefcon, inValue);
+}
+
+int XPLMGetDatavi(XPLMDataRef inDataRef, int *outValues, int inOffset,
+                  int inMax) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readIntArray == nullptr)
+        return 0;
+    return ref->readIntArray(ref->refcon, outValues, inOffset, inMax);
+}
+
+void XPLMSetDatavi(XPLMDataRef inDataRef, int *inValues, int inOffset,
+                   int inCount) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref != nullptr && ref->writeIntArray != nullptr)
+        ref->writeIntArray(ref->writeRefcon, inValues, inOffset, inCount);
+}
+
+int XPLMGetDatavf(XPLMDataRef inDataRef, float *outValues, int inOffset,
+                  int inMax) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readFloatArray == nullptr)
+        return 0;
+    return ref->readFloatArray(ref->refcon, outValues, inOffset, inMax);
+}
+
+void XPLMSetDatavf(XPLMDataRef inDataRef, float *inValues, int inOffset,
+                   int inCount) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref != nullptr && ref->writeFloatArray != nullptr)
+        ref->writeFloatArray(ref->writeRefcon, inValues, inOffset, inCount);
+}
+
+int XPLMGetDatab(XPLMDataRef inDataRef, void *outValue, int inOffset,
+                 int inMaxBytes) {
+    auto ref = static_cast<SimDataRef *>(inDataRef);
+    if (ref == nullptr || ref->readData == nullptr)
+        return 0;
+    return ref->readData(ref->refcon, outValue, inOffset, inMaxBytes);
+}
+
+XPLMDataRef XPLMRegisterDataAccessor(
+        const char *inDataName, XPLMDataTypeID inDataType, int inIsWritable,
+        XPLMGetDatai_f inReadInt, XPLMSetDatai_f inWriteInt,
+        XPLMGetDataf_f inReadFloat, XPLMSetDataf_f inWriteFloat,
+        XPLMGetDatad_f inReadDouble, XPLMSetDatad_f inWriteDouble,
+        XPLMGetDatavi_f inReadIntArray, XPLMSetDatavi_f inWriteIntArray,
+        XPLMGetDatavf_f inReadFloatArray, XPLMSetDatavf_f inWriteFloatArray,
+        XPLMGetDatab_f inReadData, XPLMSetDatab_f inWriteData,
+        void *inReadRefcon, void *inWriteRefcon) {
+    registerSceneDataRefs();
+    SimDataRef *ref = addDataRef(inDataName, inDataType, inReadRefcon);
+    ref->writable = inIsWritable != 0;
+    ref->readInt = inReadInt;
+    ref->readFloat = inReadFloat;
+    ref->readDouble = inReadDouble;
+    ref->readIntArray = inReadIntArray;
+    ref->readFloatArray = inReadFloatArray;
+    ref->readData = inReadData;
+    ref->writeInt = inWriteInt;
+    ref->writeFloat = inWriteFloat;
+    ref->writeDouble = inWriteDouble;
+    ref->writeIntArray = inWriteIntArray;
+    ref->writeFloatArray = inWriteFloatArray;
+    ref->writeRefcon = inWriteRefcon;
+    return ref;
+}
+
+void XPLMUnregisterDataAccessor(XPLMDataRef inDataRef) {
+    gDataRefs.erase(std::remove_if(gDataRefs.begin(), gDataRefs.end(),
+                                   [inDataRef](const std::unique_ptr<SimDataRef> &r) {
+                                       return r.get() == inDataRef;
+                                   }),
+                    gDataRefs.end());
+}
+
+/* XPLMGraphics */
+
+void XPLMSetGraphicsState(int inEnableFog, int inNumberTexUnits,
+                          int inEnableLighting, int inEnableAlphaTesting,
+                          int inEnableAlphaBlending, int inEnableDepthTesting,
+                          int inEnableDepthWriting) {
+    inEnableFog ? glEnable(GL_FOG) : glDisable(GL_FOG);
+    inNumberTexUnits > 0 ? glEnable(GL_TEXTURE_2D) : glDisable(GL_TEXTURE_2D);
+    inEnableLighting ? glEnable(GL_LIGHTING) : glDisable(GL_LIGHTING);
+    inEnableAlphaTesting ? glEnable(GL_ALPHA_TEST) : glDisable(GL_ALPHA_TEST);
+    if (inEnableAlphaBlending) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    inEnableDepthTesting ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    glDepthMask(inEnableDepthWriting ? GL_TRUE : GL_FALSE);
+}
+
+void XPLMBindTexture2d(int inTextureNum, int inTextureUnit) {
+    // imgx only uses the first texture unit
+    if (inTextureUnit == 0)
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(inTextureNum));
+}
+
+void XPLMGenerateTextureNumbers(int *outTextureIDs, int inCount) {
+    std::vector<GLuint> textures(static_cast<size_t>(inCount));
+    glGenTextures(inCount, textures.data());
+    for (int i = 0; i < inCount; i++)
+        outTextureIDs[i] = static_cast<int>(textures[i]);
+}
+
+/* XPLMDisplay */
+
+XPLMWindowID XPLMCreateWindowEx(XPLMCreateWindow_t *inParams) {
+    std::unique_ptr<SimWindow> window(new SimWindow());
+    window->params = *inParams;
+    window->left = inParams->left;
+    window->top = inParams->top;
+    window->right = inParams->right;
+    window->bottom = inParams->bottom;
+    window->visible = inParams->visible != 0;
+    window->destroyed = false;
+    gWindows.push_back(std::move(window));
+    return gWindows.back().get();
+}
+
+void XPLMDestroyWindow(XPLMWindowID inWindowID) {
+    if (gKeyboardFocus == inWindowID)
+        gKeyboardFocus = nullptr;
+    if (gMouseCapture == inWindowID)
+        gMouseCapture = nullptr;
+    simWindow(inWindowID)->destroyed = true;
+    if (!gInFrame)
+        purgeDestroyed();
+}
+
+void XPLMGetScreenBoundsGlobal(int *outLeft, int *outTop, int *outRight,
+                               int *outBottom) {
+    *outLeft = 0;
+    *outTop = gScreenHeight;
+    *outRight = gScreenWidth;
+    *outBottom = 0;
+}
+
+void XPLMGetMouseLocationGlobal(int *outX, int *outY) {
+    *outX = gMouseX;
+    *outY = gMouseY;
+}
+
+void XPLMGetWindowGeometry(XPLMWindowID inWindowID, int *outLeft, int *outTop,
+                           int *outRight, int *outBottom) {
+    SimWindow *window = simWindow(inWindowID);
+    *outLeft = window->left;
+    *outTop = window->top;
+    *outRight = window->right;
+    *outBottom = window->bottom;
+}
+
+void XPLMSetWindowGeometry(XPLMWindowID inWindowID, int inLeft, int inTop,
+                           int inRight, int inBottom) {
+    SimWindow *window = simWindow(inWindowID);
+    window->left = inLeft;
+    window->top = inTop;
+    window->right = inRight;
+    window->bottom = inBottom;
+}
+
+void XPLMSetWindowGeometryVR(XPLMWindowID inWindowID, int widthBoxels,
+                             int heightBoxels) {
+    // there is no headset, VR enabled always reads 0
+}
+
+int XPLMGetWindowIsVisible(XPLMWindowID inWindowID) {
+    return simWindow(inWindowID)->visible ? 1 : 0;
+}
+
+void XPLMSetWindowIsVisible(XPLMWindowID inWindowID, int inIsVisible) {
+    simWindow(inWindowID)->visible = inIsVisible != 0;
+}
+
+int XPLMWindowIsPoppedOut(XPLMWindowID inWindowID) {
+    return 0;
+}
+
+void XPLMSetWindowGravity(XPLMWindowID inWindowID, float inLeftGravity,
+                          float inTopGravity, float inRightGravity,
+                          float inBottomGravity) {
+}
+
+void XPLMSetWindowResizingLimits(XPLMWindowID inWindowID,
+                                 int inMinWidthBoxels, int inMinHeightBoxels,
+                                 int inMaxWidthBoxels, int inMaxHeightBoxels) {
+}
+
+void XPLMSetWindowPositioningMode(XPLMWindowID inWindowID,
+                                  XPLMWindowPositioningMode inPositioningMode,
+                                  int inMonitorIndex) {
+}
+
+void XPLMSetWindowTitle(XPLMWindowID inWindowID, const char *inWindowTitle) {
+}
+
+void XPLMTakeKeyboardFocus(XPLMWindowID inWindow) {
+    gKeyboardFocus = inWindow;
+}
+
+int XPLMHasKeyboardFocus(XPLMWindowID inWindow) {
+    return gKeyboardFocus == inWindow ? 1 : 0;
+}
+
+int XPLMIsWindowInFront(XPLMWindowID inWindow) {
+    // frontmost visible window of its layer, windows created later are in
+    // front of older ones
+    SimWindow *window = simWindow(inWindow);
+    for (auto it = gWindows.rbegin(); it != gWindows.rend(); ++it) {
+        SimWindow *other = it->get();
+        if (!other->destroyed && other->visible &&
+                other->params.layer == window->params.layer)
+            return other == window ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * benchsim.h
+ *
+ * Stand-in for the X-Plane plugin SDK used by the imgx benchmark.
+ */
+
+#ifndef BENCHSIM_H
+#define BENCHSIM_H
+
+/// \file
+/// This file contains the declaration of the BenchSim class
+/// \brief BenchSim plays the simulator for ImgWindow outside of X-Plane.
+///
+/// benchsim.cpp implements the XPLM functions used by imgx: windows,
+/// datarefs, flight loops, mouse location, mouse clicks and keyboard focus.
+/// A sim frame is run by RunFrame(): the cycle number advances, due flight
+/// loops are called, then the visible windows are drawn layer by layer, the
+/// same order X-Plane uses. The scene datarefs describe a boxel aligned orthographic
+/// projection of the screen, which is also loaded into the OpenGL matrices
+/// before the windows are drawn. A few aircraft datarefs (altitude,
+/// airspeed, heading, throttles, beacon switch) follow the sim clock for
+/// the instruments scene.
+///
+/// The sim clock advances by 1/60 s per frame regardless of the wall clock,
+/// so idle timeouts and ImGui animations are the same on every run.
+class BenchSim {
+public:
+    /// Returns the simulator of the process
+    static BenchSim &Get();
+
+    BenchSim(const BenchSim &) = delete;
+    BenchSim &operator=(const BenchSim &) = delete;
+
+    /// Sets the size of the screen, the global desktop bounds are
+    /// (0, 0) - (width, height)
+    /// \param width screen width in boxels
+    /// \param height screen height in boxels
+    void SetScreenSize(int width, int height);
+
+    /// Moves the mouse
+    /// \param x global x coordinate
+    /// \param y global y coordinate
+    void SetMouseLocation(int x, int y);
+
+    /// Presses or releases the left mouse button. A press goes to the
+    /// window under the mouse, which also receives the drag events of the
+    /// following frames and the release.
+    /// \param inPressed true to press, false to release
+    void SetMouseButton(bool inPressed);
+
+    /// Runs one sim frame: flight loops, mouse callbacks of the window
+    /// under the mouse and the draw callbacks of all visible windows.
+    /// Needs a current OpenGL context of the screen size.
+    void RunFrame();
+
+    /// Returns the number of live windows
+    /// \return window count
+    int GetWindowCount() const;
+
+private:
+    BenchSim() = default;
+};
+
+#endif //BENCHSIM_H
@@ -0,0 +1,480 @@
+/*
+ * imgx_bench.cpp
+ *
+ * Headless benchmark of ImgWindow: drives windows of the benchmark scenes
+ * through the stand-in simulator and reports the frame costs as JSON.
+ */
+
+#include "benchcontext.h"
+#include "benchscenes.h"
+#include "benchsim.h"
+#include "imgarena.h"
+#include "imgclipboard.h"
+#include "imgdataref.h"
+#include "imgframe.h"
+#include "imggl.h"
+#include "imgglstate.h"
+#include "imgtrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+/// \file
+/// This file contains the entry point of the imgx_bench program
+
+// Heap allocations of the process: C++ allocations through the global
+// operator new, ImGui allocations are counted by the arenas of imgx
+static std::atomic<unsigned long> gAllocations{0};
+static std::atomic<unsigned long> gAllocatedBytes{0};
+
+static void *countedAlloc(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+void *operator new(size_t size) {
+    void *p = countedAlloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+struct Options {
+    int windows = 4;
+    std::vector<BenchWindow::Scene> scenes;
+    int frames = 1000;
+    int warmup = 100;
+    int screenWidth = 1920, screenHeight = 1080;
+    int windowWidth = 400, windowHeight = 300;
+    ImgWindow::RenderBackend backend = ImgWindow::FixedFunction;
+    bool vertexBuffers = false;
+    bool renderCache = false;
+    bool idle = false;
+    bool sharedPass = false;
+    bool gpuTiming = false;
+    int threads = 0;
+    bool mouse = false;
+    bool help = false;
+    std::string output;
+    std::string record;
+    std::string replay;
+};
+
+struct Distribution {
+    double min, avg, p50, p99, max;
+};
+
+static void printUsage() {
+    fprintf(stderr,
+            "usage: imgx_bench [options]\n"
+            "  --windows N         windows to create (4)\n"
+            "  --scenes a,b,...    scenes assigned round-robin to the windows,\n"
+            "                      any of widgets,text,plots,table,tree,instruments,\n"
+            "                      toolbar,\n"
+            "                      large_table (background jobs, not replayable)\n"
+            "                      (all but large_table)\n"
+            "  --frames K          measured frames (1000)\n"
+            "  --warmup W          frames run before measuring (100)\n"
+            "  --screen WxH        screen size (1920x1080)\n"
+            "  --window-size WxH   window size (400x300)\n"
+            "  --backend fixed|shader\n"
+            "  --vertex-buffers    draw from streaming buffer objects\n"
+            "  --render-cache      render through the window texture cache\n"
+            "  --idle              enable idle mode\n"
+            "  --shared-pass       render the windows in one shared pass\n"
+            "  --gpu-timing        measure GPU time with timer queries\n"
+            "  --threads N         build the windows on N worker threads (0)\n"
+            "  --mouse             move the mouse over the windows and click\n"
+            "                      once a second\n"
+            "  --record FILE       record the window input into a trace\n"
+            "  --replay FILE       replay a trace instead of the sim input, the\n"
+            "                      run ends with the trace\n"
+            "  --output FILE       write the JSON report to FILE (stdout)\n");
+}
+
+static bool parseSize(const char *text, int &outWidth, int &outHeight) {
+    return sscanf(text, "%dx%d", &outWidth, &outHeight) == 2 &&
+           outWidth > 0 && outHeight > 0;
+}
+
+static bool parseScenes(const char *text,
+                        std::vector<BenchWindow::Scene> &outScenes) {
+    outScenes.clear();
+    if (strcmp(text, "all") == 0)
+        return true;
+    std::string list = text;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        BenchWindow::Scene scene;
+        if (!BenchWindow::FindScene(list.substr(start, end - start), scene))
+            return false;
+        outScenes.push_back(scene);
+        start = end + 1;
+    }
+    return true;
+}
+
+static bool parseOptions(int argc, char **argv, Options &outOptions) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = true;
+        bool ok = true;
+        if (arg == "--windows" && value != nullptr) {
+            outOptions.windows = atoi(value);
+            ok = outOptions.windows > 0;
+        } else if (arg == "--scenes" && value != nullptr) {
+            ok = parseScenes(value, outOptions.scenes);
+        } else if (arg == "--frames" && value != nullptr) {
+            outOptions.frames = atoi(value);
+            ok = outOptions.frames > 0;
+        } else if (arg == "--warmup" && value != nullptr) {
+            outOptions.warmup = atoi(value);
+            ok = outOptions.warmup >= 0;
+        } else if (arg == "--screen" && value != nullptr) {
+            ok = parseSize(value, outOptions.screenWidth, outOptions.screenHeight);
+        } else if (arg == "--window-size" && value != nullptr) {
+            ok = parseSize(value, outOptions.windowWidth, outOptions.windowHeight);
+        } else if (arg == "--backend" && value != nullptr) {
+            ok = strcmp(value, "fixed") == 0 || strcmp(value, "shader") == 0;
+            outOptions.backend = strcmp(value, "shader") == 0 ?
+                                 ImgWindow::Shader : ImgWindow::FixedFunction;
+        } else if (arg == "--threads" && value != nullptr) {
+            outOptions.threads = atoi(value);
+            ok = outOptions.threads >= 0;
+        } else if (arg == "--output" && value != nullptr) {
+            outOptions.output = value;
+        } else if (arg == "--record" && value != nullptr) {
+            outOptions.record = value;
+        } else if (arg == "--replay" && value != nullptr) {
+            outOptions.replay = value;
+        } else {
+            takesValue = false;
+            if (arg == "--vertex-buffers")
+                outOptions.vertexBuffers = true;
+            else if (arg == "--render-cache")
+                outOptions.renderCache = true;
+            else if (arg == "--idle")
+                outOptions.idle = true;
+            else if (arg == "--shared-pass")
+                outOptions.sharedPass = true;
+            else if (arg == "--gpu-timing")
+                outOptions.gpuTiming = true;
+            else if (arg == "--mouse")
+                outOptions.mouse = true;
+            else if (arg == "--help")
+                outOptions.help = true;
+            else
+                ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "imgx_bench: invalid argument %s\n", arg.c_str());
+            return false;
+        }
+        if (takesValue)
+            i++;
+    }
+    if (outOptions.scenes.empty()) {
+        for (int s = 0; s < BenchWindow::SceneCount; s++) {
+            if (s != BenchWindow::LargeTable)
+                outOptions.scenes.push_back(static_cast<BenchWindow::Scene>(s));
+        }
+    }
+    return true;
+}
+
+static Distribution distribution(std::vector<double> samples) {
+    Distribution d = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+        return d;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    size_t count = samples.size();
+    d.min = samples.front();
+    d.avg = sum / static_cast<double>(count);
+    d.p50 = samples[(count - 1) / 2];
+    d.p99 = samples[static_cast<size_t>(std::ceil(0.99 * count)) - 1];
+    d.max = samples.back();
+    return d;
+}
+
+static std::string jsonString(const std::string &text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static void printDistribution(FILE *out, const char *name,
+                              const Distribution &d, bool last = false) {
+    fprintf(out, "    \"%s\": {\"min\": %.2f, \"avg\": %.2f, \"p50\": %.2f, "
+                 "\"p99\": %.2f, \"max\": %.2f}%s\n",
+            name, d.min, d.avg, d.p50, d.p99, d.max, last ? "" : ",");
+}
+
+// moves the mouse along a fixed path over the screen and clicks once a
+// second, so runs are repeatable
+static void moveMouse(const Options &options, int frame) {
+    float t = 0.01f * static_cast<float>(frame);
+    int x = static_cast<int>((0.5f + 0.45f * std::sin(t)) * options.screenWidth);
+    int y = static_cast<int>((0.5f + 0.45f * std::sin(1.7f * t)) * options.screenHeight);
+    BenchSim &sim = BenchSim::Get();
+    sim.SetMouseLocation(x, y);
+    // ImGui sees a click only if press and release are frames apart
+    if (frame % 60 == 30)
+        sim.SetMouseButton(true);
+    else if (frame % 60 == 33)
+        sim.SetMouseButton(false);
+}
+
+static void hashCombine(uint64_t &hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (options.help) {
+        printUsage();
+        return 0;
+    }
+
+    BenchContext context;
+    std::string error;
+    if (!context.Create(options.screenWidth, options.screenHeight, error)) {
+        fprintf(stderr, "imgx_bench: no OpenGL context: %s\n", error.c_str());
+        return 1;
+    }
+
+    BenchSim &sim = BenchSim::Get();
+    sim.SetScreenSize(options.screenWidth, options.screenHeight);
+    // there is no other application to exchange text with
+    ImgClipboard::Get().SetBackend(ImgClipboard::Memory);
+    ImgFrame::Get().SetSharedPass(options.sharedPass);
+    ImgFrame::Get().SetBuildThreads(options.threads);
+
+    // the icons go into the atlas built with the first window
+    if (std::find(options.scenes.begin(), options.scenes.end(),
+                  BenchWindow::Toolbar) != options.scenes.end())
+        BenchWindow::RegisterIcons();
+
+    // windows are tiled from the top left corner of the screen
+    std::vector<std::unique_ptr<BenchWindow>> windows;
+    int columns = std::max(1, options.screenWidth / options.windowWidth);
+    for (int i = 0; i < options.windows; i++) {
+        int left = (i % columns) * options.windowWidth;
+        int top = options.screenHeight -
+                  (i / columns) * options.windowHeight % options.screenHeight;
+        BenchWindow::Scene scene = options.scenes[i % options.scenes.size()];
+        std::unique_ptr<BenchWindow> window(new BenchWindow(
+                scene, left, top, options.windowWidth, options.windowHeight));
+        window->SetRenderBackend(options.backend);
+        window->SetVertexBuffers(options.vertexBuffers);
+        window->SetRenderCache(options.renderCache);
+        window->SetIdleMode(options.idle);
+        window->SetGpuTiming(options.gpuTiming);
+        // the scenes only use ImGui and their own members
+        window->SetParallelBuild(options.threads > 0);
+        windows.push_back(std::move(window));
+    }
+
+    ImgTracePlayer player;
+    if (!options.replay.empty()) {
+        if (!player.Open(options.replay, error)) {
+            fprintf(stderr, "imgx_bench: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    if (!options.record.empty() && !ImgTraceRecorder::Get().Start(options.record)) {
+        fprintf(stderr, "imgx_bench: can't write %s\n", options.record.c_str());
+        return 1;
+    }
+
+    std::vector<double> frameTimes, cpuTimes;
+    frameTimes.reserve(static_cast<size_t>(options.frames));
+    cpuTimes.reserve(static_cast<size_t>(options.frames));
+    unsigned long allocations = 0, allocatedBytes = 0;
+    double drawCalls = 0.0, drawCommands = 0.0;
+    ImgGLState::Stats stateStats = {0, 0};
+    ImgDataRefCache::Stats dataRefStats = {0, 0, 0, 0};
+    uint64_t drawDataHash = 0;
+    int measuredFrames = 0;
+    for (int frame = 0; frame < options.warmup + options.frames; frame++) {
+        if (frame == options.warmup) {
+            ImgArena::Stats arenas = ImgArena::GetTotals();
+            allocations = gAllocations.load() + arenas.allocations;
+            allocatedBytes = gAllocatedBytes.load() + arenas.allocatedBytes;
+            ImgGLState::Get().ResetStats();
+            ImgDataRefCache::Get().ResetStats();
+        }
+        if (!options.replay.empty()) {
+            if (!player.Step())
+                break;
+        } else if (options.mouse) {
+            moveMouse(options, frame);
+        }
+
+        ImgStats::TimePoint start = ImgStats::Now();
+        sim.RunFrame();
+        float cpuTime = ImgStats::Elapsed(start);
+        // the frame is complete once the GPU is done with it
+        glFinish();
+        float frameTime = ImgStats::Elapsed(start);
+
+        if (frame < options.warmup)
+            continue;
+        measuredFrames++;
+        cpuTimes.push_back(1000.0 * cpuTime);
+        frameTimes.push_back(1000.0 * frameTime);
+        for (auto &window : windows) {
+            ImgWindow::DrawStats stats = window->GetDrawStats();
+            drawCalls += stats.draws;
+            drawCommands += stats.commands;
+            hashCombine(drawDataHash, ImgTracePlayer::HashDrawData(window.get()));
+        }
+    }
+    ImgTraceRecorder::Get().Stop();
+    ImgArena::Stats arenas = ImgArena::GetTotals();
+    allocations = gAllocations.load() + arenas.allocations - allocations;
+    allocatedBytes = gAllocatedBytes.load() + arenas.allocatedBytes - allocatedBytes;
+    stateStats = ImgGLState::Get().GetStats();
+    dataRefStats = ImgDataRefCache::Get().GetStats();
+
+    FILE *out = stdout;
+    if (!options.output.empty()) {
+        out = fopen(options.output.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "imgx_bench: can't write %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+
+    // a replay may end before all frames are run
+    const double frames = std::max(measuredFrames, 1);
+    Distribution frameTime = distribution(frameTimes);
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\n");
+    fprintf(out, "    \"windows\": %d,\n", options.windows);
+    fprintf(out, "    \"scenes\": [");
+    for (size_t s = 0; s < options.scenes.size(); s++)
+        fprintf(out, "%s\"%s\"", s > 0 ? ", " : "",
+                BenchWindow::GetSceneName(options.scenes[s]));
+    fprintf(out, "],\n");
+    fprintf(out, "    \"frames\": %d,\n", measuredFrames);
+    fprintf(out, "    \"warmup\": %d,\n", options.warmup);
+    fprintf(out, "    \"screen\": [%d, %d],\n", options.screenWidth, options.screenHeight);
+    fprintf(out, "    \"window_size\": [%d, %d],\n", options.windowWidth, options.windowHeight);
+    fprintf(out, "    \"backend\": \"%s\",\n",
+            options.backend == ImgWindow::Shader ? "shader" : "fixed");
+    fprintf(out, "    \"vertex_buffers\": %s,\n", options.vertexBuffers ? "true" : "false");
+    fprintf(out, "    \"render_cache\": %s,\n", options.renderCache ? "true" : "false");
+    fprintf(out, "    \"idle\": %s,\n", options.idle ? "true" : "false");
+    fprintf(out, "    \"shared_pass\": %s,\n", options.sharedPass ? "true" : "false");
+    fprintf(out, "    \"gpu_timing\": %s,\n", options.gpuTiming ? "true" : "false");
+    fprintf(out, "    \"threads\": %d,\n", options.threads);
+    fprintf(out, "    \"mouse\": %s,\n", options.mouse ? "true" : "false");
+    fprintf(out, "    \"replay\": %s\n", jsonString(options.replay).c_str());
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"gl\": {\"version\": %s, \"renderer\": %s},\n",
+            jsonString(BenchContext::GetVersion()).c_str(),
+            jsonString(BenchContext::GetRenderer()).c_str());
+    fprintf(out, "  \"draw_data_hash\": \"%016llx\",\n",
+            static_cast<unsigned long long>(drawDataHash));
+    fprintf(out, "  \"frames_per_second\": %.1f,\n",
+            frameTime.avg > 0.0 ? 1.0e6 / frameTime.avg : 0.0);
+    fprintf(out, "  \"frame_us\": {\n");
+    printDistribution(out, "total", frameTime);
+    printDistribution(out, "cpu", distribution(cpuTimes), true);
+    fprintf(out, "  },\n");
+
+    // phases are per window and cover the last frames kept by ImgStats
+    fprintf(out, "  \"phases_us\": {\n");
+    const ImgStats::Metric phases[] = {
+        ImgStats::UpdateTime, ImgStats::BuildInterfaceTime,
+        ImgStats::RenderTime, ImgStats::DrawTime, ImgStats::GpuTime
+    };
+    const int phaseCount = sizeof(phases) / sizeof(phases[0]);
+    for (int p = 0; p < phaseCount; p++) {
+        std::vector<double> averages, percentiles;
+        for (auto &window : windows) {
+            ImgStats::Summary summary = window->GetStats().GetSummary(phases[p]);
+            if (summary.count == 0)
+                continue;
+            averages.push_back(1000.0 * summary.avg);
+            percentiles.push_back(1000.0 * summary.p99);
+        }
+        double avg = distribution(averages).avg;
+        double p99 = percentiles.empty() ? 0.0 :
+                     *std::max_element(percentiles.begin(), percentiles.end());
+        fprintf(out, "    \"%s\": {\"avg\": %.2f, \"p99\": %.2f, \"windows\": %d}%s\n",
+                ImgStats::GetMetricName(phases[p]), avg, p99,
+                static_cast<int>(averages.size()), p + 1 < phaseCount ? "," : "");
+    }
+    fprintf(out, "  },\n");
+
+    double vertices = 0.0;
+    for (auto &window : windows)
+        vertices += window->GetStats().GetSummary(ImgStats::Vertices).avg;
+    fprintf(out, "  \"imgui_memory_kib\": {\"live\": %.0f, \"peak\": %.0f, \"pooled\": %.0f, \"trimmed\": %.0f},\n",
+            arenas.liveBytes / 1024.0, arenas.peakBytes / 1024.0,
+            arenas.pooledBytes / 1024.0, arenas.trimmedBytes / 1024.0);
+    fprintf(out, "  \"per_frame\": {\n");
+    fprintf(out, "    \"allocations\": %.1f,\n", allocations / frames);
+    fprintf(out, "    \"allocated_bytes\": %.0f,\n", allocatedBytes / frames);
+    fprintf(out, "    \"draw_calls\": %.1f,\n", drawCalls / frames);
+    fprintf(out, "    \"draw_commands\": %.1f,\n", drawCommands / frames);
+    fprintf(out, "    \"vertices\": %.0f,\n", vertices);
+    fprintf(out, "    \"gl_state_changes\": %.1f,\n", stateStats.issued / frames);
+    fprintf(out, "    \"gl_state_skipped\": %.1f,\n", stateStats.skipped / frames);
+    fprintf(out, "    \"dataref_gets\": %.1f,\n", dataRefStats.gets / frames);
+    fprintf(out, "    \"dataref_reads\": %.1f,\n", dataRefStats.reads / frames);
+    fprintf(out, "    \"dataref_sets\": %.1f,\n", dataRefStats.sets / frames);
+    fprintf(out, "    \"dataref_writes\": %.1f\n", dataRefStats.writes / frames);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+    if (out != stdout)
+        fclose(out);
+
+    // the windows release their OpenGL objects while the context is current
+    windows.clear();
+    return 0;
+}
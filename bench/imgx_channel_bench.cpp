@@ -0,0 +1,344 @@
+/*
+ * imgx_channel_bench.cpp
+ *
+ * Contention benchmark of the imgx channels: the reader side, which runs in
+ * BuildInterface(), against writers hammering the channel from other
+ * threads, compared with the same exchange guarded by a mutex.
+ */
+
+#include "imgchannel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \file
+/// This file contains the entry point of the imgx_channel_bench program
+
+typedef std::chrono::steady_clock Clock;
+
+// State written as a whole, every field holds the write number so a torn
+// read shows up as differing fields
+struct Telemetry {
+    uint32_t fields[32];
+};
+
+static const size_t gEventCapacity = 1024;
+
+struct Options {
+    int producers = 4;
+    int reads = 100000;
+    bool help = false;
+    std::string output;
+};
+
+struct Distribution {
+    double min, avg, p50, p99, max;
+};
+
+struct LatestResult {
+    Distribution readNs;
+    double writesPerSecond;
+    unsigned long tornReads;
+};
+
+struct EventsResult {
+    Distribution drainNs;
+    double eventsPerSecond;
+    unsigned long dropped;
+    unsigned long outOfOrder;
+};
+
+static void printUsage() {
+    fprintf(stderr,
+            "usage: imgx_channel_bench [options]\n"
+            "  --producers N       writer threads of the event channel (4)\n"
+            "  --reads K           reads of the state and drains of the event\n"
+            "                      channel measured per variant (100000)\n"
+            "  --output FILE       write the JSON report to FILE (stdout)\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options &outOptions) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool takesValue = true;
+        bool ok = true;
+        if (arg == "--producers" && value != nullptr) {
+            outOptions.producers = atoi(value);
+            ok = outOptions.producers > 0;
+        } else if (arg == "--reads" && value != nullptr) {
+            outOptions.reads = atoi(value);
+            ok = outOptions.reads > 0;
+        } else if (arg == "--output" && value != nullptr) {
+            outOptions.output = value;
+        } else {
+            takesValue = false;
+            if (arg == "--help")
+                outOptions.help = true;
+            else
+                ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "imgx_channel_bench: invalid argument %s\n", arg.c_str());
+            return false;
+        }
+        if (takesValue)
+            i++;
+    }
+    return true;
+}
+
+static Distribution distribution(std::vector<double> samples) {
+    Distribution d = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+        return d;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    size_t count = samples.size();
+    d.min = samples.front();
+    d.avg = sum / static_cast<double>(count);
+    d.p50 = samples[(count - 1) / 2];
+    d.p99 = samples[static_cast<size_t>(std::ceil(0.99 * count)) - 1];
+    d.max = samples.back();
+    return d;
+}
+
+static double nanoseconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static double seconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static bool isTorn(const Telemetry &state) {
+    for (uint32_t field : state.fields) {
+        if (field != state.fields[0])
+            return true;
+    }
+    return false;
+}
+
+// One writer publishes the state as fast as it can, the reader reads it
+// K times. Read and Write wrap the exchange under test.
+template<typename ReadFn, typename WriteFn>
+static LatestResult runLatest(int reads, ReadFn read, WriteFn write) {
+    std::atomic<bool> stop{false};
+    unsigned long writes = 0;
+    Clock::time_point writerStart = Clock::now();
+    std::thread writer([&] {
+        Telemetry state;
+        while (!stop.load(std::memory_order_relaxed)) {
+            writes++;
+            std::fill(std::begin(state.fields), std::end(state.fields),
+                      static_cast<uint32_t>(writes));
+            write(state);
+        }
+    });
+
+    LatestResult result;
+    result.tornReads = 0;
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(reads));
+    Telemetry state;
+    for (int i = 0; i < reads; i++) {
+        Clock::time_point start = Clock::now();
+        read(state);
+        samples.push_back(nanoseconds(start, Clock::now()));
+        if (isTorn(state))
+            result.tornReads++;
+    }
+    stop = true;
+    writer.join();
+
+    result.readNs = distribution(samples);
+    result.writesPerSecond = writes / seconds(writerStart, Clock::now());
+    return result;
+}
+
+// Producers push numbered events until the reader has drained the channel
+// K times. Push and Drain wrap the exchange under test, Drain hands every
+// event to the check of the per producer order.
+template<typename PushFn, typename DrainFn>
+static EventsResult runEvents(int producers, int reads, PushFn push,
+                              DrainFn drain) {
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> writers;
+    for (int p = 0; p < producers; p++) {
+        writers.emplace_back([&, p] {
+            uint32_t sequence = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint64_t event = (static_cast<uint64_t>(p) << 32) | sequence;
+                if (push(event))
+                    sequence++;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    EventsResult result;
+    result.outOfOrder = 0;
+    unsigned long received = 0;
+    std::vector<int64_t> lastSequence(static_cast<size_t>(producers), -1);
+    auto check = [&](uint64_t event) {
+        auto producer = static_cast<size_t>(event >> 32);
+        auto sequence = static_cast<int64_t>(event & 0xffffffffu);
+        if (sequence <= lastSequence[producer])
+            result.outOfOrder++;
+        lastSequence[producer] = sequence;
+        received++;
+    };
+
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(reads));
+    Clock::time_point readerStart = Clock::now();
+    for (int i = 0; i < reads; i++) {
+        Clock::time_point start = Clock::now();
+        drain(check);
+        samples.push_back(nanoseconds(start, Clock::now()));
+    }
+    double elapsed = seconds(readerStart, Clock::now());
+    stop = true;
+    for (std::thread &writer : writers)
+        writer.join();
+
+    result.drainNs = distribution(samples);
+    result.eventsPerSecond = received / elapsed;
+    result.dropped = 0;
+    return result;
+}
+
+static void printDistribution(FILE *out, const char *name,
+                              const Distribution &d) {
+    fprintf(out, "\"%s\": {\"min\": %.0f, \"avg\": %.1f, \"p50\": %.0f, "
+                 "\"p99\": %.0f, \"max\": %.0f}",
+            name, d.min, d.avg, d.p50, d.p99, d.max);
+}
+
+static void printLatest(FILE *out, const char *name, const LatestResult &r,
+                        bool last) {
+    fprintf(out, "    \"%s\": {", name);
+    printDistribution(out, "read_ns", r.readNs);
+    fprintf(out, ", \"writes_per_s\": %.0f, \"torn_reads\": %lu}%s\n",
+            r.writesPerSecond, r.tornReads, last ? "" : ",");
+}
+
+static void printEvents(FILE *out, const char *name, const EventsResult &r,
+                        bool last) {
+    fprintf(out, "    \"%s\": {", name);
+    printDistribution(out, "drain_ns", r.drainNs);
+    fprintf(out, ", \"events_per_s\": %.0f, \"dropped\": %lu, "
+                 "\"out_of_order\": %lu}%s\n",
+            r.eventsPerSecond, r.dropped, r.outOfOrder, last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (options.help) {
+        printUsage();
+        return 0;
+    }
+
+    // latest value state
+    ImgLatestChannel<Telemetry> latestChannel;
+    LatestResult latestLockFree = runLatest(options.reads,
+        [&latestChannel](Telemetry &outState) {
+            outState = latestChannel.Read();
+        },
+        [&latestChannel](const Telemetry &state) {
+            latestChannel.Write(state);
+        });
+
+    std::mutex latestMutex;
+    Telemetry latestShared = {};
+    LatestResult latestLocked = runLatest(options.reads,
+        [&](Telemetry &outState) {
+            std::lock_guard<std::mutex> lock(latestMutex);
+            outState = latestShared;
+        },
+        [&](const Telemetry &state) {
+            std::lock_guard<std::mutex> lock(latestMutex);
+            latestShared = state;
+        });
+
+    // event stream, the ring is too large for the stack
+    typedef ImgEventChannel<uint64_t, gEventCapacity> EventChannel;
+    std::unique_ptr<EventChannel> eventChannel(new EventChannel);
+    EventsResult eventsLockFree = runEvents(options.producers, options.reads,
+        [&eventChannel](uint64_t event) {
+            return eventChannel->Push(event);
+        },
+        [&eventChannel](const std::function<void(uint64_t)> &check) {
+            uint64_t event;
+            while (eventChannel->Pop(event))
+                check(event);
+        });
+    eventsLockFree.dropped = eventChannel->GetDroppedCount();
+
+    std::mutex eventsMutex;
+    std::deque<uint64_t> eventsShared;
+    unsigned long eventsDropped = 0;
+    EventsResult eventsLocked = runEvents(options.producers, options.reads,
+        [&](uint64_t event) {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            if (eventsShared.size() >= gEventCapacity) {
+                eventsDropped++;
+                return false;
+            }
+            eventsShared.push_back(event);
+            return true;
+        },
+        [&](const std::function<void(uint64_t)> &check) {
+            std::lock_guard<std::mutex> lock(eventsMutex);
+            for (uint64_t event : eventsShared)
+                check(event);
+            eventsShared.clear();
+        });
+    eventsLocked.dropped = eventsDropped;
+
+    FILE *out = stdout;
+    if (!options.output.empty()) {
+        out = fopen(options.output.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "imgx_channel_bench: can't write %s\n",
+                    options.output.c_str());
+            return 1;
+        }
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"config\": {\"producers\": %d, \"reads\": %d, "
+                 "\"event_capacity\": %zu, \"hardware_threads\": %u},\n",
+            options.producers, options.reads, gEventCapacity,
+            std::thread::hardware_concurrency());
+    fprintf(out, "  \"latest\": {\n");
+    printLatest(out, "channel", latestLockFree, false);
+    printLatest(out, "mutex", latestLocked, true);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"events\": {\n");
+    printEvents(out, "channel", eventsLockFree, false);
+    printEvents(out, "mutex", eventsLocked, true);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * imgarena.cpp
+ *
+ * Memory accounting of the ImGui contexts of the dear imgui integration
+ * into X-Plane.
+ */
+
+#include "imgarena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+
+/// \file
+/// This file contains the definition of the ImgArena class
+
+// Keeps the payload aligned like malloc
+struct alignas(alignof(std::max_align_t)) ImgArena::Header {
+    ImgArena *arena;
+    size_t size;
+};
+
+static const size_t gSmallestClass = 32;
+
+// Arenas not released and their contexts, guarded by gArenasMutex. The
+// generation changes with every attach and detach, so the per-thread
+// lookup cache never returns the arena of a destroyed context at the same
+// address.
+static std::mutex gArenasMutex;
+static std::vector<ImgArena *> gArenas;
+static std::atomic<unsigned int> gGeneration{1};
+// Counters of released arenas, for GetTotals()
+static ImgArena::Stats gReleasedTotals = {};
+
+static thread_local ImgArena *tScopeArena = nullptr;
+static thread_local ImGuiContext *tCachedContext = nullptr;
+static thread_local ImgArena *tCachedArena = nullptr;
+static thread_local unsigned int tCachedGeneration = 0;
+
+// Static initialization, before anything could allocate through ImGui
+const bool ImgArena::AllocatorInstalled =
+        (ImGui::SetAllocatorFunctions(ImgArena::allocFunc, ImgArena::freeFunc), true);
+
+static void addCounters(ImgArena::Stats &total, const ImgArena::Stats &stats,
+                        bool memory) {
+    if (memory) {
+        total.liveBytes += stats.liveBytes;
+        total.peakBytes += stats.peakBytes;
+        total.pooledBytes += stats.pooledBytes;
+        total.blocks += stats.blocks;
+        total.frameAllocations += stats.frameAllocations;
+    }
+    total.trimmedBytes += stats.trimmedBytes;
+    total.allocations += stats.allocations;
+    total.allocatedBytes += stats.allocatedBytes;
+}
+
+ImgArena::Scope::Scope(ImgArena *arena):
+        mPrevious(tScopeArena) {
+    tScopeArena = arena;
+}
+
+ImgArena::Scope::~Scope() {
+    tScopeArena = mPrevious;
+}
+
+ImgArena *ImgArena::Create() {
+    auto arena = new ImgArena();
+    std::lock_guard<std::mutex> lock(gArenasMutex);
+    gArenas.push_back(arena);
+    return arena;
+}
+
+ImgArena &ImgArena::Shared() {
+    // never deleted, blocks of it may be freed by static destructors
+    static ImgArena *shared = new ImgArena();
+    return *shared;
+}
+
+ImgArena::Stats ImgArena::GetTotals() {
+    std::lock_guard<std::mutex> lock(gArenasMutex);
+    Stats total = gReleasedTotals;
+    addCounters(total, Shared().GetStats(), true);
+    for (ImgArena *arena : gArenas)
+        addCounters(total, arena->GetStats(), true);
+    return total;
+}
+
+void ImgArena::Attach(ImGuiContext *context) {
+    std::lock_guard<std::mutex> lock(gArenasMutex);
+    mContext = context;
+    gGeneration++;
+}
+
+void ImgArena::Release() {
+    {
+        std::lock_guard<std::mutex> lock(gArenasMutex);
+        gArenas.erase(std::remove(gArenas.begin(), gArenas.end(), this), gArenas.end());
+        gGeneration++;
+        addCounters(gReleasedTotals, GetStats(), false);
+    }
+
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReleased = true;
+        freePools();
+        last = mBlocks == 0;
+    }
+    if (last)
+        delete this;
+}
+
+void ImgArena::EndFrame() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLastFrameAllocations = mFrameAllocations;
+    mFrameAllocations = 0;
+}
+
+size_t ImgArena::Trim() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t bytes = freePools();
+    mTrimmedBytes += bytes;
+    return bytes;
+}
+
+void ImgArena::CountTrimmed(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTrimmedBytes += bytes;
+}
+
+ImgArena::Stats ImgArena::GetStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats;
+    stats.liveBytes = mLiveBytes;
+    stats.peakBytes = mPeakBytes;
+    stats.pooledBytes = mPooledBytes;
+    stats.trimmedBytes = mTrimmedBytes;
+    stats.blocks = mBlocks;
+    stats.allocations = mAllocations;
+    stats.allocatedBytes = mAllocatedBytes;
+    stats.frameAllocations = mLastFrameAllocations;
+    return stats;
+}
+
+void *ImgArena::allocFunc(size_t size, void *userData) {
+    return current()->allocate(size);
+}
+
+void ImgArena::freeFunc(void *ptr, void *userData) {
+    if (ptr == nullptr)
+        return;
+    Header *header = static_cast<Header *>(ptr) - 1;
+    ImgArena *arena = header->arena;
+    if (arena->release(header, header->size))
+        delete arena;
+}
+
+ImgArena *ImgArena::current() {
+    if (tScopeArena != nullptr)
+        return tScopeArena;
+    ImGuiContext *context = ImGui::GetCurrentContext();
+    if (context == nullptr)
+        return &Shared();
+
+    // the context rarely changes between allocations of a thread
+    unsigned int generation = gGeneration.load();
+    if (context == tCachedContext && generation == tCachedGeneration)
+        return tCachedArena;
+    ImgArena *arena = &Shared();
+    {
+        std::lock_guard<std::mutex> lock(gArenasMutex);
+        for (ImgArena *candidate : gArenas) {
+            if (candidate->mContext == context) {
+                arena = candidate;
+                break;
+            }
+        }
+        generation = gGeneration.load();
+    }
+    tCachedContext = context;
+    tCachedArena = arena;
+    tCachedGeneration = generation;
+    return arena;
+}
+
+int ImgArena::classOf(size_t blockBytes) {
+    size_t classBytes = gSmallestClass;
+    for (int c = 0; c < ClassCount; c++, classBytes <<= 1) {
+        if (blockBytes <= classBytes)
+            return c;
+    }
+    return -1;
+}
+
+void *ImgArena::allocate(size_t size) {
+    size_t blockBytes = sizeof(Header) + size;
+    int sizeClass = classOf(blockBytes);
+    void *block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (sizeClass >= 0 && mFree[sizeClass] != nullptr) {
+            block = mFree[sizeClass];
+            mFree[sizeClass] = *static_cast<void **>(block);
+            mPooledBytes -= gSmallestClass << sizeClass;
+        }
+        mLiveBytes += size;
+        mPeakBytes = std::max(mPeakBytes, mLiveBytes);
+        mBlocks++;
+        mAllocations++;
+        mAllocatedBytes += size;
+        mFrameAllocations++;
+    }
+
+    if (block == nullptr) {
+        block = malloc(sizeClass >= 0 ? gSmallestClass << sizeClass : blockBytes);
+        if (block == nullptr) {
+            if (release(nullptr, size))
+                delete this;
+            return nullptr;
+        }
+    }
+    auto header = static_cast<Header *>(block);
+    header->arena = this;
+    header->size = size;
+    return header + 1;
+}
+
+bool ImgArena::release(void *block, size_t size) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLiveBytes -= size;
+    mBlocks--;
+    if (block != nullptr) {
+        int sizeClass = classOf(sizeof(Header) + size);
+        if (sizeClass >= 0 && !mReleased) {
+            *static_cast<void **>(block) = mFree[sizeClass];
+            mFree[sizeClass] = block;
+            mPooledBytes += gSmallestClass << sizeClass;
+        } else {
+            free(block);
+        }
+    }
+    return mReleased && mBlocks == 0;
+}
+
+size_t ImgArena::freePools() {
+    size_t bytes = mPooledBytes;
+    for (void *&list : mFree) {
+        while (list != nullptr) {
+            void *next = *static_cast<void **>(list);
+            free(list);
+            list = next;
+        }
+    }
+    mPooledBytes = 0;
+    return bytes;
+}
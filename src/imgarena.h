@@ -0,0 +1,163 @@
+/*
+ * imgarena.h
+ *
+ * Memory accounting of the ImGui contexts of the dear imgui integration
+ * into X-Plane.
+ */
+
+#ifndef IMGARENA_H
+#define IMGARENA_H
+
+#include "imgui.h"
+
+#include <cstddef>
+#include <mutex>
+
+/// \file
+/// This file contains the declaration of the ImgArena class
+/// \brief ImgArena accounts and pools the ImGui allocations of one
+/// ImgWindow.
+///
+/// imgx installs ImGui allocator functions when the plugin is loaded, before
+/// ImGui allocates anything. Every block is taken from the arena of the
+/// ImGui context current on the calling thread, or from the arena of a
+/// Scope, and remembers its arena, so it's freed into the same arena on any
+/// thread. Allocations without an arena, e.g. of font atlases, go to the
+/// Shared() arena.
+///
+/// Small blocks are kept in free lists of the arena when freed and reused
+/// by the next allocation of the same size class, so the draw lists built
+/// every frame don't go to malloc. Trim() returns the pooled blocks to the
+/// heap; ImgWindow trims its arena and draw lists that stay oversized, see
+/// ImgWindow::SetMemoryTrim().
+///
+/// An arena released while blocks of it are still alive, e.g. held by an
+/// atlas shared with other windows, is deleted with its last block.
+class ImgArena {
+public:
+    /// Memory counters of an arena
+    struct Stats {
+        /// bytes requested by live blocks
+        size_t liveBytes;
+        /// highest liveBytes since the arena was created
+        size_t peakBytes;
+        /// bytes of freed blocks kept for reuse
+        size_t pooledBytes;
+        /// bytes returned to the heap by trimming
+        size_t trimmedBytes;
+        /// live blocks
+        unsigned long blocks;
+        /// allocations since the arena was created
+        unsigned long allocations;
+        /// bytes requested since the arena was created
+        unsigned long long allocatedBytes;
+        /// allocations in the last frame
+        unsigned long frameAllocations;
+    };
+
+    /// Makes an arena current on the calling thread while the scope lives,
+    /// ahead of the arena of the current ImGui context
+    class Scope {
+    public:
+        /// \param arena arena to allocate from
+        explicit Scope(ImgArena *arena);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        ImgArena *mPrevious;
+    };
+
+    /// Creates an arena
+    /// \return new arena, freed by Release()
+    static ImgArena *Create();
+
+    /// Returns the arena of allocations without a window, never released
+    /// \return shared arena
+    static ImgArena &Shared();
+
+    /// Returns the counters of all arenas. The allocation and trim
+    /// counters include released arenas, so the difference of two calls
+    /// covers all ImGui allocations between them; the memory counters
+    /// cover the arenas not released.
+    /// \return summed counters
+    static Stats GetTotals();
+
+    ImgArena(const ImgArena &) = delete;
+    ImgArena &operator=(const ImgArena &) = delete;
+
+    /// Allocates from this arena while the context is current, replacing
+    /// the context attached before
+    /// \param context ImGui context, nullptr to detach
+    void Attach(ImGuiContext *context);
+
+    /// Detaches the context and deletes the arena once its last block is
+    /// freed. The arena must not be used afterwards.
+    void Release();
+
+    /// Ends a frame of the frameAllocations counter
+    void EndFrame();
+
+    /// Returns the pooled blocks to the heap
+    /// \return bytes returned
+    size_t Trim();
+
+    /// Adds bytes trimmed from buffers of the arena to the counters
+    /// \param bytes bytes released by the caller
+    void CountTrimmed(size_t bytes);
+
+    /// Returns the counters of the arena
+    /// \return arena counters
+    Stats GetStats();
+
+private:
+    /// Size classes of the free lists, blocks of 32 to 1024 bytes
+    static const int ClassCount = 6;
+
+    /// Precedes every block
+    struct Header;
+
+    /// Set when the plugin is loaded, ImGui can't free blocks allocated
+    /// before the allocator functions were set
+    static const bool AllocatorInstalled;
+
+    ImgArena() = default;
+    ~ImgArena() = default;
+
+    static void *allocFunc(size_t size, void *userData);
+
+    static void freeFunc(void *ptr, void *userData);
+
+    // returns the arena of the calling thread
+    static ImgArena *current();
+
+    // returns the size class of a block, -1 for blocks taken from the heap
+    static int classOf(size_t blockBytes);
+
+    void *allocate(size_t size);
+
+    // frees a block, returns true if the arena must be deleted
+    bool release(void *block, size_t size);
+
+    // frees the pooled blocks, called with mMutex locked
+    size_t freePools();
+
+    std::mutex mMutex;
+    void *mFree[ClassCount] = {};
+    ImGuiContext *mContext = nullptr;
+    bool mReleased = false;
+
+    size_t mLiveBytes = 0;
+    size_t mPeakBytes = 0;
+    size_t mPooledBytes = 0;
+    size_t mTrimmedBytes = 0;
+    unsigned long mBlocks = 0;
+    unsigned long mAllocations = 0;
+    unsigned long long mAllocatedBytes = 0;
+    unsigned long mFrameAllocations = 0;
+    unsigned long mLastFrameAllocations = 0;
+};
+
+#endif //IMGARENA_H
@@ -0,0 +1,376 @@
+/*
+ * imgatlascache.cpp
+ *
+ * On-disk cache of the font atlases of the dear imgui integration into
+ * X-Plane.
+ */
+
+#include "XPLMUtilities.h"
+
+#include "imgatlascache.h"
+#include "imgiconregistry.h"
+
+#include "imgui_internal.h"
+
+#if IBM
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/// \file
+/// This file contains the definition of the ImgAtlasCache class
+
+static const char gCacheMagic[8] = {'I', 'M', 'G', 'X', 'F', 'N', 'T', 'S'};
+// Increment with every change of the file layout
+static const uint32_t gCacheVersion = 1;
+
+static const uint64_t gHashBasis = 14695981039346656037ULL;
+static const uint64_t gHashPrime = 1099511628211ULL;
+
+// FNV-1a, fast enough for font files of a few MiB
+static void hash(uint64_t &key, const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        key ^= bytes[i];
+        key *= gHashPrime;
+    }
+}
+
+template<typename T>
+static void hash(uint64_t &key, T value) {
+    hash(key, &value, sizeof(value));
+}
+
+static void put(std::vector<unsigned char> &out, const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+template<typename T>
+static void put(std::vector<unsigned char> &out, T value) {
+    put(out, &value, sizeof(value));
+}
+
+// reads from a mapped file, the fields are not aligned
+static bool take(const unsigned char *&cursor, const unsigned char *end,
+                 void *out, size_t size) {
+    if (static_cast<size_t>(end - cursor) < size)
+        return false;
+    memcpy(out, cursor, size);
+    cursor += size;
+    return true;
+}
+
+template<typename T>
+static bool take(const unsigned char *&cursor, const unsigned char *end, T &out) {
+    return take(cursor, end, &out, sizeof(out));
+}
+
+static int fontIndex(const ImFontAtlas *atlas, const ImFont *font) {
+    for (int i = 0; i < atlas->Fonts.Size; i++) {
+        if (atlas->Fonts[i] == font)
+            return i;
+    }
+    return -1;
+}
+
+struct ImgAtlasCache::Mapping {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (data == nullptr)
+            return;
+#if IBM
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<unsigned char *>(data), size);
+#endif
+    }
+
+    bool open(const std::string &path) {
+#if IBM
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        std::vector<wchar_t> widePath(length > 0 ? length : 1);
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath.data(), length);
+        HANDLE file = CreateFileW(widePath.data(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        // the view keeps the file open
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return false;
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr)
+            return false;
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat info;
+        void *view = MAP_FAILED;
+        if (fstat(file, &info) == 0 && info.st_size > 0)
+            view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping keeps the file open
+        close(file);
+        if (view == MAP_FAILED)
+            return false;
+        size = static_cast<size_t>(info.st_size);
+#endif
+        data = static_cast<const unsigned char *>(view);
+        return true;
+    }
+};
+
+ImgAtlasCache::ImgAtlasCache(const std::string &directory, ImFontAtlas *atlas):
+        mAtlas(atlas) {
+    if (directory.empty())
+        return;
+    mKey = computeKey();
+    char name[40];
+    snprintf(name, sizeof(name), "imgx-atlas-%016llx.bin",
+             static_cast<unsigned long long>(mKey));
+    mPath = directory;
+    if (mPath.back() != '/' && mPath.back() != '\\')
+        mPath += '/';
+    mPath += name;
+}
+
+ImgAtlasCache::~ImgAtlasCache() {
+    ReleasePixels();
+}
+
+bool ImgAtlasCache::Load(bool copyPixels) {
+    if (mPath.empty())
+        return false;
+    std::unique_ptr<Mapping> mapping(new Mapping());
+    if (!mapping->open(mPath))
+        return false;
+
+    const unsigned char *cursor = mapping->data;
+    const unsigned char *end = mapping->data + mapping->size;
+    char magic[sizeof(gCacheMagic)];
+    uint32_t version;
+    uint64_t key;
+    if (!take(cursor, end, magic) || memcmp(magic, gCacheMagic, sizeof(magic)) != 0 ||
+            !take(cursor, end, version) || version != gCacheVersion ||
+            !take(cursor, end, key) || key != mKey)
+        return false;
+
+    int32_t texWidth, texHeight, cursorRect;
+    ImVec2 uvScale, uvWhitePixel;
+    if (!take(cursor, end, texWidth) || !take(cursor, end, texHeight) ||
+            !take(cursor, end, uvScale) || !take(cursor, end, uvWhitePixel) ||
+            !take(cursor, end, cursorRect))
+        return false;
+
+    // everything is read before the atlas is touched, a truncated file
+    // leaves it ready for building
+    struct FontData {
+        float ascent, descent;
+        int32_t surface;
+        int32_t glyphCount;
+        const unsigned char *glyphs;
+    };
+    int32_t fontCount;
+    if (!take(cursor, end, fontCount) || fontCount != mAtlas->Fonts.Size)
+        return false;
+    std::vector<FontData> fonts(fontCount);
+    for (FontData &font : fonts) {
+        if (!take(cursor, end, font.ascent) || !take(cursor, end, font.descent) ||
+                !take(cursor, end, font.surface) || !take(cursor, end, font.glyphCount) ||
+                font.glyphCount < 0)
+            return false;
+        size_t glyphBytes = static_cast<size_t>(font.glyphCount) * sizeof(ImFontGlyph);
+        if (static_cast<size_t>(end - cursor) < glyphBytes)
+            return false;
+        font.glyphs = cursor;
+        cursor += glyphBytes;
+    }
+
+    int32_t rectCount;
+    if (!take(cursor, end, rectCount) || rectCount < mAtlas->CustomRects.Size)
+        return false;
+    std::vector<ImFontAtlas::CustomRect> rects(rectCount);
+    for (int i = 0; i < rectCount; i++) {
+        ImFontAtlas::CustomRect &rect = rects[i];
+        int32_t font;
+        if (!take(cursor, end, rect.ID) || !take(cursor, end, rect.Width) ||
+                !take(cursor, end, rect.Height) || !take(cursor, end, rect.X) ||
+                !take(cursor, end, rect.Y) || !take(cursor, end, rect.GlyphAdvanceX) ||
+                !take(cursor, end, rect.GlyphOffset) || !take(cursor, end, font) ||
+                font >= fontCount)
+            return false;
+        rect.Font = font >= 0 ? mAtlas->Fonts[font] : nullptr;
+    }
+
+    size_t pixelBytes = static_cast<size_t>(texWidth) * texHeight;
+    if (texWidth <= 0 || texHeight <= 0 || static_cast<size_t>(end - cursor) != pixelBytes)
+        return false;
+    const unsigned char *pixels = cursor;
+    for (const ImFontConfig &config : mAtlas->ConfigData) {
+        if (fontIndex(mAtlas, config.DstFont) < 0)
+            return false;
+    }
+
+    // the steps of ImFontAtlas::Build() without rasterizing
+    for (ImFontConfig &config : mAtlas->ConfigData) {
+        const FontData &font = fonts[fontIndex(mAtlas, config.DstFont)];
+        ImFontAtlasBuildSetupFont(mAtlas, config.DstFont, &config, font.ascent, font.descent);
+    }
+    for (int i = 0; i < fontCount; i++) {
+        ImFont *font = mAtlas->Fonts[i];
+        font->Glyphs.resize(fonts[i].glyphCount);
+        if (fonts[i].glyphCount > 0)
+            memcpy(font->Glyphs.Data, fonts[i].glyphs, font->Glyphs.Size * sizeof(ImFontGlyph));
+        font->MetricsTotalSurface = fonts[i].surface;
+        font->BuildLookupTable();
+    }
+    mAtlas->CustomRects.resize(rectCount);
+    for (int i = 0; i < rectCount; i++)
+        mAtlas->CustomRects[i] = rects[i];
+    mAtlas->CustomRectIds[0] = cursorRect;
+    mAtlas->TexWidth = texWidth;
+    mAtlas->TexHeight = texHeight;
+    mAtlas->TexUvScale = uvScale;
+    mAtlas->TexUvWhitePixel = uvWhitePixel;
+
+    if (copyPixels) {
+        mAtlas->TexPixelsAlpha8 = static_cast<unsigned char *>(ImGui::MemAlloc(pixelBytes));
+        memcpy(mAtlas->TexPixelsAlpha8, pixels, pixelBytes);
+    } else {
+        mAtlas->TexPixelsAlpha8 = const_cast<unsigned char *>(pixels);
+        mMapping = std::move(mapping);
+    }
+    return true;
+}
+
+void ImgAtlasCache::Save() {
+    if (mPath.empty() || mAtlas->TexPixelsAlpha8 == nullptr)
+        return;
+
+    std::vector<unsigned char> data;
+    put(data, gCacheMagic, sizeof(gCacheMagic));
+    put(data, gCacheVersion);
+    put(data, mKey);
+    put(data, static_cast<int32_t>(mAtlas->TexWidth));
+    put(data, static_cast<int32_t>(mAtlas->TexHeight));
+    put(data, mAtlas->TexUvScale);
+    put(data, mAtlas->TexUvWhitePixel);
+    put(data, static_cast<int32_t>(mAtlas->CustomRectIds[0]));
+
+    put(data, static_cast<int32_t>(mAtlas->Fonts.Size));
+    for (const ImFont *font : mAtlas->Fonts) {
+        put(data, font->Ascent);
+        put(data, font->Descent);
+        put(data, static_cast<int32_t>(font->MetricsTotalSurface));
+        put(data, static_cast<int32_t>(font->Glyphs.Size));
+        put(data, font->Glyphs.Data, font->Glyphs.Size * sizeof(ImFontGlyph));
+    }
+
+    put(data, static_cast<int32_t>(mAtlas->CustomRects.Size));
+    for (const ImFontAtlas::CustomRect &rect : mAtlas->CustomRects) {
+        put(data, rect.ID);
+        put(data, rect.Width);
+        put(data, rect.Height);
+        put(data, rect.X);
+        put(data, rect.Y);
+        put(data, rect.GlyphAdvanceX);
+        put(data, rect.GlyphOffset);
+        put(data, static_cast<int32_t>(fontIndex(mAtlas, rect.Font)));
+    }
+
+    put(data, mAtlas->TexPixelsAlpha8,
+        static_cast<size_t>(mAtlas->TexWidth) * mAtlas->TexHeight);
+
+    // written aside and renamed, so other instances never map a partial file
+    std::string tempPath = mPath + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        XPLMDebugString(("imgx: can't write font cache " + tempPath + "\n").c_str());
+        return;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = fclose(file) == 0 && written;
+#if IBM
+    // rename doesn't replace files on Windows
+    remove(mPath.c_str());
+#endif
+    if (!written || rename(tempPath.c_str(), mPath.c_str()) != 0) {
+        XPLMDebugString(("imgx: can't write font cache " + mPath + "\n").c_str());
+        remove(tempPath.c_str());
+    }
+}
+
+void ImgAtlasCache::ReleasePixels() {
+    if (mMapping == nullptr)
+        return;
+    const unsigned char *pixels = mAtlas->TexPixelsAlpha8;
+    if (pixels >= mMapping->data && pixels < mMapping->data + mMapping->size)
+        mAtlas->TexPixelsAlpha8 = nullptr;
+    mMapping.reset();
+}
+
+uint64_t ImgAtlasCache::computeKey() const {
+    uint64_t key = gHashBasis;
+    hash(key, gCacheVersion);
+    hash(key, IMGUI_VERSION, strlen(IMGUI_VERSION));
+    hash(key, sizeof(ImFontGlyph));
+    hash(key, sizeof(ImWchar));
+    hash(key, mAtlas->Flags);
+    hash(key, mAtlas->TexDesiredWidth);
+    hash(key, mAtlas->TexGlyphPadding);
+
+    for (const ImFontConfig &config : mAtlas->ConfigData) {
+        // the file contents, not the path, so an updated font is rebuilt
+        hash(key, config.FontDataSize);
+        hash(key, config.FontData, static_cast<size_t>(config.FontDataSize));
+        hash(key, config.FontNo);
+        hash(key, config.SizePixels);
+        hash(key, config.OversampleH);
+        hash(key, config.OversampleV);
+        hash(key, config.PixelSnapH);
+        hash(key, config.GlyphExtraSpacing);
+        hash(key, config.GlyphOffset);
+        for (const ImWchar *range = config.GlyphRanges; range != nullptr && *range != 0; range++)
+            hash(key, *range);
+        hash(key, config.GlyphMinAdvanceX);
+        hash(key, config.GlyphMaxAdvanceX);
+        hash(key, config.MergeMode);
+        hash(key, config.RasterizerFlags);
+        hash(key, config.RasterizerMultiply);
+        hash(key, fontIndex(mAtlas, config.DstFont));
+    }
+
+    for (const ImFontAtlas::CustomRect &rect : mAtlas->CustomRects) {
+        hash(key, rect.ID);
+        hash(key, rect.Width);
+        hash(key, rect.Height);
+        hash(key, rect.GlyphAdvanceX);
+        hash(key, rect.GlyphOffset);
+        hash(key, fontIndex(mAtlas, rect.Font));
+    }
+
+    // the rects only tell the size of the icons
+    ImgIconRegistry &icons = ImgIconRegistry::Get();
+    for (int i = 0; i < icons.GetIconCount(); i++) {
+        ImVec2 size = icons.GetSize(i);
+        hash(key, icons.GetAlpha(i), static_cast<size_t>(size.x) * static_cast<size_t>(size.y));
+    }
+    return key;
+}
@@ -0,0 +1,74 @@
+/*
+ * imgatlascache.h
+ *
+ * On-disk cache of the font atlases of the dear imgui integration into
+ * X-Plane.
+ */
+
+#ifndef IMGATLASCACHE_H
+#define IMGATLASCACHE_H
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// \file
+/// This file contains the declaration of the ImgAtlasCache class
+/// \brief ImgAtlasCache saves a built font atlas to a file and restores it
+/// without rasterizing the fonts again.
+///
+/// The file holds the glyph tables of the fonts, the custom rects and the
+/// alpha texture of the atlas. It is named after a key hashed from the
+/// contents of the font files, the font configs, the custom rects, the
+/// icons of ImgIconRegistry and the ImGui version, so a changed font or
+/// icon selects another file. A file of another format or key is ignored
+/// and the atlas built as usual.
+///
+/// A file found is memory mapped, the texture is created straight from the
+/// mapped pixels. ImgFontRegistry uses a cache for every atlas it builds
+/// once a cache directory is set.
+class ImgAtlasCache {
+public:
+    /// Computes the key of an atlas with its fonts and custom rects added
+    /// but not built
+    /// \param directory directory of the cache files, empty to disable the
+    /// cache
+    /// \param atlas atlas to load or save
+    ImgAtlasCache(const std::string &directory, ImFontAtlas *atlas);
+
+    ~ImgAtlasCache();
+
+    ImgAtlasCache(const ImgAtlasCache &) = delete;
+    ImgAtlasCache &operator=(const ImgAtlasCache &) = delete;
+
+    /// Restores the atlas from its cache file instead of building it. The
+    /// pixels of the atlas point into the mapped file until
+    /// ReleasePixels(), the atlas must not free them.
+    /// \param copyPixels true to copy the pixels into ImGui memory owned by
+    /// the atlas, e.g. for ImgGlyphCache growing them
+    /// \return true if the atlas was restored, false if it must be built
+    bool Load(bool copyPixels);
+
+    /// Writes a built atlas to its cache file. Does nothing if the cache is
+    /// disabled or the atlas has no pixels.
+    void Save();
+
+    /// Unmaps the cache file after the texture was created, resetting the
+    /// pixels of the atlas if they point into it
+    void ReleasePixels();
+
+private:
+    /// Read-only view of a cache file
+    struct Mapping;
+
+    uint64_t computeKey() const;
+
+    std::string mPath;
+    ImFontAtlas *mAtlas;
+    uint64_t mKey = 0;
+    std::unique_ptr<Mapping> mMapping;
+};
+
+#endif //IMGATLASCACHE_H
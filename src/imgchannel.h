@@ -0,0 +1,199 @@
+/*
+ * imgchannel.h
+ *
+ * Lock-free channels passing data from plugin threads to ImgWindows.
+ */
+
+#ifndef IMGCHANNEL_H
+#define IMGCHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/// \file
+/// This file contains the declaration of the ImgChannel,
+/// ImgLatestChannel and ImgEventChannel classes
+/// \brief Channels hand data computed on background threads to the
+/// BuildInterface() of a window without locks.
+///
+/// ImgLatestChannel keeps the latest value of a state, e.g. telemetry or a
+/// computed route: one writer thread and one reader, the window. It is a
+/// triple buffer, the writer never waits for the reader and the reader
+/// always gets the newest complete value, also without waiting.
+///
+/// ImgEventChannel is a bounded ring of events, e.g. log lines or
+/// messages: any number of writer threads and one reader. Writers claim a
+/// slot with a compare and swap, a full ring drops the event and counts it.
+/// The reader takes the events in order and never waits, an event whose
+/// writer is still copying it is taken on the next read.
+///
+/// Every write increments the serial of the channel. A window that called
+/// ImgWindow::WatchChannel() compares the serials on every frame and
+/// rebuilds in idle mode when new data arrived. The window must stop
+/// watching before the channel is destroyed.
+
+/// Write counter shared by all channels
+class ImgChannel {
+public:
+    ImgChannel(const ImgChannel &) = delete;
+    ImgChannel &operator=(const ImgChannel &) = delete;
+
+    /// Returns the number of writes so far, wrapping around
+    /// \return write serial
+    unsigned int GetSerial() const {
+        return mSerial.load(std::memory_order_acquire);
+    }
+
+protected:
+    ImgChannel() = default;
+    ~ImgChannel() = default;
+
+    void signal() {
+        mSerial.fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    std::atomic<unsigned int> mSerial{0};
+};
+
+/// Latest value of a state, one writer thread and one reader
+template<typename T>
+class ImgLatestChannel : public ImgChannel {
+public:
+    ImgLatestChannel() = default;
+
+    /// Creates the channel with a value the reader gets until the first
+    /// write
+    /// \param initial initial value
+    explicit ImgLatestChannel(const T &initial) {
+        for (T &buffer : mBuffers)
+            buffer = initial;
+    }
+
+    /// Publishes a new value, writer thread only
+    /// \param value value to publish
+    void Write(const T &value) {
+        mBuffers[mBack] = value;
+        publish();
+    }
+
+    /// Publishes a new value built in place, writer thread only. The buffer
+    /// holds an older value, which is useful to update a large state
+    /// without a copy.
+    /// \param update function called with the buffer to fill
+    template<typename F>
+    void Update(F update) {
+        update(mBuffers[mBack]);
+        publish();
+    }
+
+    /// Returns the newest value, reader only. The reference stays valid and
+    /// unchanged until the next Read().
+    /// \return latest value
+    const T &Read() {
+        if (mShared.load(std::memory_order_relaxed) & gFresh) {
+            mFront = mShared.exchange(mFront, std::memory_order_acq_rel) & gIndex;
+        }
+        return mBuffers[mFront];
+    }
+
+    /// Returns true if a value was written since the last Read()
+    /// \return true if new data is waiting
+    bool HasNew() const {
+        return (mShared.load(std::memory_order_acquire) & gFresh) != 0;
+    }
+
+private:
+    static const uint8_t gIndex = 0x03;
+    static const uint8_t gFresh = 0x04;
+
+    void publish() {
+        mBack = mShared.exchange(static_cast<uint8_t>(mBack | gFresh),
+                                 std::memory_order_acq_rel) & gIndex;
+        signal();
+    }
+
+    T mBuffers[3] = {};
+    /// Buffer filled by the writer
+    uint8_t mBack = 0;
+    /// Buffer read by the reader
+    uint8_t mFront = 1;
+    /// Buffer in between and whether it holds an unread value
+    std::atomic<uint8_t> mShared{2};
+};
+
+/// Bounded ring of events, any number of writer threads and one reader
+template<typename T, size_t Capacity>
+class ImgEventChannel : public ImgChannel {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+public:
+    ImgEventChannel() {
+        for (size_t i = 0; i < Capacity; i++)
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /// Appends an event, any thread
+    /// \param value event to append
+    /// \return false if the ring is full and the event was dropped
+    bool Push(const T &value) {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = mCells[pos & (Capacity - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                // the slot is free, claim it unless another writer was faster
+                if (mTail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    signal();
+                    return true;
+                }
+            } else if (diff < 0) {
+                // the reader hasn't taken the event a lap ago yet
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Takes the oldest event, reader only
+    /// \param outValue the event
+    /// \return false if there is no complete event
+    bool Pop(T &outValue) {
+        Cell &cell = mCells[mHead & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != mHead + 1)
+            return false;
+        outValue = std::move(cell.value);
+        cell.sequence.store(mHead + Capacity, std::memory_order_release);
+        mHead++;
+        return true;
+    }
+
+    /// Returns the number of events dropped because the ring was full
+    /// \return dropped events
+    unsigned long GetDroppedCount() const {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell mCells[Capacity];
+    /// Next slot to write, shared by the writers
+    std::atomic<size_t> mTail{0};
+    /// Next slot to read, reader only
+    size_t mHead = 0;
+    std::atomic<unsigned long> mDropped{0};
+};
+
+#endif //IMGCHANNEL_H
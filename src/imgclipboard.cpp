@@ -0,0 +1,477 @@
+/*
+ * imgclipboard.cpp
+ *
+ * Clipboard access for the dear imgui integration into X-Plane.
+ */
+
+#include "XPLMDataAccess.h"
+
+#include "imgclipboard.h"
+
+#if IBM
+#include <windows.h>
+#endif
+
+#if LIN
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <thread>
+#endif
+
+#include <cstring>
+
+/// \file
+/// This file contains the definition of the ImgClipboard class
+
+#if APL
+bool GetOSXClipboard(std::string& outText);
+bool SetOSXClipboard(const std::string& inText);
+#endif
+
+#if IBM || APL
+static bool getNativeText(std::string &outText) {
+#if IBM
+    HGLOBAL hglb;
+    LPSTR lptstr;
+    bool retVal = false;
+    static XPLMDataRef hwndDataRef = XPLMFindDataRef(
+                "sim/operation/windows/system_window");
+    HWND hwndMain = (HWND) (uintptr_t) XPLMGetDatai(hwndDataRef);
+
+    if (!IsClipboardFormatAvailable(CF_TEXT))
+        return false;
+
+    if (!OpenClipboard(hwndMain))
+        return false;
+
+    hglb = GetClipboardData(CF_TEXT);
+    if (hglb != nullptr) {
+        lptstr = (LPSTR) GlobalLock(hglb);
+        if (lptstr != nullptr) {
+            outText = lptstr;
+            GlobalUnlock(hglb);
+            retVal = true;
+        }
+    }
+
+    CloseClipboard();
+
+    return retVal;
+#endif
+#if APL
+    return GetOSXClipboard(outText);
+#endif
+}
+
+static bool setNativeText(const std::string &inText) {
+#if IBM
+    LPSTR lptstrCopy;
+    HGLOBAL hglbCopy;
+    static XPLMDataRef hwndDataRef = XPLMFindDataRef(
+                "sim/operation/windows/system_window");
+    HWND hwndMain = (HWND) (uintptr_t) XPLMGetDatai(hwndDataRef);
+
+    if (!OpenClipboard(hwndMain))
+        return false;
+    EmptyClipboard();
+
+    hglbCopy = GlobalAlloc(GMEM_MOVEABLE,
+                           sizeof(TCHAR) * (inText.length() + 1));
+    if (hglbCopy == nullptr) {
+        CloseClipboard();
+        return false;
+    }
+
+    lptstrCopy = (LPSTR) GlobalLock(hglbCopy);
+    strcpy(lptstrCopy, inText.c_str());
+    GlobalUnlock(hglbCopy);
+
+    SetClipboardData(CF_TEXT, hglbCopy);
+    CloseClipboard();
+    return true;
+#endif
+#if APL
+    return SetOSXClipboard(inText);
+#endif
+}
+#endif
+
+#if LIN
+/// Background thread serving the CLIPBOARD selection. The X connection and
+/// the window are used by the thread only, the text and the requests are
+/// guarded by the mutex of ImgClipboard.
+struct ImgClipboard::X11Service {
+    Display *display = nullptr;
+    Window window = 0;
+    Atom clipboardAtom = None, utf8Atom = None, targetsAtom = None;
+    Atom timestampAtom = None, textAtom = None, incrAtom = None;
+    Atom propertyAtom = None;
+    int wakePipe[2] = {-1, -1};
+    std::thread thread;
+
+    /// Shared with the plugin
+    std::mutex *mutex = nullptr;
+    std::string text;
+    bool hasText = false;
+    bool quit = false;
+    bool ownRequest = false;
+    bool refreshRequest = false;
+    float timeout = 1.0f;
+
+    /// Used by the thread only
+    bool owner = false;
+    Atom pendingTarget = None;
+    std::chrono::steady_clock::time_point pendingSince, lastPoll;
+    Window lastOwner = None;
+    unsigned long lastTimestamp = 0;
+    bool timestampSupported = true;
+
+    void run();
+
+    void wake();
+
+    void handleEvent(XEvent &event);
+
+    void answerRequest(const XSelectionRequestEvent &request);
+
+    void receive(const XSelectionEvent &notify);
+
+    void convert(Atom target);
+};
+
+void ImgClipboard::X11Service::run() {
+    using namespace std::chrono;
+    const int xfd = ConnectionNumber(display);
+    const auto pollInterval = milliseconds(500);
+
+    for (;;) {
+        bool own, refresh;
+        float timeoutSeconds;
+        {
+            std::lock_guard<std::mutex> lock(*mutex);
+            if (quit)
+                break;
+            own = ownRequest;
+            ownRequest = false;
+            refresh = refreshRequest;
+            refreshRequest = false;
+            timeoutSeconds = timeout;
+        }
+
+        auto now = steady_clock::now();
+        if (own) {
+            XSetSelectionOwner(display, clipboardAtom, window, CurrentTime);
+            owner = XGetSelectionOwner(display, clipboardAtom) == window;
+        }
+
+        // the owner never answered, give up the transfer
+        if (pendingTarget != None &&
+                duration<float>(now - pendingSince).count() > timeoutSeconds)
+            pendingTarget = None;
+
+        // keep the cache up to date while another application owns the
+        // selection: fetch the text when the owner or its timestamp changes
+        if (!owner && pendingTarget == None) {
+            if (refresh) {
+                convert(utf8Atom);
+            } else if (now - lastPoll >= pollInterval) {
+                lastPoll = now;
+                Window current = XGetSelectionOwner(display, clipboardAtom);
+                if (current != lastOwner) {
+                    lastOwner = current;
+                    lastTimestamp = 0;
+                    timestampSupported = true;
+                    if (current != None)
+                        convert(utf8Atom);
+                } else if (current != None && timestampSupported) {
+                    convert(timestampAtom);
+                }
+            }
+        }
+
+        XFlush(display);
+        while (XPending(display) > 0) {
+            XEvent event;
+            XNextEvent(display, &event);
+            handleEvent(event);
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(xfd, &fds);
+        FD_SET(wakePipe[0], &fds);
+        timeval tv = {0, 100000};
+        if (select(std::max(xfd, wakePipe[0]) + 1, &fds, nullptr, nullptr,
+                   &tv) > 0 && FD_ISSET(wakePipe[0], &fds)) {
+            char buffer[64];
+            while (read(wakePipe[0], buffer, sizeof(buffer)) > 0) {}
+        }
+    }
+}
+
+void ImgClipboard::X11Service::wake() {
+    char c = 0;
+    if (write(wakePipe[1], &c, 1) < 0) {
+        // the pipe is full, the thread wakes up anyway
+    }
+}
+
+void ImgClipboard::X11Service::handleEvent(XEvent &event) {
+    switch (event.type) {
+    case SelectionRequest:
+        answerRequest(event.xselectionrequest);
+        break;
+    case SelectionClear:
+        if (event.xselectionclear.selection == clipboardAtom) {
+            // another application copied, fetch its text on the next poll
+            owner = false;
+            lastOwner = None;
+        }
+        break;
+    case SelectionNotify:
+        if (event.xselection.selection == clipboardAtom &&
+                event.xselection.requestor == window &&
+                pendingTarget != None)
+            receive(event.xselection);
+        break;
+    default:
+        break;
+    }
+}
+
+void ImgClipboard::X11Service::answerRequest(
+        const XSelectionRequestEvent &request) {
+    XSelectionEvent reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type = SelectionNotify;
+    reply.display = request.display;
+    reply.requestor = request.requestor;
+    reply.selection = request.selection;
+    reply.target = request.target;
+    reply.time = request.time;
+    reply.property = None;
+
+    // obsolete clients don't name a property
+    Atom property = request.property != None ? request.property : request.target;
+
+    if (owner && request.selection == clipboardAtom) {
+        if (request.target == targetsAtom) {
+            const Atom supported[4] = {targetsAtom, utf8Atom, XA_STRING, textAtom};
+            XChangeProperty(display, request.requestor, property, XA_ATOM, 32,
+                            PropModeReplace,
+                            reinterpret_cast<const unsigned char *>(supported), 4);
+            reply.property = property;
+        } else if (request.target == utf8Atom || request.target == XA_STRING ||
+                request.target == textAtom) {
+            std::string copy;
+            {
+                std::lock_guard<std::mutex> lock(*mutex);
+                copy = text;
+            }
+            // the text is sent in one piece, INCR transfers are not supported
+            Atom type = request.target == textAtom ? utf8Atom : request.target;
+            XChangeProperty(display, request.requestor, property, type, 8,
+                            PropModeReplace,
+                            reinterpret_cast<const unsigned char *>(copy.data()),
+                            static_cast<int>(copy.size()));
+            reply.property = property;
+        }
+    }
+
+    XSendEvent(display, request.requestor, False, NoEventMask,
+               reinterpret_cast<XEvent *>(&reply));
+}
+
+void ImgClipboard::X11Service::receive(const XSelectionEvent &notify) {
+    Atom target = pendingTarget;
+    pendingTarget = None;
+
+    if (notify.property == None) {
+        // the owner can't convert to the target
+        if (target == utf8Atom)
+            convert(XA_STRING);
+        else if (target == timestampAtom)
+            timestampSupported = false;
+        return;
+    }
+
+    Atom type;
+    int format;
+    unsigned long count, bytesAfter;
+    unsigned char *data = nullptr;
+    XGetWindowProperty(display, window, propertyAtom, 0, LONG_MAX / 4, True,
+                       AnyPropertyType, &type, &format, &count, &bytesAfter,
+                       &data);
+    if (data == nullptr)
+        return;
+
+    if (type == incrAtom) {
+        // large transfers are not supported, the cache keeps the old text
+    } else if (target == timestampAtom) {
+        unsigned long timestamp = 0;
+        if (format == 32 && count > 0)
+            timestamp = *reinterpret_cast<unsigned long *>(data);
+        if (timestamp == 0) {
+            timestampSupported = false;
+        } else if (timestamp != lastTimestamp) {
+            lastTimestamp = timestamp;
+            convert(utf8Atom);
+        }
+    } else if (format == 8) {
+        std::lock_guard<std::mutex> lock(*mutex);
+        text.assign(reinterpret_cast<const char *>(data), count);
+        hasText = true;
+    }
+    XFree(data);
+}
+
+void ImgClipboard::X11Service::convert(Atom target) {
+    XConvertSelection(display, clipboardAtom, target, propertyAtom, window,
+                      CurrentTime);
+    pendingTarget = target;
+    pendingSince = std::chrono::steady_clock::now();
+}
+#endif
+
+ImgClipboard &ImgClipboard::Get() {
+    static ImgClipboard clipboard;
+    return clipboard;
+}
+
+ImgClipboard::~ImgClipboard() {
+    Shutdown();
+}
+
+void ImgClipboard::SetBackend(Backend inBackend) {
+    if (inBackend == Memory)
+        Shutdown();
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBackend = inBackend;
+}
+
+ImgClipboard::Backend ImgClipboard::GetBackend() const {
+    return mBackend;
+}
+
+void ImgClipboard::SetTimeout(float inSeconds) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTimeout = inSeconds;
+#if LIN
+    if (mService != nullptr)
+        mService->timeout = inSeconds;
+#endif
+}
+
+bool ImgClipboard::GetText(std::string &outText) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mBackend == Native) {
+#if IBM || APL
+        return getNativeText(outText);
+#endif
+#if LIN
+        if (startService()) {
+            // the text may have changed since the last poll, the next
+            // access gets the fresh one
+            mService->refreshRequest = true;
+            mService->wake();
+            outText = mService->text;
+            return mService->hasText;
+        }
+        mBackend = Memory;
+#endif
+    }
+    outText = mMemoryText;
+    return !mMemoryText.empty();
+}
+
+bool ImgClipboard::SetText(const std::string &inText) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mBackend == Native) {
+#if IBM || APL
+        return setNativeText(inText);
+#endif
+#if LIN
+        if (startService()) {
+            mService->text = inText;
+            mService->hasText = true;
+            mService->ownRequest = true;
+            mService->wake();
+            return true;
+        }
+        mBackend = Memory;
+#endif
+    }
+    mMemoryText = inText;
+    return true;
+}
+
+void ImgClipboard::Shutdown() {
+#if LIN
+    X11Service *service;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        service = mService;
+        mService = nullptr;
+        if (service == nullptr)
+            return;
+        service->quit = true;
+    }
+    service->wake();
+    service->thread.join();
+
+    XDestroyWindow(service->display, service->window);
+    XCloseDisplay(service->display);
+    close(service->wakePipe[0]);
+    close(service->wakePipe[1]);
+    delete service;
+#endif
+}
+
+bool ImgClipboard::startService() {
+#if LIN
+    if (mService != nullptr)
+        return true;
+
+    Display *display = XOpenDisplay(nullptr);
+    if (display == nullptr)
+        return false;
+
+    auto service = new X11Service();
+    if (pipe(service->wakePipe) != 0) {
+        XCloseDisplay(display);
+        delete service;
+        return false;
+    }
+    fcntl(service->wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(service->wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    // an unmapped window to own the selection and receive the transfers
+    int black = BlackPixel(display, DefaultScreen(display));
+    Window root = XDefaultRootWindow(display);
+    service->display = display;
+    service->window = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0,
+                                          black, black);
+    service->clipboardAtom = XInternAtom(display, "CLIPBOARD", False);
+    service->utf8Atom = XInternAtom(display, "UTF8_STRING", False);
+    service->targetsAtom = XInternAtom(display, "TARGETS", False);
+    service->timestampAtom = XInternAtom(display, "TIMESTAMP", False);
+    service->textAtom = XInternAtom(display, "TEXT", False);
+    service->incrAtom = XInternAtom(display, "INCR", False);
+    service->propertyAtom = XInternAtom(display, "IMGX_CLIPBOARD", False);
+    service->mutex = &mMutex;
+    service->timeout = mTimeout;
+    XFlush(display);
+
+    // the display is used by the thread only from now on
+    service->thread = std::thread(&X11Service::run, service);
+    mService = service;
+#endif
+    return true;
+}
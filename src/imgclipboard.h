@@ -0,0 +1,95 @@
+/*
+ * imgclipboard.h
+ *
+ * Clipboard access for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGCLIPBOARD_H
+#define IMGCLIPBOARD_H
+
+#include <mutex>
+#include <string>
+
+/// \file
+/// This file contains the declaration of the ImgClipboard class
+/// \brief ImgClipboard gives ImgWindow access to the system clipboard
+/// without stalling the sim thread.
+///
+/// On Windows and Mac OS the system clipboard is read and written directly,
+/// both are quick local calls. X11 has no clipboard storage: the text lives
+/// in the application owning the CLIPBOARD selection and is transferred
+/// with events. On Linux a background thread keeps a connection to the X
+/// server, owns the selection for text copied in X-Plane, answers the
+/// requests of other applications and polls the selection so the latest
+/// text is cached. GetText() and SetText() only touch the cache and return
+/// immediately.
+///
+/// The Memory backend keeps the text inside the plugin. It is used when
+/// there is no X server and can be selected to run without a clipboard
+/// owner, e.g. under Xvfb.
+class ImgClipboard {
+public:
+    /// Clipboard storage
+    enum Backend {
+        /// system clipboard
+        Native,
+        /// text kept in the plugin
+        Memory
+    };
+
+    /// Returns the clipboard of the plugin
+    static ImgClipboard &Get();
+
+    ImgClipboard(const ImgClipboard &) = delete;
+    ImgClipboard &operator=(const ImgClipboard &) = delete;
+
+    /// Selects the clipboard storage, the text is kept
+    /// \param inBackend backend to use
+    void SetBackend(Backend inBackend);
+
+    /// Returns the backend in use, which is Memory if the system clipboard
+    /// is not available
+    /// \return backend in use
+    Backend GetBackend() const;
+
+    /// Sets how long to wait for another application to deliver the
+    /// clipboard text before the transfer is abandoned
+    /// \param inSeconds timeout in seconds
+    void SetTimeout(float inSeconds);
+
+    /// Returns the clipboard text. On Linux this is the last text received
+    /// by the background thread, which is asked to refresh it.
+    /// \param outText clipboard text
+    /// \return false if there is no text
+    bool GetText(std::string &outText);
+
+    /// Puts text into the clipboard
+    /// \param inText text to set
+    /// \return false if the clipboard can't be written
+    bool SetText(const std::string &inText);
+
+    /// Stops the background thread and gives up the clipboard ownership.
+    /// The thread is restarted by the next clipboard access.
+    void Shutdown();
+
+private:
+    ImgClipboard() = default;
+    ~ImgClipboard();
+
+    struct X11Service;
+
+    // starts the background thread on Linux, returns false if there is no
+    // X server
+    bool startService();
+
+    Backend mBackend = Native;
+    float mTimeout = 1.0f;
+
+    /// Text of the Memory backend
+    std::string mMemoryText;
+
+    std::mutex mMutex;
+    X11Service *mService = nullptr;
+};
+
+#endif //IMGCLIPBOARD_H
@@ -0,0 +1,330 @@
+/*
+ * imgdataref.cpp
+ *
+ * Cached dataref bindings for ImGui widgets.
+ */
+
+#include "imgdataref.h"
+#include "imgdispatcher.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+
+/// \file
+/// This file contains the definition of the ImgDataRefCache class, the
+/// dataref bindings and the ImgWidgets helpers
+
+ImgDataRefCache &ImgDataRefCache::Get() {
+    static ImgDataRefCache cache;
+    return cache;
+}
+
+ImgDataRefCache::Stats ImgDataRefCache::GetStats() const {
+    Stats stats;
+    stats.gets = mGets.load(std::memory_order_relaxed);
+    stats.reads = mReads.load(std::memory_order_relaxed);
+    stats.sets = mSets.load(std::memory_order_relaxed);
+    stats.writes = mWrites.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ImgDataRefCache::ResetStats() {
+    mGets = 0;
+    mReads = 0;
+    mSets = 0;
+    mWrites = 0;
+}
+
+int ImgDataRefCache::GetEntryCount() const {
+    return static_cast<int>(mEntries.size());
+}
+
+ImgDataRefCache::Entry *ImgDataRefCache::acquire(const std::string &name,
+                                                 int count) {
+    count = std::max(count, 1);
+    for (auto &entry : mEntries) {
+        if (entry->name != name)
+            continue;
+        entry->users++;
+        bool isArray = entry->type == xplmType_FloatArray ||
+                       entry->type == xplmType_IntArray;
+        if (isArray && count > entry->count) {
+            std::lock_guard<std::mutex> lock(mWriteMutex);
+            entry->count = count;
+            entry->values.resize(count, 0.0);
+            entry->pending.resize(count, 0.0);
+            entry->pendingMask.resize(count, false);
+        }
+        return entry.get();
+    }
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->name = name;
+    entry->ref = XPLMFindDataRef(name.c_str());
+    entry->type = xplmType_Unknown;
+    entry->writable = false;
+    entry->users = 1;
+    if (entry->ref != nullptr) {
+        XPLMDataTypeID types = XPLMGetDataRefTypes(entry->ref);
+        // scalars are read as double if possible, which holds int and
+        // float values exactly
+        const XPLMDataTypeID preferred[] = {
+            xplmType_Double, xplmType_Float, xplmType_Int,
+            xplmType_FloatArray, xplmType_IntArray
+        };
+        for (XPLMDataTypeID type : preferred) {
+            bool isArray = type == xplmType_FloatArray || type == xplmType_IntArray;
+            if ((types & type) != 0 && (isArray || count == 1)) {
+                entry->type = type;
+                break;
+            }
+        }
+        entry->writable = XPLMCanWriteDataRef(entry->ref) != 0;
+    }
+    bool isArray = entry->type == xplmType_FloatArray ||
+                   entry->type == xplmType_IntArray;
+    entry->count = isArray ? count : 1;
+    entry->values.assign(entry->count, 0.0);
+    entry->pending.assign(entry->count, 0.0);
+    entry->pendingMask.assign(entry->count, false);
+    entry->hasPending = false;
+    mEntries.push_back(std::move(entry));
+
+    // the binding may be read before the next frame updates the snapshot
+    Entry *added = mEntries.back().get();
+    update(added);
+    return added;
+}
+
+void ImgDataRefCache::release(Entry *entry) {
+    if (--entry->users > 0)
+        return;
+    // pending writes of the last binding are still flushed
+    if (entry->hasPending)
+        flush();
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                  [entry](const std::unique_ptr<Entry> &e) {
+                                      return e.get() == entry;
+                                  }),
+                   mEntries.end());
+}
+
+void ImgDataRefCache::update() {
+    for (auto &entry : mEntries)
+        update(entry.get());
+}
+
+void ImgDataRefCache::update(Entry *entry) {
+    switch (entry->type) {
+    case xplmType_Int:
+        entry->values[0] = XPLMGetDatai(entry->ref);
+        break;
+    case xplmType_Float:
+        entry->values[0] = XPLMGetDataf(entry->ref);
+        break;
+    case xplmType_Double:
+        entry->values[0] = XPLMGetDatad(entry->ref);
+        break;
+    case xplmType_FloatArray: {
+        mFloats.resize(entry->count);
+        int read = XPLMGetDatavf(entry->ref, mFloats.data(), 0, entry->count);
+        for (int i = 0; i < entry->count; i++)
+            entry->values[i] = i < read ? mFloats[i] : 0.0;
+        break;
+    }
+    case xplmType_IntArray: {
+        mInts.resize(entry->count);
+        int read = XPLMGetDatavi(entry->ref, mInts.data(), 0, entry->count);
+        for (int i = 0; i < entry->count; i++)
+            entry->values[i] = i < read ? mInts[i] : 0.0;
+        break;
+    }
+    default:
+        return;
+    }
+    mReads.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ImgDataRefCache::set(Entry *entry, int index, double value) {
+    mSets.fetch_add(1, std::memory_order_relaxed);
+    if (!entry->writable || index < 0 || index >= entry->count)
+        return;
+
+    bool post;
+    {
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        entry->pending[index] = value;
+        entry->pendingMask[index] = true;
+        entry->hasPending = true;
+        post = !mFlushPosted;
+        mFlushPosted = true;
+    }
+    if (post)
+        ImgDispatcher::Get().Post([this] { flush(); });
+}
+
+void ImgDataRefCache::flush() {
+    struct Write {
+        Entry *entry;
+        int offset;
+        std::vector<double> values;
+    };
+    std::vector<Write> writes;
+    {
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        mFlushPosted = false;
+        for (auto &entry : mEntries) {
+            if (!entry->hasPending)
+                continue;
+            // one write per run of consecutive set elements
+            for (int i = 0; i < entry->count; i++) {
+                if (!entry->pendingMask[i])
+                    continue;
+                Write write = {entry.get(), i, {}};
+                while (i < entry->count && entry->pendingMask[i]) {
+                    write.values.push_back(entry->pending[i]);
+                    entry->pendingMask[i] = false;
+                    i++;
+                }
+                writes.push_back(std::move(write));
+            }
+            entry->hasPending = false;
+        }
+    }
+
+    // XPLM is called without the lock, so Set() on a build worker never
+    // waits for a dataref accessor
+    for (Write &write : writes) {
+        Entry *entry = write.entry;
+        auto count = static_cast<int>(write.values.size());
+        switch (entry->type) {
+        case xplmType_Int:
+            XPLMSetDatai(entry->ref, static_cast<int>(write.values[0]));
+            break;
+        case xplmType_Float:
+            XPLMSetDataf(entry->ref, static_cast<float>(write.values[0]));
+            break;
+        case xplmType_Double:
+            XPLMSetDatad(entry->ref, write.values[0]);
+            break;
+        case xplmType_FloatArray:
+            mFloats.assign(write.values.begin(), write.values.end());
+            XPLMSetDatavf(entry->ref, mFloats.data(), write.offset, count);
+            break;
+        case xplmType_IntArray:
+            mInts.resize(count);
+            for (int i = 0; i < count; i++)
+                mInts[i] = static_cast<int>(write.values[i]);
+            XPLMSetDatavi(entry->ref, mInts.data(), write.offset, count);
+            break;
+        default:
+            continue;
+        }
+        mWrites.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ImgDataRefBinding::ImgDataRefBinding(const std::string &name, int count) :
+    mEntry(ImgDataRefCache::Get().acquire(name, count)) {
+}
+
+ImgDataRefBinding::~ImgDataRefBinding() {
+    ImgDataRefCache::Get().release(mEntry);
+}
+
+bool ImgDataRefBinding::IsValid() const {
+    return mEntry->type != xplmType_Unknown;
+}
+
+bool ImgDataRefBinding::IsWritable() const {
+    return mEntry->writable;
+}
+
+const std::string &ImgDataRefBinding::GetName() const {
+    return mEntry->name;
+}
+
+double ImgDataRefBinding::getValue(int index) const {
+    ImgDataRefCache::Get().mGets.fetch_add(1, std::memory_order_relaxed);
+    if (index < 0 || index >= mEntry->count)
+        return 0.0;
+    return mEntry->values[index];
+}
+
+void ImgDataRefBinding::setValue(int index, double value) {
+    ImgDataRefCache::Get().set(mEntry, index, value);
+}
+
+namespace ImgWidgets {
+
+bool SliderFloat(const char *label, ImgDataRef<float> &dataRef, float min,
+                 float max, const char *format) {
+    float value = dataRef.Get();
+    if (!ImGui::SliderFloat(label, &value, min, max, format))
+        return false;
+    dataRef.Set(value);
+    return true;
+}
+
+bool DragFloat(const char *label, ImgDataRef<float> &dataRef, float speed,
+               float min, float max, const char *format) {
+    float value = dataRef.Get();
+    if (!ImGui::DragFloat(label, &value, speed, min, max, format))
+        return false;
+    dataRef.Set(value);
+    return true;
+}
+
+bool InputFloat(const char *label, ImgDataRef<float> &dataRef,
+                const char *format) {
+    float value = dataRef.Get();
+    if (!ImGui::InputFloat(label, &value, 0.0f, 0.0f, format))
+        return false;
+    dataRef.Set(value);
+    return true;
+}
+
+bool SliderInt(const char *label, ImgDataRef<int> &dataRef, int min, int max) {
+    int value = dataRef.Get();
+    if (!ImGui::SliderInt(label, &value, min, max))
+        return false;
+    dataRef.Set(value);
+    return true;
+}
+
+bool InputInt(const char *label, ImgDataRef<int> &dataRef) {
+    int value = dataRef.Get();
+    if (!ImGui::InputInt(label, &value))
+        return false;
+    dataRef.Set(value);
+    return true;
+}
+
+bool Checkbox(const char *label, ImgDataRef<int> &dataRef) {
+    bool value = dataRef.Get() != 0;
+    if (!ImGui::Checkbox(label, &value))
+        return false;
+    dataRef.Set(value ? 1 : 0);
+    return true;
+}
+
+bool SliderFloat(const char *label, ImgDataRefArray<float> &dataRef,
+                 int index, float min, float max, const char *format) {
+    float value = dataRef.Get(index);
+    if (!ImGui::SliderFloat(label, &value, min, max, format))
+        return false;
+    dataRef.Set(index, value);
+    return true;
+}
+
+void Value(const char *label, const ImgDataRef<float> &dataRef,
+           const char *format) {
+    ImGui::Value(label, dataRef.Get(), format);
+}
+
+void Value(const char *label, const ImgDataRef<int> &dataRef) {
+    ImGui::Value(label, dataRef.Get());
+}
+
+}
@@ -0,0 +1,240 @@
+/*
+ * imgdataref.h
+ *
+ * Cached dataref bindings for ImGui widgets.
+ */
+
+#ifndef IMGDATAREF_H
+#define IMGDATAREF_H
+
+#include "XPLMDataAccess.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgDataRefCache class, the
+/// ImgDataRef and ImgDataRefArray bindings and the ImgWidgets helpers
+/// \brief Windows read datarefs from a snapshot taken once per frame and
+/// their writes are coalesced.
+///
+/// A binding resolves its dataref once when it is created, bindings of the
+/// same dataref share one cache entry. At the start of every frame, before
+/// the windows are built, ImgFrame reads all bound datarefs in one batch
+/// into the snapshot. Get() returns the snapshot value, so any number of
+/// windows reading a dataref cost one XPLM call per frame, and reading is
+/// safe from the build workers of the parallel build.
+///
+/// Set() only records the value. The last value per dataref element is
+/// written by one ImgDispatcher command in the next flight loop, so a
+/// slider dragged over many events writes once per frame. The snapshot
+/// shows the written value from the next frame on.
+///
+/// Bindings must be created and destroyed on the sim thread, Get() and
+/// Set() may be called on any thread.
+class ImgDataRefCache {
+    friend class ImgDataRefBinding;
+    friend class ImgFrame;
+public:
+    /// XPLM calls made and saved by the cache
+    struct Stats {
+        /// values returned by Get()
+        unsigned long gets;
+        /// XPLM calls reading the snapshot
+        unsigned long reads;
+        /// calls of Set()
+        unsigned long sets;
+        /// XPLM calls writing coalesced values
+        unsigned long writes;
+    };
+
+    /// Returns the cache of the plugin
+    static ImgDataRefCache &Get();
+
+    ImgDataRefCache(const ImgDataRefCache &) = delete;
+    ImgDataRefCache &operator=(const ImgDataRefCache &) = delete;
+
+    /// Returns the counters since the start or the last ResetStats().
+    /// gets - reads and sets - writes are the XPLM calls saved.
+    /// \return call counters
+    Stats GetStats() const;
+
+    /// Resets the counters
+    void ResetStats();
+
+    /// Returns the number of datarefs in the snapshot
+    /// \return bound datarefs
+    int GetEntryCount() const;
+
+private:
+    struct Entry {
+        std::string name;
+        XPLMDataRef ref;
+        /// Native type used to access the dataref
+        XPLMDataTypeID type;
+        bool writable;
+        int count;
+        int users;
+        /// Snapshot of the frame
+        std::vector<double> values;
+        /// Values set since the last flush, guarded by mWriteMutex
+        std::vector<double> pending;
+        std::vector<bool> pendingMask;
+        bool hasPending;
+    };
+
+    ImgDataRefCache() = default;
+
+    Entry *acquire(const std::string &name, int count);
+
+    void release(Entry *entry);
+
+    // reads the snapshot of all entries, called at the start of the frame
+    void update();
+
+    void update(Entry *entry);
+
+    // writes the coalesced values, runs on the dispatcher
+    void flush();
+
+    void set(Entry *entry, int index, double value);
+
+    std::vector<std::unique_ptr<Entry>> mEntries;
+    /// Conversion buffers of the array reads
+    std::vector<float> mFloats;
+    std::vector<int> mInts;
+
+    std::mutex mWriteMutex;
+    bool mFlushPosted = false;
+
+    std::atomic<unsigned long> mGets{0};
+    std::atomic<unsigned long> mSets{0};
+    std::atomic<unsigned long> mReads{0};
+    std::atomic<unsigned long> mWrites{0};
+};
+
+/// Untyped binding to an entry of ImgDataRefCache
+class ImgDataRefBinding {
+public:
+    /// Returns true if the dataref exists
+    /// \return true if the dataref was found
+    bool IsValid() const;
+
+    /// Returns true if the dataref can be written
+    /// \return true if the dataref is writable
+    bool IsWritable() const;
+
+    /// Returns the name of the dataref
+    /// \return dataref name
+    const std::string &GetName() const;
+
+protected:
+    ImgDataRefBinding(const std::string &name, int count);
+    ~ImgDataRefBinding();
+
+    ImgDataRefBinding(const ImgDataRefBinding &) = delete;
+    ImgDataRefBinding &operator=(const ImgDataRefBinding &) = delete;
+
+    double getValue(int index) const;
+
+    void setValue(int index, double value);
+
+    ImgDataRefCache::Entry *mEntry;
+};
+
+/// Binding to a scalar dataref, T is int, float or double
+template<typename T>
+class ImgDataRef : public ImgDataRefBinding {
+public:
+    /// Finds the dataref
+    /// \param name dataref name
+    explicit ImgDataRef(const std::string &name) :
+        ImgDataRefBinding(name, 1) {
+    }
+
+    /// Returns the value read at the start of the frame
+    /// \return dataref value, 0 if the dataref doesn't exist
+    T Get() const {
+        return static_cast<T>(getValue(0));
+    }
+
+    /// Writes a value in the next flight loop
+    /// \param value value to write
+    void Set(T value) {
+        setValue(0, static_cast<double>(value));
+    }
+};
+
+/// Binding to the first elements of an array dataref, T is int or float
+template<typename T>
+class ImgDataRefArray : public ImgDataRefBinding {
+public:
+    /// Finds the dataref
+    /// \param name dataref name
+    /// \param count number of elements kept in the snapshot
+    ImgDataRefArray(const std::string &name, int count) :
+        ImgDataRefBinding(name, count), mCount(count) {
+    }
+
+    /// Returns the number of elements
+    /// \return element count
+    int GetCount() const {
+        return mCount;
+    }
+
+    /// Returns an element read at the start of the frame
+    /// \param index element index
+    /// \return element value, 0 if the dataref doesn't exist
+    T Get(int index) const {
+        return static_cast<T>(getValue(index));
+    }
+
+    /// Writes an element in the next flight loop
+    /// \param index element index
+    /// \param value value to write
+    void Set(int index, T value) {
+        setValue(index, static_cast<double>(value));
+    }
+
+private:
+    int mCount;
+};
+
+/// ImGui widgets bound to datarefs, they show the snapshot value and set
+/// the dataref when the user changes it
+namespace ImgWidgets {
+
+bool SliderFloat(const char *label, ImgDataRef<float> &dataRef, float min,
+                 float max, const char *format = "%.3f");
+
+bool DragFloat(const char *label, ImgDataRef<float> &dataRef,
+               float speed = 1.0f, float min = 0.0f, float max = 0.0f,
+               const char *format = "%.3f");
+
+bool InputFloat(const char *label, ImgDataRef<float> &dataRef,
+                const char *format = "%.3f");
+
+bool SliderInt(const char *label, ImgDataRef<int> &dataRef, int min, int max);
+
+bool InputInt(const char *label, ImgDataRef<int> &dataRef);
+
+/// Checkbox of an int dataref used as a switch, 0 is off
+bool Checkbox(const char *label, ImgDataRef<int> &dataRef);
+
+/// Slider of one element of an array dataref
+bool SliderFloat(const char *label, ImgDataRefArray<float> &dataRef,
+                 int index, float min, float max,
+                 const char *format = "%.3f");
+
+/// Label and value of a dataref, read only
+void Value(const char *label, const ImgDataRef<float> &dataRef,
+           const char *format = "%.3f");
+
+void Value(const char *label, const ImgDataRef<int> &dataRef);
+
+}
+
+#endif //IMGDATAREF_H
@@ -0,0 +1,186 @@
+/*
+ * imgdispatcher.cpp
+ *
+ * Deferred execution of window operations on the sim thread.
+ */
+
+#include "imgdispatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+/// \file
+/// This file contains the definition of the ImgDispatcher class
+
+// Interval of the flight loop polling for commands of other threads
+static const float gRemotePollInterval = 0.25f;
+
+// Polling slows down once other threads posted nothing for this long
+static const float gRemotePollTime = 10.0f;
+
+// Interval of the flight loop polling while other threads are quiet, it
+// keeps running so a command posted while all windows are hidden runs
+static const float gIdlePollInterval = 1.0f;
+
+// Shortest interval of the flight loop for due delayed commands
+static const float gMinDelay = 0.01f;
+
+ImgDispatcher &ImgDispatcher::Get() {
+    static ImgDispatcher dispatcher;
+    return dispatcher;
+}
+
+void ImgDispatcher::Post(std::function<void()> command, ImgWindow *owner) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Command queued = {std::move(command), owner};
+        mQueue.push_back(std::move(queued));
+    }
+    if (std::this_thread::get_id() == mSimThread)
+        schedule();
+    else
+        mRemotePending.store(true, std::memory_order_release);
+}
+
+void ImgDispatcher::PostDelayed(float delay, std::function<void()> command,
+                                ImgWindow *owner) {
+    DelayedCommand delayed = {XPLMGetElapsedTime() + delay, {std::move(command), owner}};
+    mDelayed.push_back(std::move(delayed));
+    // a flight loop scheduled for the next cycle sets its next interval
+    // itself when it returns
+    if (mFlightLoop != nullptr && !mScheduled)
+        XPLMScheduleFlightLoop(mFlightLoop, nextInterval(), true);
+}
+
+void ImgDispatcher::Cancel(ImgWindow *owner) {
+    mDelayed.erase(std::remove_if(mDelayed.begin(), mDelayed.end(),
+                                  [owner](const DelayedCommand &delayed) {
+                                      return delayed.command.owner == owner;
+                                  }),
+                   mDelayed.end());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<Command> kept;
+        for (Command &command : mQueue) {
+            if (command.owner != owner)
+                kept.push_back(std::move(command));
+        }
+        mQueue.swap(kept);
+    }
+    // the window may be deleted by a command of the running flight loop
+    for (Command &command : mRunning) {
+        if (command.owner == owner)
+            command.function = nullptr;
+    }
+}
+
+size_t ImgDispatcher::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size();
+}
+
+void ImgDispatcher::start() {
+    mSimThread = std::this_thread::get_id();
+    if (mFlightLoop != nullptr)
+        return;
+
+    XPLMCreateFlightLoop_t flightLoopParameters = {
+        sizeof(flightLoopParameters),
+        xplm_FlightLoop_Phase_AfterFlightModel,
+        flightLoopCB,
+        this
+    };
+    mFlightLoop = XPLMCreateFlightLoop(&flightLoopParameters);
+    mScheduled = false;
+    // commands posted before the first window
+    if (GetPendingCount() > 0 || mRemoteUsed)
+        schedule();
+    else
+        XPLMScheduleFlightLoop(mFlightLoop, nextInterval(), true);
+}
+
+void ImgDispatcher::shutdown() {
+    if (mFlightLoop == nullptr)
+        return;
+    XPLMDestroyFlightLoop(mFlightLoop);
+    mFlightLoop = nullptr;
+    mScheduled = false;
+}
+
+void ImgDispatcher::poll() {
+    if (pollRemote())
+        schedule();
+}
+
+bool ImgDispatcher::pollRemote() {
+    if (!mRemotePending.exchange(false, std::memory_order_acquire))
+        return false;
+    mRemoteUsed = true;
+    mLastRemoteTime = XPLMGetElapsedTime();
+    return true;
+}
+
+void ImgDispatcher::schedule() {
+    if (mFlightLoop == nullptr || mScheduled)
+        return;
+    XPLMScheduleFlightLoop(mFlightLoop, -1.0f, true);
+    mScheduled = true;
+}
+
+float ImgDispatcher::run() {
+    mScheduled = false;
+    pollRemote();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning.swap(mQueue);
+    }
+    // due delayed commands run after the queued ones
+    float now = XPLMGetElapsedTime();
+    for (auto it = mDelayed.begin(); it != mDelayed.end();) {
+        if (it->due <= now) {
+            mRunning.push_back(std::move(it->command));
+            it = mDelayed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (Command &command : mRunning) {
+        if (!command.function)
+            continue;
+        // Cancel() resets the commands of a window deleted by this one
+        std::function<void()> function = std::move(command.function);
+        command.function = nullptr;
+        function();
+    }
+    mRunning.clear();
+
+    // the last window may have been deleted by a command
+    if (mFlightLoop == nullptr)
+        return 0.0f;
+    if (GetPendingCount() > 0) {
+        mScheduled = true;
+        return -1.0f;
+    }
+    // the queue is drained, other threads posting again soon are likely
+    if (mRemoteUsed && XPLMGetElapsedTime() - mLastRemoteTime > gRemotePollTime)
+        mRemoteUsed = false;
+    return nextInterval();
+}
+
+float ImgDispatcher::nextInterval() const {
+    float interval = mRemoteUsed ? gRemotePollInterval : gIdlePollInterval;
+    float now = XPLMGetElapsedTime();
+    for (const DelayedCommand &delayed : mDelayed) {
+        // a positive interval, 0 would unschedule the flight loop
+        float wait = std::max(delayed.due - now, gMinDelay);
+        interval = std::min(interval, wait);
+    }
+    return interval;
+}
+
+float ImgDispatcher::flightLoopCB(float inElapsedSinceLastCall,
+                                  float inElapsedTimeSinceLastFlightLoop,
+                                  int inCounter, void *inRefcon) {
+    return reinterpret_cast<ImgDispatcher *>(inRefcon)->run();
+}
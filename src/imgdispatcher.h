@@ -0,0 +1,129 @@
+/*
+ * imgdispatcher.h
+ *
+ * Deferred execution of window operations on the sim thread.
+ */
+
+#ifndef IMGDISPATCHER_H
+#define IMGDISPATCHER_H
+
+#include "XPLMProcessing.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ImgWindow;
+
+/// \file
+/// This file contains the declaration of the ImgDispatcher class
+/// \brief ImgDispatcher runs queued commands on the sim thread outside of
+/// the draw callbacks.
+///
+/// Windows must not be deleted, hidden or resized while they are built, so
+/// the Safe* methods of ImgWindow queue the operation instead. All commands
+/// of the plugin go through one flight loop, which runs them in the order
+/// they were posted.
+///
+/// Commands may be posted from any thread. A command posted on the sim
+/// thread runs in the next flight loop. A command posted on another thread
+/// is noticed by the next draw callback of an ImgWindow, and since the
+/// windows may all be hidden, the flight loop also polls the queue as long
+/// as the dispatcher runs: a few times per second while other threads post
+/// and once per second after they posted nothing for ten seconds.
+class ImgDispatcher {
+    friend class ImgFrame;
+    friend class ImgWindow;
+public:
+    /// Returns the dispatcher of the plugin
+    static ImgDispatcher &Get();
+
+    ImgDispatcher(const ImgDispatcher &) = delete;
+    ImgDispatcher &operator=(const ImgDispatcher &) = delete;
+
+    /// Queues a command, any thread
+    /// \param command function to run on the sim thread
+    /// \param owner window the command belongs to, the command is dropped
+    /// if the window is deleted first; nullptr for commands of the plugin
+    void Post(std::function<void()> command, ImgWindow *owner = nullptr);
+
+    /// Queues a command that runs once a delay has passed, sim thread
+    /// only. The flight loop is scheduled for the earliest delayed command,
+    /// so it runs while all windows are hidden.
+    /// \param delay seconds to wait
+    /// \param command function to run on the sim thread
+    /// \param owner window the command belongs to, see Post()
+    void PostDelayed(float delay, std::function<void()> command,
+                     ImgWindow *owner = nullptr);
+
+    /// Drops the queued commands of a window, sim thread only
+    /// \param owner window whose commands are dropped
+    void Cancel(ImgWindow *owner);
+
+    /// Returns the number of queued commands
+    /// \return queued commands
+    size_t GetPendingCount() const;
+
+private:
+    ImgDispatcher() = default;
+
+    // creates the flight loop, called by every new window on the sim thread
+    void start();
+
+    // destroys the flight loop, called with the last window
+    void shutdown();
+
+    // schedules the flight loop if another thread posted, called once per
+    // frame from the draw callbacks
+    void poll();
+
+    // takes note of commands posted by other threads, returns true if
+    // there are new ones
+    bool pollRemote();
+
+    void schedule();
+
+    float run();
+
+    // returns the seconds until the flight loop must run for delayed
+    // commands or polling
+    float nextInterval() const;
+
+    static float flightLoopCB(float inElapsedSinceLastCall,
+                              float inElapsedTimeSinceLastFlightLoop,
+                              int inCounter, void *inRefcon);
+
+    struct Command {
+        std::function<void()> function;
+        ImgWindow *owner;
+    };
+
+    mutable std::mutex mMutex;
+    /// Commands waiting for the flight loop, guarded by mMutex
+    std::vector<Command> mQueue;
+    /// Commands of the running flight loop, sim thread only
+    std::vector<Command> mRunning;
+
+    struct DelayedCommand {
+        /// elapsed sim time the command is due
+        float due;
+        Command command;
+    };
+    /// Commands posted with PostDelayed(), sim thread only
+    std::vector<DelayedCommand> mDelayed;
+
+    std::thread::id mSimThread;
+    XPLMFlightLoopID mFlightLoop = nullptr;
+    /// Flight loop is scheduled for the next cycle
+    bool mScheduled = false;
+    /// A command came from another thread recently, the queue is polled
+    /// at the faster rate
+    bool mRemoteUsed = false;
+    /// Elapsed sim time another thread was last noticed posting
+    float mLastRemoteTime = 0.0f;
+    std::atomic<bool> mRemotePending{false};
+};
+
+#endif //IMGDISPATCHER_H
@@ -0,0 +1,164 @@
+/*
+ * imgdrawbatch.cpp
+ *
+ * Draw command optimizer for the dear imgui integration into X-Plane.
+ */
+
+#include "imgdrawbatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+/// \file
+/// This file contains the definition of the ImgDrawBatcher class
+
+void ImgDrawBatcher::Build(const ImDrawData *drawData,
+                           const float transform[16], const int viewport[4]) {
+    mBatches.clear();
+    mLists.clear();
+    mX1.clear();
+    mY1.clear();
+    mX2.clear();
+    mY2.clear();
+    mCulled = 0;
+
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList *cmd_list = drawData->CmdLists[n];
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++) {
+            const ImVec4 &clip = cmd_list->CmdBuffer[cmd_i].ClipRect;
+            mX1.push_back(clip.x);
+            mY1.push_back(clip.y);
+            mX2.push_back(clip.z);
+            mY2.push_back(clip.w);
+        }
+    }
+    mCommandsIn = static_cast<int>(mX1.size());
+
+    transformClipRects(transform, viewport);
+
+    int rect = 0;
+    unsigned int vtxOffset = 0, idxOffset = 0;
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList *cmd_list = drawData->CmdLists[n];
+        ImgDrawBatchList list;
+        list.cmdList = cmd_list;
+        list.vtxOffset = vtxOffset;
+        list.idxOffset = idxOffset;
+        list.firstBatch = static_cast<int>(mBatches.size());
+
+        unsigned int cmdIdxOffset = 0;
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++, rect++) {
+            const ImDrawCmd *pcmd = &cmd_list->CmdBuffer[cmd_i];
+            unsigned int first = cmdIdxOffset;
+            cmdIdxOffset += pcmd->ElemCount;
+
+            ImgDrawBatch batch;
+            batch.textureId = pcmd->TextureId;
+            batch.idxOffset = first;
+            batch.elemCount = pcmd->ElemCount;
+            batch.callback = pcmd->UserCallback ? pcmd : nullptr;
+            batch.clipX = static_cast<int>(mX1[rect]);
+            batch.clipY = static_cast<int>(mY1[rect]);
+            batch.clipWidth = static_cast<int>(mX2[rect]) - batch.clipX;
+            batch.clipHeight = static_cast<int>(mY2[rect]) - batch.clipY;
+
+            if (batch.callback == nullptr) {
+                if (batch.elemCount == 0 || batch.clipWidth <= 0 ||
+                        batch.clipHeight <= 0) {
+                    mCulled++;
+                    continue;
+                }
+                // merge into the previous draw call of the list if it is
+                // the same state and the indices are contiguous
+                if (static_cast<int>(mBatches.size()) > list.firstBatch) {
+                    ImgDrawBatch &last = mBatches.back();
+                    if (last.callback == nullptr &&
+                            last.textureId == batch.textureId &&
+                            last.clipX == batch.clipX &&
+                            last.clipY == batch.clipY &&
+                            last.clipWidth == batch.clipWidth &&
+                            last.clipHeight == batch.clipHeight &&
+                            last.idxOffset + last.elemCount == batch.idxOffset) {
+                        last.elemCount += batch.elemCount;
+                        continue;
+                    }
+                }
+            }
+            mBatches.push_back(batch);
+        }
+
+        list.batchCount = static_cast<int>(mBatches.size()) - list.firstBatch;
+        mLists.push_back(list);
+        vtxOffset += cmd_list->VtxBuffer.Size;
+        idxOffset += cmd_list->IdxBuffer.Size;
+    }
+}
+
+void ImgDrawBatcher::transformClipRects(const float m[16],
+                                        const int viewport[4]) {
+    const size_t count = mX1.size();
+    float *x1 = mX1.data(), *y1 = mY1.data(), *x2 = mX2.data(), *y2 = mY2.data();
+    const float vpLeft = static_cast<float>(viewport[0]);
+    const float vpBottom = static_cast<float>(viewport[1]);
+    const float vpRight = vpLeft + viewport[2];
+    const float vpTop = vpBottom + viewport[3];
+    const float halfWidth = 0.5f * viewport[2];
+    const float halfHeight = 0.5f * viewport[3];
+
+    if (m[3] == 0.0f && m[7] == 0.0f && m[15] != 0.0f) {
+        // no perspective: ImGui -> pixels is an affine transform, so it is
+        // folded into six coefficients and applied to all rectangles at once
+        const float w = 1.0f / m[15];
+        const float ax = m[0] * w * halfWidth, bx = m[4] * w * halfWidth;
+        const float cx = (m[12] * w + 1.0f) * halfWidth + vpLeft;
+        const float ay = m[1] * w * halfHeight, by = m[5] * w * halfHeight;
+        const float cy = (m[13] * w + 1.0f) * halfHeight + vpBottom;
+        for (size_t i = 0; i < count; i++) {
+            float px1 = ax * x1[i] + bx * y1[i] + cx;
+            float py1 = ay * x1[i] + by * y1[i] + cy;
+            float px2 = ax * x2[i] + bx * y2[i] + cx;
+            float py2 = ay * x2[i] + by * y2[i] + cy;
+            // ImGui y axis points down, normalize and cull to the viewport
+            x1[i] = std::max(std::min(px1, px2), vpLeft);
+            x2[i] = std::min(std::max(px1, px2), vpRight);
+            y1[i] = std::max(std::min(py1, py2), vpBottom);
+            y2[i] = std::min(std::max(py1, py2), vpTop);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        float px[2], py[2];
+        const float ix[2] = {x1[i], x2[i]}, iy[2] = {y1[i], y2[i]};
+        for (int c = 0; c < 2; c++) {
+            float w = m[3] * ix[c] + m[7] * iy[c] + m[15];
+            w = w != 0.0f ? 1.0f / w : 0.0f;
+            px[c] = ((m[0] * ix[c] + m[4] * iy[c] + m[12]) * w + 1.0f) * halfWidth + vpLeft;
+            py[c] = ((m[1] * ix[c] + m[5] * iy[c] + m[13]) * w + 1.0f) * halfHeight + vpBottom;
+        }
+        x1[i] = std::max(std::min(px[0], px[1]), vpLeft);
+        x2[i] = std::min(std::max(px[0], px[1]), vpRight);
+        y1[i] = std::max(std::min(py[0], py[1]), vpBottom);
+        y2[i] = std::min(std::max(py[0], py[1]), vpTop);
+    }
+}
+
+const std::vector<ImgDrawBatch> &ImgDrawBatcher::Batches() const {
+    return mBatches;
+}
+
+const std::vector<ImgDrawBatchList> &ImgDrawBatcher::Lists() const {
+    return mLists;
+}
+
+int ImgDrawBatcher::CommandsIn() const {
+    return mCommandsIn;
+}
+
+int ImgDrawBatcher::DrawsOut() const {
+    return static_cast<int>(mBatches.size());
+}
+
+int ImgDrawBatcher::Culled() const {
+    return mCulled;
+}
@@ -0,0 +1,91 @@
+/*
+ * imgdrawbatch.h
+ *
+ * Draw command optimizer for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGDRAWBATCH_H
+#define IMGDRAWBATCH_H
+
+#include "imgui.h"
+
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgDrawBatcher class
+/// \brief ImgDrawBatcher turns the command lists of a frame into the minimal
+/// sequence of draw calls for a render target.
+///
+/// All clip rectangles of the frame are transformed into target pixels in
+/// one pass, commands whose clip rectangle is empty or outside of the
+/// viewport are dropped and adjacent commands of a list with the same texture
+/// and the same scissor box are merged into one draw call.
+
+/// Draw call produced from one or more ImDrawCmd
+struct ImgDrawBatch {
+    /// texture to bind
+    ImTextureID textureId;
+    /// scissor box in target pixels
+    int clipX, clipY, clipWidth, clipHeight;
+    /// first index relative to the index buffer of the list
+    unsigned int idxOffset;
+    /// number of indices to draw
+    unsigned int elemCount;
+    /// command with a user callback, nullptr for draw calls
+    const ImDrawCmd *callback;
+};
+
+/// Draw calls of one ImDrawList
+struct ImgDrawBatchList {
+    const ImDrawList *cmdList;
+    /// first vertex and index of the list in the frame
+    unsigned int vtxOffset, idxOffset;
+    /// range of the list draw calls in ImgDrawBatcher::Batches()
+    int firstBatch, batchCount;
+};
+
+class ImgDrawBatcher {
+public:
+    /// Builds the draw calls of a frame
+    /// \param drawData frame to draw
+    /// \param transform column-major matrix from ImGui space to clip space
+    /// \param viewport viewport of the target (x, y, width, height)
+    void Build(const ImDrawData *drawData, const float transform[16],
+               const int viewport[4]);
+
+    /// Returns the draw calls of the last built frame
+    /// \return draw calls of all lists
+    const std::vector<ImgDrawBatch> &Batches() const;
+
+    /// Returns the lists of the last built frame
+    /// \return lists with their draw call ranges
+    const std::vector<ImgDrawBatchList> &Lists() const;
+
+    /// Returns the number of ImDrawCmd in the last built frame
+    /// \return number of commands
+    int CommandsIn() const;
+
+    /// Returns the number of draw calls of the last built frame
+    /// \return number of draw calls and user callbacks
+    int DrawsOut() const;
+
+    /// Returns the number of commands of the last built frame dropped
+    /// because they were clipped away
+    /// \return number of culled commands
+    int Culled() const;
+
+private:
+    void transformClipRects(const float transform[16], const int viewport[4]);
+
+    std::vector<ImgDrawBatch> mBatches;
+    std::vector<ImgDrawBatchList> mLists;
+
+    /// Clip rectangles of all commands, kept separately so the transform
+    /// runs over plain float arrays
+    std::vector<float> mX1, mY1, mX2, mY2;
+
+    int mCommandsIn = 0;
+    int mCulled = 0;
+};
+
+#endif //IMGDRAWBATCH_H
@@ -0,0 +1,162 @@
+/*
+ * imgfontregistry.cpp
+ *
+ * Shared font atlases for the dear imgui integration into X-Plane.
+ */
+
+#include "XPLMUtilities.h"
+
+#include "imgfontregistry.h"
+#include "imgarena.h"
+#include "imgatlascache.h"
+#include "imgglyphcache.h"
+#include "imgiconregistry.h"
+#include "imgui_internal.h"
+#include "imgwindow.h"
+
+#include <cstdio>
+
+/// \file
+/// This file contains the definition of the ImgFontRegistry class
+
+ImgFontRegistry &ImgFontRegistry::Get() {
+    static ImgFontRegistry registry;
+    return registry;
+}
+
+// The glyphs of dynamic atlases before any glyph is requested
+static const ImWchar gAsciiRange[] = {0x0020, 0x007E, 0};
+
+ImgFontRegistry::~ImgFontRegistry() {
+    // there is no OpenGL context at exit anymore, the textures of atlases
+    // never released are gone with X-Plane
+    for (auto &entry : mEntries) {
+        delete entry.second.glyphCache;
+        IM_DELETE(entry.second.atlas);
+    }
+}
+
+void ImgFontRegistry::SetCacheDirectory(const std::string &directory) {
+    mCacheDirectory = directory;
+}
+
+const std::string &ImgFontRegistry::GetCacheDirectory() const {
+    return mCacheDirectory;
+}
+
+void ImgFontRegistry::SetDynamicGlyphs(bool enable, int textureSize) {
+    mDynamicGlyphs = enable;
+    mDynamicTextureSize = textureSize;
+}
+
+ImFontAtlas *ImgFontRegistry::Acquire(const std::vector<std::string> &fontFiles,
+                                      float size) {
+    std::string key = makeKey(fontFiles, size);
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        it->second.refs++;
+        return it->second.atlas;
+    }
+
+    // shared atlases are accounted apart from the window acquiring them
+    ImgArena::Scope scope(&ImgArena::Shared());
+    auto atlas = IM_NEW(ImFontAtlas)();
+    ImFontConfig config;
+    config.SizePixels = size;
+    if (mDynamicGlyphs) {
+        config.GlyphRanges = gAsciiRange;
+        atlas->TexDesiredWidth = mDynamicTextureSize;
+    }
+    for (const std::string &file : fontFiles) {
+        // read here, AddFontFromFileTTF() asserts on a file it can't read
+        size_t dataSize = 0;
+        void *data = ImFileLoadToMemory(file.c_str(), "rb", &dataSize, 0);
+        if (data == nullptr) {
+            XPLMDebugString(("imgx: can't load font " + file + "\n").c_str());
+            continue;
+        }
+        // named like AddFontFromFileTTF() does, the atlas owns the data
+        ImFontConfig fileConfig = config;
+        size_t slash = file.find_last_of("/\\");
+        const char *name = file.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+        ImFormatString(fileConfig.Name, IM_ARRAYSIZE(fileConfig.Name), "%s, %.0fpx", name, size);
+        atlas->AddFontFromMemoryTTF(data, static_cast<int>(dataSize), size, &fileConfig);
+        // the following files add their glyphs to the first font
+        config.MergeMode = true;
+    }
+    if (atlas->Fonts.Size == 0)
+        atlas->AddFontDefault(&config);
+
+    // the icons share the texture with the glyphs
+    ImgIconRegistry &icons = ImgIconRegistry::Get();
+    icons.PrepareAtlas(atlas);
+    // the glyph cache replaces the pixels, it can't keep them in the file
+    ImgAtlasCache cache(mCacheDirectory, atlas);
+    if (!cache.Load(mDynamicGlyphs)) {
+        atlas->Build();
+        icons.RenderIcons(atlas);
+        cache.Save();
+    }
+    // the glyph cache grows the pixels to the full texture before upload
+    ImgGlyphCache *glyphCache = nullptr;
+    if (mDynamicGlyphs)
+        glyphCache = new ImgGlyphCache(atlas, mDynamicTextureSize);
+    ImgWindow::CreateFontTexture(atlas);
+    int width = 0, height = 0;
+    unsigned char *pixels;
+    atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+    // the pixels are in the texture now
+    cache.ReleasePixels();
+    atlas->ClearTexData();
+
+    Entry entry;
+    entry.atlas = atlas;
+    entry.refs = 1;
+    entry.textureBytes = static_cast<size_t>(width) * height;
+    entry.glyphCache = glyphCache;
+    mEntries.insert(std::make_pair(key, entry));
+    return atlas;
+}
+
+void ImgFontRegistry::Release(ImFontAtlas *atlas) {
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->second.atlas != atlas)
+            continue;
+        if (--it->second.refs == 0) {
+            ImgArena::Scope scope(&ImgArena::Shared());
+            delete it->second.glyphCache;
+            ImgWindow::DestroyFontTexture(atlas);
+            ImgIconRegistry::Get().ForgetAtlas(atlas);
+            IM_DELETE(atlas);
+            mEntries.erase(it);
+        }
+        return;
+    }
+}
+
+size_t ImgFontRegistry::GetAtlasCount() const {
+    return mEntries.size();
+}
+
+size_t ImgFontRegistry::GetTextureBytes() const {
+    size_t bytes = 0;
+    for (const auto &entry : mEntries)
+        bytes += entry.second.textureBytes;
+    return bytes;
+}
+
+std::string ImgFontRegistry::makeKey(const std::vector<std::string> &fontFiles,
+                                     float size) const {
+    char sizeStr[32];
+    snprintf(sizeStr, sizeof(sizeStr), "%g", size);
+    std::string key = sizeStr;
+    for (const std::string &file : fontFiles) {
+        // '\n' can't be part of a path
+        key += '\n';
+        key += file;
+    }
+    // a dynamic atlas has other glyphs than a static one of the same fonts
+    if (mDynamicGlyphs)
+        key += "\n*";
+    return key;
+}
@@ -0,0 +1,107 @@
+/*
+ * imgfontregistry.h
+ *
+ * Shared font atlases for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGFONTREGISTRY_H
+#define IMGFONTREGISTRY_H
+
+#include "imgui.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+class ImgGlyphCache;
+
+/// \file
+/// This file contains the declaration of the ImgFontRegistry class
+/// \brief ImgFontRegistry shares font atlases between all ImgWindows of the
+/// plugin.
+///
+/// An atlas is identified by its font files and size. It is built and its
+/// texture uploaded when it is acquired for the first time, further users
+/// get the same atlas. The texture is deleted and the atlas destroyed when
+/// the last user releases it. The icons of ImgIconRegistry are packed into
+/// every atlas. ImgWindow acquires and releases its atlas itself, plugins
+/// only need the registry to share an atlas with their own drawing code.
+///
+/// With dynamic glyphs, atlases are built with ASCII only and a texture
+/// with room for ImgGlyphCache to add the glyphs of other scripts while the
+/// atlas is in use.
+///
+/// With a cache directory set, every atlas built is saved there through
+/// ImgAtlasCache, and the next start of the plugin restores it from the
+/// file instead of rasterizing the fonts again.
+class ImgFontRegistry {
+public:
+    /// Returns the font registry of the plugin
+    static ImgFontRegistry &Get();
+
+    ImgFontRegistry(const ImgFontRegistry &) = delete;
+    ImgFontRegistry &operator=(const ImgFontRegistry &) = delete;
+
+    /// Returns the atlas with the fonts in the given size, building it and
+    /// uploading its texture on first use. Must be called with the X-Plane
+    /// OpenGL context current. Every call must be paired with Release().
+    /// \param fontFiles TrueType files merged into the atlas in order, an
+    /// empty list selects the ImGui default font
+    /// \param size font size in pixels
+    /// \return shared atlas, never nullptr
+    ImFontAtlas *Acquire(const std::vector<std::string> &fontFiles,
+                         float size);
+
+    /// Builds the atlases acquired from now on with ASCII only and adds
+    /// further glyphs on demand through ImgGlyphCache, instead of building
+    /// the default glyph ranges of the fonts. Atlases acquired earlier keep
+    /// their glyphs.
+    /// \param enable true for dynamic glyphs
+    /// \param textureSize width and height of the atlas textures in pixels
+    void SetDynamicGlyphs(bool enable, int textureSize = 1024);
+
+    /// Saves the atlases built from now on to a directory and restores
+    /// them from there instead of building them again
+    /// \param directory existing directory writable by X-Plane, empty to
+    /// disable the cache
+    void SetCacheDirectory(const std::string &directory);
+
+    /// Returns the directory of the atlas cache
+    /// \return directory, empty if the cache is disabled
+    const std::string &GetCacheDirectory() const;
+
+    /// Releases an atlas returned by Acquire()
+    /// \param atlas atlas to release
+    void Release(ImFontAtlas *atlas);
+
+    /// Returns the number of atlases in use
+    /// \return number of atlases
+    size_t GetAtlasCount() const;
+
+    /// Returns memory used by the textures of all atlases
+    /// \return memory in bytes
+    size_t GetTextureBytes() const;
+
+private:
+    ImgFontRegistry() = default;
+    ~ImgFontRegistry();
+
+    struct Entry {
+        ImFontAtlas *atlas;
+        int refs;
+        size_t textureBytes;
+        /// glyphs added on demand, nullptr for static atlases
+        ImgGlyphCache *glyphCache;
+    };
+
+    std::string makeKey(const std::vector<std::string> &fontFiles,
+                        float size) const;
+
+    std::map<std::string, Entry> mEntries;
+    bool mDynamicGlyphs = false;
+    int mDynamicTextureSize = 1024;
+    std::string mCacheDirectory;
+};
+
+#endif //IMGFONTREGISTRY_H
@@ -0,0 +1,259 @@
+/*
+ * imgframe.cpp
+ *
+ * Per-frame coordination of all ImgWindows of a plugin.
+ */
+
+#include "XPLMDataAccess.h"
+#include "XPLMProcessing.h"
+
+#include "imgarena.h"
+#include "imgdataref.h"
+#include "imgdispatcher.h"
+#include "imgframe.h"
+#include "imgglyphcache.h"
+#include "imgimagecache.h"
+#include "imgtrace.h"
+#include "imgui_internal.h"
+#include "imgwindow.h"
+#include "imgworkerpool.h"
+
+#include <algorithm>
+
+/// \file
+/// This file contains the definition of the ImgFrame class
+
+// Dataref's for OpenGL scene data
+static XPLMDataRef gModelViewMatrixRef = nullptr;
+static XPLMDataRef gViewportRef = nullptr;
+static XPLMDataRef gProjectionMatrixRef = nullptr;
+
+ImgFrame &ImgFrame::Get() {
+    static ImgFrame frame;
+    return frame;
+}
+
+ImgFrame::ImgFrame() = default;
+
+ImgFrame::~ImgFrame() = default;
+
+void ImgFrame::Register(ImgWindow *window) {
+    if (gModelViewMatrixRef == nullptr) {
+        gModelViewMatrixRef = XPLMFindDataRef(
+                    "sim/graphics/view/modelview_matrix");
+        gViewportRef = XPLMFindDataRef("sim/graphics/view/viewport");
+        gProjectionMatrixRef = XPLMFindDataRef(
+                    "sim/graphics/view/projection_matrix");
+    }
+    mWindows.push_back(window);
+}
+
+void ImgFrame::Unregister(ImgWindow *window) {
+    mWindows.erase(std::remove(mWindows.begin(), mWindows.end(), window),
+                   mWindows.end());
+    mPending.erase(std::remove(mPending.begin(), mPending.end(), window),
+                   mPending.end());
+}
+
+const std::vector<ImgWindow *> &ImgFrame::Windows() const {
+    return mWindows;
+}
+
+void ImgFrame::Update() {
+    int cycle = XPLMGetCycleNumber();
+    if (cycle == mCycle)
+        return;
+    mPreviousCycle = mCycle;
+    mCycle = cycle;
+
+    if (mInputOverride) {
+        mElapsedTime = mOverrideTime;
+        mMouseX = mOverrideMouseX;
+        mMouseY = mOverrideMouseY;
+    } else {
+        mElapsedTime = XPLMGetElapsedTime();
+        XPLMGetMouseLocationGlobal(&mMouseX, &mMouseY);
+    }
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording())
+        recorder.recordFrame(mElapsedTime, mMouseX, mMouseY);
+
+    // windows queued in the last frame that never got their pass, because
+    // a window counted for it wasn't drawn, are not drawn stale
+    mPending.clear();
+    mExpected = 0;
+
+    {
+        // the context of the window drawn last is still current, the shared
+        // work of the frame is not accounted to it
+        ImgArena::Scope scope(&ImgArena::Shared());
+
+        // commands posted by other threads since the last frame
+        ImgDispatcher::Get().poll();
+
+        // bound datarefs are read once for all windows
+        ImgDataRefCache::Get().update();
+
+        // decoded images are uploaded within the budget before any window
+        // draws their textures
+        ImgImageCache::Get().update();
+
+        // glyphs rasterized since the last frame are added to the atlases
+        ImgGlyphCache::updateAll(mReplacedAtlases);
+    }
+
+    // windows showing a replaced glyph with the draw data of an earlier
+    // frame are rebuilt before they are drawn
+    if (!mReplacedAtlases.empty()) {
+        for (ImgWindow *window : mWindows) {
+            if (window->mImGuiContext != nullptr &&
+                    std::find(mReplacedAtlases.begin(), mReplacedAtlases.end(),
+                              window->mImGuiContext->IO.Fonts) != mReplacedAtlases.end())
+                window->RequestRedraw();
+        }
+    }
+
+    if (mBuildThreads > 0)
+        buildParallel();
+}
+
+int ImgFrame::GetCycle() const {
+    return mCycle;
+}
+
+const ImgFrame::Matrices &ImgFrame::GetMatrices() {
+    // the first draw callback of the frame may belong to a VR or popped out
+    // window, so the matrices are not read in Update()
+    if (mMatricesCycle != mCycle) {
+        mMatricesCycle = mCycle;
+        SampleMatrices(mMatrices);
+    }
+    return mMatrices;
+}
+
+void ImgFrame::SampleMatrices(Matrices &outMatrices) const {
+    XPLMGetDatavf(gModelViewMatrixRef, outMatrices.modelView, 0, 16);
+    XPLMGetDatavf(gProjectionMatrixRef, outMatrices.projection, 0, 16);
+    XPLMGetDatavi(gViewportRef, outMatrices.viewport, 0, 4);
+}
+
+void ImgFrame::GetMouseLocation(int &outX, int &outY) const {
+    outX = mMouseX;
+    outY = mMouseY;
+}
+
+float ImgFrame::GetElapsedTime() const {
+    return mElapsedTime;
+}
+
+float ImgFrame::GetCurrentTime() const {
+    return mInputOverride ? mOverrideTime : XPLMGetElapsedTime();
+}
+
+void ImgFrame::OverrideInput(float elapsedTime, int mouseX, int mouseY) {
+    mInputOverride = true;
+    mOverrideTime = elapsedTime;
+    mOverrideMouseX = mouseX;
+    mOverrideMouseY = mouseY;
+}
+
+void ImgFrame::ClearInputOverride() {
+    mInputOverride = false;
+}
+
+void ImgFrame::SetSharedPass(bool inEnable) {
+    mSharedPass = inEnable;
+    // not in a draw callback, the queued windows will render themselves
+    // from the next frame on
+    mPending.clear();
+}
+
+bool ImgFrame::GetSharedPass() const {
+    return mSharedPass;
+}
+
+bool ImgFrame::Submit(ImgWindow *window) {
+    if (!mSharedPass || !window->canSharePass())
+        return false;
+
+    // X-Plane draws the layers in order, a window of another layer means
+    // the previous one is complete
+    if (!mPending.empty() && mPendingLayer != window->mPreferredLayer)
+        flush();
+
+    if (mPending.empty()) {
+        // X-Plane doesn't call the draw callback of windows off the screen
+        // and may skip others, a window waited for in vain would keep the
+        // pass from being rendered. Only windows on the screen that were
+        // drawn in the last frame and not yet in this one are waited for,
+        // a window skipped once drops out of the count in the next frame.
+        int screenLeft, screenTop, screenRight, screenBottom;
+        XPLMGetScreenBoundsGlobal(&screenLeft, &screenTop, &screenRight, &screenBottom);
+        mPendingLayer = window->mPreferredLayer;
+        mExpected = 1;
+        for (ImgWindow *w : mWindows) {
+            if (w != window && w->mPreferredLayer == mPendingLayer && w->GetVisible() &&
+                    w->canSharePass() && w->mLastDrawCycle == mPreviousCycle &&
+                    w->mRight > screenLeft && w->mLeft < screenRight &&
+                    w->mTop > screenBottom && w->mBottom < screenTop)
+                mExpected++;
+        }
+    }
+
+    window->mLastDrawCycle = mCycle;
+    mPending.push_back(window);
+    if (static_cast<int>(mPending.size()) >= mExpected)
+        flush();
+    return true;
+}
+
+void ImgFrame::flush() {
+    if (mPending.empty())
+        return;
+    ImgWindow::renderPass(mPending);
+    mPending.clear();
+}
+
+void ImgFrame::SetBuildThreads(int threads) {
+    mBuildThreads = std::max(threads, 0);
+}
+
+int ImgFrame::GetBuildThreads() const {
+    return mBuildThreads;
+}
+
+void ImgFrame::buildParallel() {
+    mBuilds.clear();
+    for (ImgWindow *window : mWindows) {
+        // a window shown without a context gets it in its draw callback
+        if (!window->mParallelBuild || window->mImGuiContext == nullptr ||
+                !window->GetVisible() || window->mLastBuildCycle == mCycle)
+            continue;
+        window->beginCycle(mCycle);
+        if (!window->beginBuild())
+            continue;
+        // the first frame may still set up the window and the font
+        // atlas of its context, it's built in the draw callback thread
+        if (window->mFirstRender) {
+            window->buildImGui();
+            window->finishImGui();
+            continue;
+        }
+        mBuilds.push_back(window);
+    }
+    if (mBuilds.empty())
+        return;
+
+    if (!mPool || mPool->GetThreadCount() != mBuildThreads)
+        mPool.reset(new ImgWorkerPool(mBuildThreads));
+    mPool->Run(static_cast<int>(mBuilds.size()), [this](int index) {
+        mBuilds[index]->buildImGui();
+    });
+
+    for (ImgWindow *window : mBuilds)
+        window->finishImGui();
+}
+
+void ImgFrame::shutdownPool() {
+    mPool.reset();
+}
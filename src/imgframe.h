@@ -0,0 +1,177 @@
+/*
+ * imgframe.h
+ *
+ * Per-frame coordination of all ImgWindows of a plugin.
+ */
+
+#ifndef IMGFRAME_H
+#define IMGFRAME_H
+
+#include "XPLMDisplay.h"
+
+#include <memory>
+#include <vector>
+
+class ImgWindow;
+class ImgWorkerPool;
+struct ImFontAtlas;
+
+/// \file
+/// This file contains the declaration of the ImgFrame class
+/// \brief ImgFrame holds the data shared by all ImgWindows of the plugin
+/// within one X-Plane frame.
+///
+/// The OpenGL matrices, the viewport, the mouse location and the sim time are
+/// the same for every window drawn into the main X-Plane window, so they are
+/// sampled once per sim cycle instead of once per window. VR and popped out
+/// windows are drawn with their own matrices and sample them on every draw
+/// callback.
+///
+/// With the shared pass enabled, the windows of one layer don't render in
+/// their own draw callbacks. They are queued and rendered together, back to
+/// front, in the draw callback of the last of them, so the OpenGL state is
+/// set up and restored once for all of them. Windows of other plugins placed
+/// between our windows of the same layer end up below them, so the shared
+/// pass is only suitable when the plugin windows are not interleaved with
+/// foreign ones.
+///
+/// With build threads set, the interfaces of all visible windows that
+/// enabled ImgWindow::SetParallelBuild() are built together at the start
+/// of the sim cycle: the XPLM dependent steps run on the sim thread, the
+/// ImGui frames of the windows run on the worker threads and the calling
+/// thread. Each window has its own ImGui context and the current context is
+/// thread-local, see imgxconfig.h.
+class ImgFrame {
+    friend class ImgWindow;
+public:
+    /// OpenGL scene data
+    struct Matrices {
+        float modelView[16];
+        float projection[16];
+        int viewport[4];
+    };
+
+    /// Returns the frame coordinator of the plugin
+    static ImgFrame &Get();
+
+    /// Adds a window to the list of live windows
+    /// \param window window to add
+    void Register(ImgWindow *window);
+
+    /// Removes a window from the list of live windows
+    /// \param window window to remove
+    void Unregister(ImgWindow *window);
+
+    /// Returns all live windows in creation order
+    /// \return list of windows
+    const std::vector<ImgWindow *> &Windows() const;
+
+    /// Samples the frame data on the first call of a sim cycle. Must be
+    /// called at the start of every draw callback.
+    void Update();
+
+    /// Returns the sim cycle sampled by the last Update()
+    /// \return sim cycle number
+    int GetCycle() const;
+
+    /// Returns the matrices of the main X-Plane window in this frame. They
+    /// are read on the first call of the frame, which must come from a draw
+    /// callback of a window in the main X-Plane window.
+    /// \return shared matrices
+    const Matrices &GetMatrices();
+
+    /// Reads the matrices of the current draw callback
+    /// \param outMatrices matrices to fill
+    void SampleMatrices(Matrices &outMatrices) const;
+
+    /// Returns the mouse location in this frame
+    /// \param outX x coordinate in boxels
+    /// \param outY y coordinate in boxels
+    void GetMouseLocation(int &outX, int &outY) const;
+
+    /// Returns the sim time of this frame
+    /// \return elapsed sim time in seconds
+    float GetElapsedTime() const;
+
+    /// Returns the sim time now, the replayed one while the input is
+    /// overridden. Unlike GetElapsedTime() it advances without draw
+    /// callbacks, e.g. for timers of hidden windows.
+    /// \return sim time in seconds
+    float GetCurrentTime() const;
+
+    /// Replaces the sim time and the mouse location of the next frames,
+    /// used by ImgTracePlayer to replay recorded input
+    /// \param elapsedTime sim time in seconds
+    /// \param mouseX x coordinate in boxels
+    /// \param mouseY y coordinate in boxels
+    void OverrideInput(float elapsedTime, int mouseX, int mouseY);
+
+    /// Gives the sim time and the mouse location back to X-Plane
+    void ClearInputOverride();
+
+    /// Enables or disables the shared render pass
+    /// \param inEnable true to render the windows of a layer in one pass
+    void SetSharedPass(bool inEnable);
+
+    /// Returns true if the shared render pass is enabled
+    /// \return true if the shared render pass is enabled
+    bool GetSharedPass() const;
+
+    /// Queues a window for the shared pass of this frame and renders the
+    /// pass when the last window of the layer is submitted. Windows off the
+    /// screen or not drawn in the last frame are not waited for.
+    /// \param window window to render
+    /// \return false if the window must render itself
+    bool Submit(ImgWindow *window);
+
+    /// Sets the number of worker threads building windows with parallel
+    /// build enabled. The threads are started on the next frame.
+    /// \param threads worker threads, 0 builds every window in its own
+    /// draw callback
+    void SetBuildThreads(int threads);
+
+    /// Returns the number of worker threads
+    /// \return worker threads
+    int GetBuildThreads() const;
+
+private:
+    ImgFrame();
+    ~ImgFrame();
+
+    void flush();
+
+    // builds the windows with parallel build enabled on the worker pool
+    void buildParallel();
+
+    // stops the worker threads, called with the last window
+    void shutdownPool();
+
+    std::vector<ImgWindow *> mWindows;
+
+    int mCycle = -1;
+    int mPreviousCycle = -1;
+    int mMatricesCycle = -1;
+    Matrices mMatrices = {};
+    int mMouseX = 0, mMouseY = 0;
+    float mElapsedTime = 0.0f;
+
+    /// Input replayed instead of the X-Plane one
+    bool mInputOverride = false;
+    float mOverrideTime = 0.0f;
+    int mOverrideMouseX = 0, mOverrideMouseY = 0;
+
+    bool mSharedPass = false;
+    /// Windows queued for the shared pass of the current layer
+    std::vector<ImgWindow *> mPending;
+    XPLMWindowLayer mPendingLayer = xplm_WindowLayerFlightOverlay;
+    int mExpected = 0;
+
+    int mBuildThreads = 0;
+    std::unique_ptr<ImgWorkerPool> mPool;
+    /// Windows built by the pool in the current cycle
+    std::vector<ImgWindow *> mBuilds;
+    /// Atlases whose glyph cache replaced glyphs in the current cycle
+    std::vector<const ImFontAtlas *> mReplacedAtlases;
+};
+
+#endif //IMGFRAME_H
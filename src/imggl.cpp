@@ -0,0 +1,175 @@
+/*
+ * imggl.cpp
+ *
+ * OpenGL entry points beyond OpenGL 1.1 for the dear imgui integration into
+ * X-Plane.
+ */
+
+#include "imggl.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#if LIN
+#include <GL/glx.h>
+#elif APL
+#include <dlfcn.h>
+#include <OpenGL/OpenGL.h>
+#endif
+
+/// \file
+/// This file contains the definition of the ImgGL structure
+
+static void *getProcAddress(const char *name) {
+#if IBM
+    auto proc = (void *) wglGetProcAddress(name);
+    // some drivers return small integers instead of nullptr
+    auto value = (intptr_t) proc;
+    if (value >= -1 && value <= 3)
+        return nullptr;
+    return proc;
+#elif LIN
+    return (void *) glXGetProcAddressARB((const GLubyte *) name);
+#else
+    return dlsym(RTLD_DEFAULT, name);
+#endif
+}
+
+template<typename T>
+static bool loadProc(T &outProc, const char *name, const char *altName = nullptr) {
+    void *proc = getProcAddress(name);
+    if (proc == nullptr && altName != nullptr)
+        proc = getProcAddress(altName);
+    outProc = reinterpret_cast<T>(proc);
+    return proc != nullptr;
+}
+
+const ImgGL &ImgGL::Get() {
+    static ImgGL gl;
+    static bool loaded = false;
+    if (!loaded) {
+        gl.load();
+        loaded = true;
+    }
+    return gl;
+}
+
+void *ImgGL::CurrentContext() {
+#if IBM
+    return (void *) wglGetCurrentContext();
+#elif LIN
+    return (void *) glXGetCurrentContext();
+#else
+    return (void *) CGLGetCurrentContext();
+#endif
+}
+
+bool ImgGL::IsVersion(int major, int minor) const {
+    return mMajor > major || (mMajor == major && mMinor >= minor);
+}
+
+bool ImgGL::HasExtension(const char *name) const {
+    auto extensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+    if (extensions == nullptr)
+        return false;
+    size_t len = strlen(name);
+    for (const char *p = strstr(extensions, name); p != nullptr;
+         p = strstr(p + len, name)) {
+        // match whole names only
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == 0))
+            return true;
+    }
+    return false;
+}
+
+void ImgGL::load() {
+    auto version = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+    if (version == nullptr || sscanf(version, "%d.%d", &mMajor, &mMinor) != 2) {
+        mMajor = 1;
+        mMinor = 1;
+    }
+
+    if (IsVersion(3, 0) || HasExtension("GL_ARB_framebuffer_object")) {
+        HasFramebufferObject =
+                loadProc(GenFramebuffers, "glGenFramebuffers") &&
+                loadProc(DeleteFramebuffers, "glDeleteFramebuffers") &&
+                loadProc(BindFramebuffer, "glBindFramebuffer") &&
+                loadProc(FramebufferTexture2D, "glFramebufferTexture2D") &&
+                loadProc(CheckFramebufferStatus, "glCheckFramebufferStatus") &&
+                loadProc(BlendFuncSeparate, "glBlendFuncSeparate",
+                         "glBlendFuncSeparateEXT");
+    }
+
+    if (IsVersion(1, 5)) {
+        HasBufferObject =
+                loadProc(GenBuffers, "glGenBuffers") &&
+                loadProc(DeleteBuffers, "glDeleteBuffers") &&
+                loadProc(BindBuffer, "glBindBuffer") &&
+                loadProc(BufferData, "glBufferData") &&
+                loadProc(BufferSubData, "glBufferSubData");
+    }
+
+    if (HasBufferObject &&
+            (IsVersion(3, 0) || HasExtension("GL_ARB_map_buffer_range"))) {
+        HasMapBufferRange =
+                loadProc(MapBufferRange, "glMapBufferRange") &&
+                loadProc(UnmapBuffer, "glUnmapBuffer");
+    }
+
+    if (IsVersion(2, 0)) {
+        HasShaders =
+                loadProc(CreateShader, "glCreateShader") &&
+                loadProc(DeleteShader, "glDeleteShader") &&
+                loadProc(ShaderSource, "glShaderSource") &&
+                loadProc(CompileShader, "glCompileShader") &&
+                loadProc(GetShaderiv, "glGetShaderiv") &&
+                loadProc(GetShaderInfoLog, "glGetShaderInfoLog") &&
+                loadProc(CreateProgram, "glCreateProgram") &&
+                loadProc(DeleteProgram, "glDeleteProgram") &&
+                loadProc(AttachShader, "glAttachShader") &&
+                loadProc(BindAttribLocation, "glBindAttribLocation") &&
+                loadProc(LinkProgram, "glLinkProgram") &&
+                loadProc(GetProgramiv, "glGetProgramiv") &&
+                loadProc(GetProgramInfoLog, "glGetProgramInfoLog") &&
+                loadProc(UseProgram, "glUseProgram") &&
+                loadProc(GetUniformLocation, "glGetUniformLocation") &&
+                loadProc(Uniform1i, "glUniform1i") &&
+                loadProc(UniformMatrix4fv, "glUniformMatrix4fv") &&
+                loadProc(EnableVertexAttribArray, "glEnableVertexAttribArray") &&
+                loadProc(DisableVertexAttribArray, "glDisableVertexAttribArray") &&
+                loadProc(VertexAttribPointer, "glVertexAttribPointer");
+    }
+
+    HasTextureSwizzle = IsVersion(3, 3) ||
+                        ((IsVersion(3, 0) || HasExtension("GL_ARB_texture_rg")) &&
+                         (HasExtension("GL_ARB_texture_swizzle") ||
+                          HasExtension("GL_EXT_texture_swizzle")));
+
+    if (IsVersion(3, 0) || HasExtension("GL_ARB_vertex_array_object")) {
+        HasVertexArrayObject =
+                loadProc(GenVertexArrays, "glGenVertexArrays") &&
+                loadProc(DeleteVertexArrays, "glDeleteVertexArrays") &&
+                loadProc(BindVertexArray, "glBindVertexArray");
+    }
+
+    if (IsVersion(3, 2) || HasExtension("GL_ARB_draw_elements_base_vertex")) {
+        HasDrawElementsBaseVertex =
+                loadProc(DrawElementsBaseVertex, "glDrawElementsBaseVertex");
+    }
+
+    // the query object functions are OpenGL 1.5, the timer target and the
+    // 64 bit result come with the extensions
+    if (IsVersion(1, 5) && (IsVersion(3, 3) ||
+            HasExtension("GL_ARB_timer_query") ||
+            HasExtension("GL_EXT_timer_query"))) {
+        HasTimerQuery =
+                loadProc(GenQueries, "glGenQueries") &&
+                loadProc(DeleteQueries, "glDeleteQueries") &&
+                loadProc(BeginQuery, "glBeginQuery") &&
+                loadProc(EndQuery, "glEndQuery") &&
+                loadProc(GetQueryObjectiv, "glGetQueryObjectiv") &&
+                loadProc(GetQueryObjectui64v, "glGetQueryObjectui64v",
+                         "glGetQueryObjectui64vEXT");
+    }
+}
@@ -0,0 +1,244 @@
+/*
+ * imggl.h
+ *
+ * OpenGL entry points beyond OpenGL 1.1 for the dear imgui integration into
+ * X-Plane.
+ */
+
+#ifndef IMGGL_H
+#define IMGGL_H
+
+#if LIN
+#include <GL/gl.h>
+#elif IBM
+#include <windows.h>
+#include <gl/GL.h>
+#else
+#include <OpenGL/gl.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+
+/// \file
+/// This file contains the declaration of the ImgGL structure, which holds the
+/// OpenGL entry points ImgWindow uses beyond OpenGL 1.1. X-Plane gives us a
+/// compatibility context, but on Windows only OpenGL 1.1 is exported by the
+/// system library, so everything newer is loaded at runtime. Every feature
+/// has a flag which must be checked before using its entry points, the
+/// caller is expected to fall back to the OpenGL 1.1 path otherwise.
+
+#if IBM
+#define IMGX_APIENTRY APIENTRY
+#else
+#define IMGX_APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_RANGE_BIT
+#define GL_MAP_INVALIDATE_RANGE_BIT 0x0004
+#endif
+#ifndef GL_MAP_UNSYNCHRONIZED_BIT
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_INFO_LOG_LENGTH
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+#ifndef GL_R8
+#define GL_R8 0x8229
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_RGBA
+#define GL_TEXTURE_SWIZZLE_RGBA 0x8E46
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_FRAMEBUFFER_BINDING
+#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+typedef ptrdiff_t ImgGLsizeiptr;
+typedef ptrdiff_t ImgGLintptr;
+typedef char ImgGLchar;
+typedef uint64_t ImgGLuint64;
+
+struct ImgGL {
+    /// Returns the loaded entry points. The first call must be made with the
+    /// X-Plane OpenGL context current, i.e. from a drawing callback.
+    static const ImgGL &Get();
+
+    /// Framebuffer objects (OpenGL 3.0 or ARB_framebuffer_object) and
+    /// separate blend functions (OpenGL 1.4)
+    bool HasFramebufferObject = false;
+
+    void (IMGX_APIENTRY *GenFramebuffers)(GLsizei n, GLuint *framebuffers) = nullptr;
+    void (IMGX_APIENTRY *DeleteFramebuffers)(GLsizei n, const GLuint *framebuffers) = nullptr;
+    void (IMGX_APIENTRY *BindFramebuffer)(GLenum target, GLuint framebuffer) = nullptr;
+    void (IMGX_APIENTRY *FramebufferTexture2D)(GLenum target, GLenum attachment,
+                                               GLenum textarget, GLuint texture,
+                                               GLint level) = nullptr;
+    GLenum (IMGX_APIENTRY *CheckFramebufferStatus)(GLenum target) = nullptr;
+    void (IMGX_APIENTRY *BlendFuncSeparate)(GLenum sfactorRGB, GLenum dfactorRGB,
+                                            GLenum sfactorAlpha,
+                                            GLenum dfactorAlpha) = nullptr;
+
+    /// Buffer objects (OpenGL 1.5)
+    bool HasBufferObject = false;
+
+    void (IMGX_APIENTRY *GenBuffers)(GLsizei n, GLuint *buffers) = nullptr;
+    void (IMGX_APIENTRY *DeleteBuffers)(GLsizei n, const GLuint *buffers) = nullptr;
+    void (IMGX_APIENTRY *BindBuffer)(GLenum target, GLuint buffer) = nullptr;
+    void (IMGX_APIENTRY *BufferData)(GLenum target, ImgGLsizeiptr size,
+                                     const void *data, GLenum usage) = nullptr;
+    void (IMGX_APIENTRY *BufferSubData)(GLenum target, ImgGLintptr offset,
+                                        ImgGLsizeiptr size,
+                                        const void *data) = nullptr;
+
+    /// Buffer range mapping (OpenGL 3.0 or ARB_map_buffer_range)
+    bool HasMapBufferRange = false;
+
+    void *(IMGX_APIENTRY *MapBufferRange)(GLenum target, ImgGLintptr offset,
+                                          ImgGLsizeiptr length,
+                                          GLbitfield access) = nullptr;
+    GLboolean (IMGX_APIENTRY *UnmapBuffer)(GLenum target) = nullptr;
+
+    /// GLSL programs (OpenGL 2.0)
+    bool HasShaders = false;
+
+    GLuint (IMGX_APIENTRY *CreateShader)(GLenum type) = nullptr;
+    void (IMGX_APIENTRY *DeleteShader)(GLuint shader) = nullptr;
+    void (IMGX_APIENTRY *ShaderSource)(GLuint shader, GLsizei count,
+                                       const ImgGLchar *const *string,
+                                       const GLint *length) = nullptr;
+    void (IMGX_APIENTRY *CompileShader)(GLuint shader) = nullptr;
+    void (IMGX_APIENTRY *GetShaderiv)(GLuint shader, GLenum pname,
+                                      GLint *params) = nullptr;
+    void (IMGX_APIENTRY *GetShaderInfoLog)(GLuint shader, GLsizei bufSize,
+                                           GLsizei *length,
+                                           ImgGLchar *infoLog) = nullptr;
+    GLuint (IMGX_APIENTRY *CreateProgram)() = nullptr;
+    void (IMGX_APIENTRY *DeleteProgram)(GLuint program) = nullptr;
+    void (IMGX_APIENTRY *AttachShader)(GLuint program, GLuint shader) = nullptr;
+    void (IMGX_APIENTRY *BindAttribLocation)(GLuint program, GLuint index,
+                                             const ImgGLchar *name) = nullptr;
+    void (IMGX_APIENTRY *LinkProgram)(GLuint program) = nullptr;
+    void (IMGX_APIENTRY *GetProgramiv)(GLuint program, GLenum pname,
+                                       GLint *params) = nullptr;
+    void (IMGX_APIENTRY *GetProgramInfoLog)(GLuint program, GLsizei bufSize,
+                                            GLsizei *length,
+                                            ImgGLchar *infoLog) = nullptr;
+    void (IMGX_APIENTRY *UseProgram)(GLuint program) = nullptr;
+    GLint (IMGX_APIENTRY *GetUniformLocation)(GLuint program,
+                                              const ImgGLchar *name) = nullptr;
+    void (IMGX_APIENTRY *Uniform1i)(GLint location, GLint v0) = nullptr;
+    void (IMGX_APIENTRY *UniformMatrix4fv)(GLint location, GLsizei count,
+                                           GLboolean transpose,
+                                           const GLfloat *value) = nullptr;
+    void (IMGX_APIENTRY *EnableVertexAttribArray)(GLuint index) = nullptr;
+    void (IMGX_APIENTRY *DisableVertexAttribArray)(GLuint index) = nullptr;
+    void (IMGX_APIENTRY *VertexAttribPointer)(GLuint index, GLint size,
+                                              GLenum type, GLboolean normalized,
+                                              GLsizei stride,
+                                              const void *pointer) = nullptr;
+
+    /// Single channel textures with swizzle (OpenGL 3.3 or ARB_texture_rg
+    /// and ARB_texture_swizzle), no entry points
+    bool HasTextureSwizzle = false;
+
+    /// Vertex array objects (OpenGL 3.0 or ARB_vertex_array_object)
+    bool HasVertexArrayObject = false;
+
+    void (IMGX_APIENTRY *GenVertexArrays)(GLsizei n, GLuint *arrays) = nullptr;
+    void (IMGX_APIENTRY *DeleteVertexArrays)(GLsizei n, const GLuint *arrays) = nullptr;
+    void (IMGX_APIENTRY *BindVertexArray)(GLuint array) = nullptr;
+
+    /// Base vertex drawing (OpenGL 3.2 or ARB_draw_elements_base_vertex)
+    bool HasDrawElementsBaseVertex = false;
+
+    void (IMGX_APIENTRY *DrawElementsBaseVertex)(GLenum mode, GLsizei count,
+                                                 GLenum type,
+                                                 const void *indices,
+                                                 GLint basevertex) = nullptr;
+
+    /// Timer queries (OpenGL 3.3, ARB_timer_query or EXT_timer_query)
+    bool HasTimerQuery = false;
+
+    void (IMGX_APIENTRY *GenQueries)(GLsizei n, GLuint *ids) = nullptr;
+    void (IMGX_APIENTRY *DeleteQueries)(GLsizei n, const GLuint *ids) = nullptr;
+    void (IMGX_APIENTRY *BeginQuery)(GLenum target, GLuint id) = nullptr;
+    void (IMGX_APIENTRY *EndQuery)(GLenum target) = nullptr;
+    void (IMGX_APIENTRY *GetQueryObjectiv)(GLuint id, GLenum pname,
+                                           GLint *params) = nullptr;
+    void (IMGX_APIENTRY *GetQueryObjectui64v)(GLuint id, GLenum pname,
+                                              ImgGLuint64 *params) = nullptr;
+
+    /// Returns the current OpenGL context. Objects which are not shared
+    /// between contexts (vertex arrays) must only be used in the context
+    /// they were created in.
+    /// \return opaque handle of the current context
+    static void *CurrentContext();
+
+    /// Returns true if the context reports at least the given version
+    /// \param major major version
+    /// \param minor minor version
+    /// \return true if the version is supported
+    bool IsVersion(int major, int minor) const;
+
+    /// Returns true if the context reports the extension
+    /// \param name extension name
+    /// \return true if the extension is supported
+    bool HasExtension(const char *name) const;
+
+private:
+    ImgGL() = default;
+
+    void load();
+
+    int mMajor = 1, mMinor = 1;
+};
+
+#endif //IMGGL_H
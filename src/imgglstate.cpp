@@ -0,0 +1,148 @@
+/*
+ * imgglstate.cpp
+ *
+ * OpenGL state cache for the dear imgui integration into X-Plane.
+ */
+
+#include "XPLMGraphics.h"
+
+#include "imgglstate.h"
+
+/// \file
+/// This file contains the definition of the ImgGLState class
+
+ImgGLState &ImgGLState::Get() {
+    static ImgGLState state;
+    return state;
+}
+
+void ImgGLState::Invalidate() {
+    mTextureKnown = false;
+    mScissorKnown = false;
+}
+
+void ImgGLState::BindTexture(GLuint texture) {
+    if (mTextureKnown && mTexture == texture) {
+        mStats.skipped++;
+        return;
+    }
+    XPLMBindTexture2d(static_cast<int>(texture), 0);
+    mTexture = texture;
+    mTextureKnown = true;
+    mStats.issued++;
+}
+
+void ImgGLState::Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (mScissorKnown && mScissor[0] == x && mScissor[1] == y &&
+            mScissor[2] == width && mScissor[3] == height) {
+        mStats.skipped++;
+        return;
+    }
+    glScissor(x, y, width, height);
+    mScissor[0] = x;
+    mScissor[1] = y;
+    mScissor[2] = width;
+    mScissor[3] = height;
+    mScissorKnown = true;
+    mStats.issued++;
+}
+
+void ImgGLState::EnableClientState(GLenum array) {
+    int bit = clientArrayBit(array);
+    if (mClientArrays & bit) {
+        mStats.skipped++;
+        return;
+    }
+    glEnableClientState(array);
+    mClientArrays |= bit;
+    mStats.issued++;
+}
+
+void ImgGLState::RestoreClientState() {
+    const GLenum arrays[3] = {GL_VERTEX_ARRAY, GL_TEXTURE_COORD_ARRAY,
+                              GL_COLOR_ARRAY};
+    for (GLenum array : arrays) {
+        if (mClientArrays & clientArrayBit(array)) {
+            glDisableClientState(array);
+            mStats.issued++;
+        }
+    }
+    mClientArrays = 0;
+}
+
+void ImgGLState::SetCapability(GLenum capability, bool enable) {
+    int bit = capabilityBit(capability);
+    if (!(mCapabilitiesChanged & bit)) {
+        // the enable bits are kept by the driver, reading them doesn't
+        // wait for the GPU
+        if (glIsEnabled(capability)) {
+            mCapabilitiesFound |= bit;
+            mCapabilities |= bit;
+        } else {
+            mCapabilitiesFound &= ~bit;
+            mCapabilities &= ~bit;
+        }
+        mCapabilitiesChanged |= bit;
+    }
+    if (((mCapabilities & bit) != 0) == enable) {
+        mStats.skipped++;
+        return;
+    }
+    if (enable) {
+        glEnable(capability);
+        mCapabilities |= bit;
+    } else {
+        glDisable(capability);
+        mCapabilities &= ~bit;
+    }
+    mStats.issued++;
+}
+
+void ImgGLState::RestoreCapabilities() {
+    const GLenum capabilities[2] = {GL_CULL_FACE, GL_SCISSOR_TEST};
+    for (GLenum capability : capabilities) {
+        int bit = capabilityBit(capability);
+        if (!(mCapabilitiesChanged & bit) ||
+                (mCapabilities & bit) == (mCapabilitiesFound & bit))
+            continue;
+        if (mCapabilitiesFound & bit)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        mStats.issued++;
+    }
+    mCapabilitiesChanged = 0;
+}
+
+ImgGLState::Stats ImgGLState::GetStats() const {
+    return mStats;
+}
+
+void ImgGLState::ResetStats() {
+    mStats.issued = 0;
+    mStats.skipped = 0;
+}
+
+int ImgGLState::clientArrayBit(GLenum array) {
+    switch (array) {
+    case GL_VERTEX_ARRAY:
+        return 1;
+    case GL_TEXTURE_COORD_ARRAY:
+        return 2;
+    case GL_COLOR_ARRAY:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+int ImgGLState::capabilityBit(GLenum capability) {
+    switch (capability) {
+    case GL_CULL_FACE:
+        return 1;
+    case GL_SCISSOR_TEST:
+        return 2;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * imgglstate.h
+ *
+ * OpenGL state cache for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGGLSTATE_H
+#define IMGGLSTATE_H
+
+#include "imggl.h"
+
+/// \file
+/// This file contains the declaration of the ImgGLState class
+/// \brief ImgGLState remembers the OpenGL state ImgWindow sets while it
+/// renders and drops changes that would not change anything.
+///
+/// The cache doesn't query OpenGL, except once per render pass for the
+/// capabilities changed with SetCapability(), so the shader backend puts
+/// them back without glPushAttrib(). Textures are bound through
+/// XPLMBindTexture2d so X-Plane's own binding cache stays valid and the
+/// previous binding doesn't need to be read back and restored. The cached
+/// texture and scissor box are forgotten with Invalidate() whenever code
+/// outside of the cache may have changed them: at the start of a render
+/// pass, after user callbacks and after rendering into a framebuffer.
+/// Client arrays are expected to be disabled when a render pass starts, as
+/// X-Plane requires from every plugin, and those enabled through the cache
+/// are disabled again by RestoreClientState().
+class ImgGLState {
+public:
+    /// State change counters
+    struct Stats {
+        /// state changes passed to OpenGL
+        unsigned long issued;
+        /// state changes dropped because the state was already set
+        unsigned long skipped;
+    };
+
+    /// Returns the state cache of the plugin
+    static ImgGLState &Get();
+
+    /// Forgets the cached texture binding and scissor box
+    void Invalidate();
+
+    /// Binds a texture to the first texture unit
+    /// \param texture texture name
+    void BindTexture(GLuint texture);
+
+    /// Sets the scissor box
+    /// \param x left edge in pixels
+    /// \param y bottom edge in pixels
+    /// \param width width in pixels
+    /// \param height height in pixels
+    void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    /// Enables a client array
+    /// \param array GL_VERTEX_ARRAY, GL_TEXTURE_COORD_ARRAY or GL_COLOR_ARRAY
+    void EnableClientState(GLenum array);
+
+    /// Disables the client arrays enabled through the cache
+    void RestoreClientState();
+
+    /// Enables or disables a capability. The state found is read on the
+    /// first change and put back by RestoreCapabilities().
+    /// \param capability GL_CULL_FACE or GL_SCISSOR_TEST
+    /// \param enable true to enable the capability
+    void SetCapability(GLenum capability, bool enable);
+
+    /// Puts back the capabilities changed with SetCapability()
+    void RestoreCapabilities();
+
+    /// Returns the counters since the last ResetStats()
+    /// \return state change counters
+    Stats GetStats() const;
+
+    /// Resets the counters
+    void ResetStats();
+
+private:
+    ImgGLState() = default;
+
+    static int clientArrayBit(GLenum array);
+
+    static int capabilityBit(GLenum capability);
+
+    bool mTextureKnown = false;
+    GLuint mTexture = 0;
+
+    bool mScissorKnown = false;
+    GLint mScissor[4] = {0, 0, 0, 0};
+
+    /// Bits of the client arrays enabled through the cache
+    int mClientArrays = 0;
+
+    /// Bits of the capabilities changed through the cache, of those found
+    /// enabled and of those enabled now
+    int mCapabilitiesChanged = 0;
+    int mCapabilitiesFound = 0;
+    int mCapabilities = 0;
+
+    Stats mStats = {0, 0};
+};
+
+#endif //IMGGLSTATE_H
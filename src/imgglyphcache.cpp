@@ -0,0 +1,402 @@
+/*
+ * imgglyphcache.cpp
+ *
+ * On-demand glyph rasterization for the font atlases of the dear imgui
+ * integration into X-Plane.
+ */
+
+#include "imgglyphcache.h"
+#include "imgglstate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ImGui compiles stb_truetype into imgui_draw.cpp with static linkage, the
+// cache gets a private copy of the functions it uses
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imstb_truetype.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+/// \file
+/// This file contains the definition of the ImgGlyphCache class
+
+struct ImgGlyphCache::Sources {
+    struct Font {
+        stbtt_fontinfo info;
+        float scale;
+        ImVec2 offset;
+    };
+    /// fonts in the order of the atlas, the first one having a glyph wins
+    std::vector<Font> fonts;
+    /// baseline below the line top
+    float ascent = 0.0f;
+};
+
+// All glyph caches, touched on the sim thread only
+static std::vector<ImgGlyphCache *> gCaches;
+
+// Decodes one UTF-8 sequence, invalid bytes decode as U+FFFD
+static const char *decodeUtf8(const char *text, const char *textEnd, unsigned int &outChar) {
+    auto s = reinterpret_cast<const unsigned char *>(text);
+    auto end = reinterpret_cast<const unsigned char *>(textEnd);
+    int length;
+    if (s[0] < 0x80) {
+        outChar = s[0];
+        return text + 1;
+    } else if ((s[0] & 0xE0) == 0xC0) {
+        outChar = s[0] & 0x1Fu;
+        length = 2;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        outChar = s[0] & 0x0Fu;
+        length = 3;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        outChar = s[0] & 0x07u;
+        length = 4;
+    } else {
+        outChar = 0xFFFD;
+        return text + 1;
+    }
+    for (int i = 1; i < length; i++) {
+        if (s + i >= end || (s[i] & 0xC0) != 0x80) {
+            outChar = 0xFFFD;
+            return text + i;
+        }
+        outChar = (outChar << 6) | (s[i] & 0x3Fu);
+    }
+    return text + length;
+}
+
+ImgGlyphCache::ImgGlyphCache(ImFontAtlas *atlas, int textureHeight):
+        mAtlas(atlas),
+        mFont(atlas->Fonts[0]),
+        mStatic(0x10000, false),
+        mSources(new Sources()) {
+    for (const ImFontGlyph &glyph : mFont->Glyphs)
+        mStatic[glyph.Codepoint] = true;
+
+    // the atlas keeps the font files, the raster thread reads them as the
+    // atlas build did
+    mSources->ascent = std::floor(mFont->Ascent + 0.5f);
+    for (const ImFontConfig &config : atlas->ConfigData) {
+        // fonts other than the first one get no glyphs
+        if (config.DstFont != mFont)
+            continue;
+        Sources::Font font;
+        auto data = static_cast<const unsigned char *>(config.FontData);
+        if (!stbtt_InitFont(&font.info, data, stbtt_GetFontOffsetForIndex(data, config.FontNo)))
+            continue;
+        font.scale = config.SizePixels > 0.0f ?
+                     stbtt_ScaleForPixelHeight(&font.info, config.SizePixels) :
+                     stbtt_ScaleForMappingEmToPixels(&font.info, -config.SizePixels);
+        font.offset = config.GlyphOffset;
+        mSources->fonts.push_back(font);
+    }
+
+    // one pixel between the cells, so filtering doesn't sample a neighbor
+    mCellSize = static_cast<int>(std::ceil(mFont->Ascent - mFont->Descent)) + 1;
+    mColumns = atlas->TexWidth / mCellSize;
+    mTop = atlas->TexHeight;
+
+    int oldHeight = atlas->TexHeight;
+    int height = std::max(textureHeight, oldHeight);
+    if (height > oldHeight && atlas->TexPixelsAlpha8 != nullptr) {
+        size_t oldBytes = static_cast<size_t>(atlas->TexWidth) * oldHeight;
+        size_t bytes = static_cast<size_t>(atlas->TexWidth) * height;
+        auto pixels = static_cast<unsigned char *>(ImGui::MemAlloc(bytes));
+        memcpy(pixels, atlas->TexPixelsAlpha8, oldBytes);
+        memset(pixels + oldBytes, 0, bytes - oldBytes);
+        ImGui::MemFree(atlas->TexPixelsAlpha8);
+        atlas->TexPixelsAlpha8 = pixels;
+        if (atlas->TexPixelsRGBA32 != nullptr) {
+            ImGui::MemFree(atlas->TexPixelsRGBA32);
+            atlas->TexPixelsRGBA32 = nullptr;
+        }
+
+        // the built glyphs keep their pixels, their V coordinates shrink
+        float scaleV = static_cast<float>(oldHeight) / height;
+        for (ImFont *font : atlas->Fonts) {
+            for (ImFontGlyph &glyph : font->Glyphs) {
+                glyph.V0 *= scaleV;
+                glyph.V1 *= scaleV;
+            }
+        }
+        atlas->TexUvWhitePixel.y *= scaleV;
+        atlas->TexHeight = height;
+        atlas->TexUvScale.y = 1.0f / height;
+    }
+
+    int rows = (atlas->TexHeight - mTop) / mCellSize;
+    if (mColumns > 0 && rows > 0)
+        mCells.resize(static_cast<size_t>(mColumns) * rows);
+    gCaches.push_back(this);
+}
+
+ImgGlyphCache::~ImgGlyphCache() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    if (mThread.joinable())
+        mThread.join();
+    gCaches.erase(std::remove(gCaches.begin(), gCaches.end(), this), gCaches.end());
+}
+
+void ImgGlyphCache::Request(const char *text, const char *textEnd) {
+    ImgGlyphCache *cache = Find(ImGui::GetIO().Fonts);
+    if (cache != nullptr && ImGui::GetFont() == cache->mFont)
+        cache->request(text, textEnd);
+}
+
+void ImgGlyphCache::RequestRange(ImWchar first, ImWchar last) {
+    ImgGlyphCache *cache = Find(ImGui::GetIO().Fonts);
+    if (cache == nullptr || ImGui::GetFont() != cache->mFont)
+        return;
+    std::lock_guard<std::mutex> lock(cache->mMutex);
+    for (unsigned int c = first; c <= last; c++) {
+        if (c != 0 && !cache->mStatic[c])
+            cache->request(static_cast<ImWchar>(c));
+    }
+}
+
+ImgGlyphCache *ImgGlyphCache::Find(const ImFontAtlas *atlas) {
+    for (ImgGlyphCache *cache : gCaches) {
+        if (cache->mAtlas == atlas)
+            return cache;
+    }
+    return nullptr;
+}
+
+ImgGlyphCache::Stats ImgGlyphCache::GetStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats;
+    stats.cached = 0;
+    for (const Cell &cell : mCells) {
+        if (cell.codepoint != 0)
+            stats.cached++;
+    }
+    stats.capacity = static_cast<int>(mCells.size());
+    stats.rasterized = mRasterized;
+    stats.evicted = mEvicted;
+    stats.uploadedBytes = mUploadedBytes;
+    stats.pending = static_cast<int>(mQueue.size() + mRasters.size());
+    return stats;
+}
+
+void ImgGlyphCache::request(const char *text, const char *textEnd) {
+    if (textEnd == nullptr)
+        textEnd = text + strlen(text);
+
+    // ASCII and the other built glyphs are found without the lock
+    std::unique_lock<std::mutex> lock(mMutex, std::defer_lock);
+    while (text < textEnd) {
+        unsigned int c;
+        text = decodeUtf8(text, textEnd, c);
+        // ImWchar holds the basic multilingual plane only
+        if (c == 0 || c > 0xFFFF || mStatic[c])
+            continue;
+        if (!lock.owns_lock())
+            lock.lock();
+        request(static_cast<ImWchar>(c));
+    }
+}
+
+void ImgGlyphCache::request(ImWchar codepoint) {
+    auto it = mGlyphs.find(codepoint);
+    if (it != mGlyphs.end()) {
+        it->second.lastUsed = mFrame;
+        return;
+    }
+
+    Glyph &glyph = mGlyphs[codepoint];
+    glyph.lastUsed = mFrame;
+    mQueue.push_back(codepoint);
+    if (!mThread.joinable())
+        mThread = std::thread(&ImgGlyphCache::rasterLoop, this);
+    else
+        mWake.notify_one();
+}
+
+void ImgGlyphCache::updateAll(std::vector<const ImFontAtlas *> &outReplaced) {
+    outReplaced.clear();
+    for (ImgGlyphCache *cache : gCaches) {
+        if (cache->update())
+            outReplaced.push_back(cache->mAtlas);
+    }
+}
+
+bool ImgGlyphCache::update() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // glyphs requested while the windows build this frame must not be
+    // replaced before they are drawn
+    mFrame++;
+    if (mRasters.empty())
+        return false;
+
+    std::vector<Raster> rasters;
+    rasters.swap(mRasters);
+    std::vector<ImWchar> evicted;
+    bool added = false, replaced = false;
+    for (const Raster &raster : rasters) {
+        auto it = mGlyphs.find(raster.codepoint);
+        if (!raster.found) {
+            it->second.state = Missing;
+            continue;
+        }
+        evicted.clear();
+        int cell = place(raster, evicted);
+        for (ImWchar c : evicted) {
+            mGlyphs.erase(c);
+            mEvicted++;
+            replaced = true;
+        }
+        if (cell < 0) {
+            // all cells hold glyphs of the last frame, the next request
+            // queues the glyph again
+            mGlyphs.erase(it);
+            continue;
+        }
+        it->second.state = Cached;
+        it->second.cell = cell;
+        added = true;
+    }
+    if (added)
+        mFont->BuildLookupTable();
+    return replaced;
+}
+
+int ImgGlyphCache::place(const Raster &raster, std::vector<ImWchar> &outEvicted) {
+    // a free cell or the one whose glyph was requested longest ago, glyphs
+    // of the last frame stay
+    int cell = -1;
+    unsigned int oldest = mFrame - 1;
+    for (size_t i = 0; i < mCells.size(); i++) {
+        if (mCells[i].codepoint == 0) {
+            cell = static_cast<int>(i);
+            break;
+        }
+        unsigned int lastUsed = mGlyphs[mCells[i].codepoint].lastUsed;
+        if (lastUsed < oldest) {
+            oldest = lastUsed;
+            cell = static_cast<int>(i);
+        }
+    }
+    if (cell < 0)
+        return -1;
+    Cell &target = mCells[cell];
+    if (target.codepoint != 0)
+        outEvicted.push_back(target.codepoint);
+
+    // the whole cell is written, so nothing of a replaced glyph remains
+    int size = mCellSize - 1;
+    int width = std::min(raster.width, size);
+    int height = std::min(raster.height, size);
+    std::vector<unsigned char> pixels(static_cast<size_t>(size) * size, 0);
+    for (int y = 0; y < height; y++) {
+        memcpy(pixels.data() + static_cast<size_t>(y) * size,
+               raster.pixels.data() + static_cast<size_t>(y) * raster.width, width);
+    }
+
+    int x = (cell % mColumns) * mCellSize;
+    int y = mTop + (cell / mColumns) * mCellSize;
+    ImgGLState::Get().BindTexture(static_cast<GLuint>(reinterpret_cast<uintptr_t>(mAtlas->TexID)));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, size, size,
+                    ImgGL::Get().HasTextureSwizzle ? GL_RED : GL_ALPHA,
+                    GL_UNSIGNED_BYTE, pixels.data());
+    mUploadedBytes += pixels.size();
+
+    float x0 = raster.x0;
+    float y0 = raster.y0;
+    float u0 = x * mAtlas->TexUvScale.x;
+    float v0 = y * mAtlas->TexUvScale.y;
+    float u1 = (x + width) * mAtlas->TexUvScale.x;
+    float v1 = (y + height) * mAtlas->TexUvScale.y;
+    if (target.glyph < 0) {
+        // BuildLookupTable() appends a tab glyph, it is appended again
+        // after the new glyph
+        if (!mFont->Glyphs.empty() && mFont->Glyphs.back().Codepoint == '\t')
+            mFont->Glyphs.pop_back();
+        mFont->AddGlyph(raster.codepoint, x0, y0, x0 + width, y0 + height,
+                        u0, v0, u1, v1, raster.advance);
+        target.glyph = mFont->Glyphs.Size - 1;
+    } else {
+        // replaced in place, like AddGlyph() would set it
+        ImFontGlyph &glyph = mFont->Glyphs[target.glyph];
+        glyph.Codepoint = raster.codepoint;
+        glyph.X0 = x0;
+        glyph.Y0 = y0;
+        glyph.X1 = x0 + width;
+        glyph.Y1 = y0 + height;
+        glyph.U0 = u0;
+        glyph.V0 = v0;
+        glyph.U1 = u1;
+        glyph.V1 = v1;
+        glyph.AdvanceX = raster.advance + mFont->ConfigData->GlyphExtraSpacing.x;
+        if (mFont->ConfigData->PixelSnapH)
+            glyph.AdvanceX = std::floor(glyph.AdvanceX + 0.5f);
+    }
+    target.codepoint = raster.codepoint;
+    return cell;
+}
+
+void ImgGlyphCache::rasterLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mWake.wait(lock, [this] { return mStop || !mQueue.empty(); });
+        if (mStop)
+            return;
+        ImWchar codepoint = mQueue.front();
+        mQueue.pop_front();
+
+        lock.unlock();
+        Raster raster;
+        rasterize(codepoint, raster);
+        lock.lock();
+
+        mRasterized++;
+        mGlyphs[codepoint].state = Rasterized;
+        mRasters.push_back(std::move(raster));
+    }
+}
+
+bool ImgGlyphCache::rasterize(ImWchar codepoint, Raster &outRaster) {
+    outRaster.codepoint = codepoint;
+    outRaster.found = false;
+    outRaster.width = outRaster.height = 0;
+    outRaster.x0 = outRaster.y0 = outRaster.advance = 0.0f;
+    for (Sources::Font &font : mSources->fonts) {
+        int index = stbtt_FindGlyphIndex(&font.info, codepoint);
+        if (index == 0)
+            continue;
+
+        int ix0 = 0, iy0 = 0, ix1 = 0, iy1 = 0;
+        stbtt_GetGlyphBitmapBox(&font.info, index, font.scale, font.scale, &ix0, &iy0, &ix1, &iy1);
+        outRaster.width = ix1 - ix0;
+        outRaster.height = iy1 - iy0;
+        outRaster.pixels.assign(static_cast<size_t>(outRaster.width) * outRaster.height, 0);
+        if (outRaster.width > 0 && outRaster.height > 0) {
+            stbtt_MakeGlyphBitmap(&font.info, outRaster.pixels.data(),
+                                  outRaster.width, outRaster.height, outRaster.width,
+                                  font.scale, font.scale, index);
+        }
+
+        int advance = 0, bearing = 0;
+        stbtt_GetGlyphHMetrics(&font.info, index, &advance, &bearing);
+        outRaster.advance = advance * font.scale;
+        outRaster.x0 = ix0 + font.offset.x;
+        outRaster.y0 = iy0 + mSources->ascent + font.offset.y;
+        outRaster.found = true;
+        return true;
+    }
+    return false;
+}
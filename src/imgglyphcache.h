@@ -0,0 +1,191 @@
+/*
+ * imgglyphcache.h
+ *
+ * On-demand glyph rasterization for the font atlases of the dear imgui
+ * integration into X-Plane.
+ */
+
+#ifndef IMGGLYPHCACHE_H
+#define IMGGLYPHCACHE_H
+
+#include "imggl.h"
+#include "imgui.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgGlyphCache class
+/// \brief ImgGlyphCache adds glyphs to a font atlas while it is in use.
+///
+/// Building an atlas with all glyphs of a large Unicode range takes long
+/// and needs a large texture. With dynamic glyphs enabled in
+/// ImgFontRegistry, an atlas is built with ASCII only and a texture taller
+/// than the built glyphs need. The free part of the texture is divided into
+/// cells of the line height. Glyphs requested with Request() are rasterized
+/// on a thread of the cache, and at the start of the next frame copied into
+/// a free cell with one glTexSubImage2D each and added to the font. When
+/// all cells are taken, the glyph requested longest ago is replaced, and
+/// the windows drawing with the atlas are rebuilt, as the draw data of idle
+/// windows and render caches may still show the replaced glyph.
+///
+/// Glyphs are only added to the first font of the atlas, which holds the
+/// font files of ImgFontRegistry merged. Other fonts of the atlas have the
+/// glyphs they were built with only, Request() does nothing while they are
+/// current.
+///
+/// ImGui draws text without telling which glyphs it looked up, so the text
+/// drawn must be passed to Request() in every frame it is shown, usually
+/// right before the widget showing it. Glyphs not yet rasterized are drawn
+/// as the fallback character for a frame or two.
+///
+/// Request() may be called on any thread building windows. The cache is
+/// created and destroyed by ImgFontRegistry, ImgFrame updates it in the
+/// first draw callback of every frame.
+class ImgGlyphCache {
+    friend class ImgFontRegistry;
+    friend class ImgFrame;
+public:
+    /// Work done by the cache
+    struct Stats {
+        /// glyphs in the texture cells
+        int cached;
+        /// number of cells
+        int capacity;
+        /// glyphs rasterized
+        unsigned long rasterized;
+        /// glyphs replaced by newer ones
+        unsigned long evicted;
+        /// bytes copied to the texture
+        unsigned long uploadedBytes;
+        /// glyphs waiting for rasterization or a cell
+        int pending;
+    };
+
+    ImgGlyphCache(const ImgGlyphCache &) = delete;
+    ImgGlyphCache &operator=(const ImgGlyphCache &) = delete;
+
+    /// Requests the glyphs of a text for the font atlas of the current
+    /// ImGui context. Does nothing if the atlas has no glyph cache or the
+    /// current font is not the first one of the atlas.
+    /// \param text UTF-8 text
+    /// \param textEnd end of the text, nullptr for null terminated text
+    static void Request(const char *text, const char *textEnd = nullptr);
+
+    /// Requests a range of glyphs for the current font atlas, e.g. the
+    /// characters of a language before it is shown
+    /// \param first first code point
+    /// \param last last code point
+    static void RequestRange(ImWchar first, ImWchar last);
+
+    /// Returns the glyph cache of an atlas
+    /// \param atlas font atlas
+    /// \return glyph cache, nullptr if the atlas has none
+    static ImgGlyphCache *Find(const ImFontAtlas *atlas);
+
+    /// Returns the counters of the cache
+    /// \return cache counters
+    Stats GetStats();
+
+private:
+    enum State {
+        /// waiting for the raster thread
+        Queued,
+        /// rasterized, waiting for a cell
+        Rasterized,
+        /// in the texture and the font
+        Cached,
+        /// no font of the atlas has the glyph
+        Missing
+    };
+
+    struct Glyph {
+        State state = Queued;
+        /// cell of the glyph, -1 if none
+        int cell = -1;
+        /// frame of the last request
+        unsigned int lastUsed = 0;
+    };
+
+    struct Raster {
+        ImWchar codepoint;
+        bool found;
+        int width, height;
+        /// offset of the bitmap from the pen position on the line top
+        float x0, y0;
+        float advance;
+        std::vector<unsigned char> pixels;
+    };
+
+    struct Cell {
+        /// code point of the glyph in the cell, 0 if the cell is free
+        ImWchar codepoint = 0;
+        /// index of the glyph in the font
+        int glyph = -1;
+    };
+
+    /// Font files parsed by stb_truetype
+    struct Sources;
+
+    /// Grows the texture of a built atlas and prepares the glyph cells,
+    /// the texture is uploaded by the caller
+    /// \param atlas atlas built with the static glyphs
+    /// \param textureHeight height of the texture in pixels
+    ImgGlyphCache(ImFontAtlas *atlas, int textureHeight);
+
+    ~ImgGlyphCache();
+
+    void request(const char *text, const char *textEnd);
+
+    // queues a glyph, called with mMutex locked
+    void request(ImWchar codepoint);
+
+    // adds the rasterized glyphs of all caches to their textures
+    // \param outReplaced atlases which had glyphs replaced, the windows
+    // drawing with them must be rebuilt
+    static void updateAll(std::vector<const ImFontAtlas *> &outReplaced);
+
+    // returns true if glyphs of earlier frames were replaced
+    bool update();
+
+    // copies a glyph into a cell and adds it to the font, returns the cell
+    // or -1 if all cells hold glyphs of the last frame
+    int place(const Raster &raster, std::vector<ImWchar> &outEvicted);
+
+    void rasterLoop();
+
+    bool rasterize(ImWchar codepoint, Raster &outRaster);
+
+    ImFontAtlas *mAtlas;
+    ImFont *mFont;
+    /// Glyphs built into the atlas, never requested
+    std::vector<bool> mStatic;
+    std::unique_ptr<Sources> mSources;
+
+    /// Cell grid below the static glyphs
+    int mCellSize = 0;
+    int mColumns = 0;
+    int mTop = 0;
+    std::vector<Cell> mCells;
+
+    /// Glyph states and queues, guarded by mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::unordered_map<ImWchar, Glyph> mGlyphs;
+    std::deque<ImWchar> mQueue;
+    std::vector<Raster> mRasters;
+    unsigned int mFrame = 1;
+    bool mStop = false;
+    std::thread mThread;
+
+    unsigned long mRasterized = 0;
+    unsigned long mEvicted = 0;
+    unsigned long mUploadedBytes = 0;
+};
+
+#endif //IMGGLYPHCACHE_H
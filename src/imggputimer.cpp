@@ -0,0 +1,68 @@
+/*
+ * imggputimer.cpp
+ *
+ * GPU timing for the dear imgui integration into X-Plane.
+ */
+
+#include "imggputimer.h"
+
+/// \file
+/// This file contains the definition of the ImgGpuTimer class
+
+ImgGpuTimer::~ImgGpuTimer() {
+    if (mQueries[0] != 0 && mContext == ImgGL::CurrentContext())
+        ImgGL::Get().DeleteQueries(Capacity, mQueries);
+}
+
+bool ImgGpuTimer::IsAvailable() {
+    return ImgGL::Get().HasTimerQuery;
+}
+
+void ImgGpuTimer::Begin() {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasTimerQuery)
+        return;
+
+    void *context = ImgGL::CurrentContext();
+    if (mQueries[0] == 0) {
+        gl.GenQueries(Capacity, mQueries);
+        mContext = context;
+    }
+    // the results are late, skip instead of waiting for them
+    if (mContext != context || mPending == Capacity)
+        return;
+
+    gl.BeginQuery(GL_TIME_ELAPSED, mQueries[mNext]);
+    mActive = true;
+}
+
+void ImgGpuTimer::End() {
+    if (!mActive)
+        return;
+    ImgGL::Get().EndQuery(GL_TIME_ELAPSED);
+    mActive = false;
+    mNext = (mNext + 1) % Capacity;
+    mPending++;
+}
+
+bool ImgGpuTimer::Poll(float &outMilliseconds) {
+    if (mPending == 0 || mContext != ImgGL::CurrentContext())
+        return false;
+
+    const ImgGL &gl = ImgGL::Get();
+    GLuint query = mQueries[(mNext - mPending + Capacity) % Capacity];
+    GLint available = 0;
+    gl.GetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    ImgGLuint64 nanoseconds = 0;
+    gl.GetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    mPending--;
+    if (mFirstResult) {
+        mFirstResult = false;
+        return Poll(outMilliseconds);
+    }
+    outMilliseconds = static_cast<float>(nanoseconds) / 1.0e6f;
+    return true;
+}
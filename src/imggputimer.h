@@ -0,0 +1,60 @@
+/*
+ * imggputimer.h
+ *
+ * GPU timing for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGGPUTIMER_H
+#define IMGGPUTIMER_H
+
+#include "imggl.h"
+
+/// \file
+/// This file contains the declaration of the ImgGpuTimer class
+/// \brief ImgGpuTimer measures the GPU time of a sequence of OpenGL
+/// commands without waiting for the GPU.
+///
+/// Every Begin()/End() pair issues a GL_TIME_ELAPSED query from a small
+/// ring. Results are read with Poll() only once the driver reports them
+/// available, usually a few frames later. When all queries of the ring are
+/// still in flight the measurement is skipped. Queries are not shared
+/// between OpenGL contexts, so measurements in another context than the
+/// first one are skipped as well.
+class ImgGpuTimer {
+public:
+    static const int Capacity = 4;
+
+    ImgGpuTimer() = default;
+    ~ImgGpuTimer();
+
+    ImgGpuTimer(const ImgGpuTimer &) = delete;
+    ImgGpuTimer &operator=(const ImgGpuTimer &) = delete;
+
+    /// Returns true if the context supports timer queries
+    /// \return true if GPU times can be measured
+    static bool IsAvailable();
+
+    /// Starts a measurement
+    void Begin();
+
+    /// Ends the measurement started by Begin()
+    void End();
+
+    /// Returns the oldest finished measurement
+    /// \param outMilliseconds GPU time in milliseconds
+    /// \return false if no measurement is finished
+    bool Poll(float &outMilliseconds);
+
+private:
+    GLuint mQueries[Capacity] = {};
+    void *mContext = nullptr;
+    /// next query to issue and number of queries in flight
+    int mNext = 0;
+    int mPending = 0;
+    bool mActive = false;
+    /// the first result after creating the queries is dropped, some drivers
+    /// report the time since context creation for it
+    bool mFirstResult = true;
+};
+
+#endif //IMGGPUTIMER_H
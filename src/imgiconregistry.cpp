@@ -0,0 +1,178 @@
+/*
+ * imgiconregistry.cpp
+ *
+ * Icons packed into the font atlases of the dear imgui integration into
+ * X-Plane.
+ */
+
+#include "XPLMUtilities.h"
+
+#include "imgiconregistry.h"
+#include "imgimagecache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/// \file
+/// This file contains the definition of the ImgIconRegistry class
+
+// First code point of the icons, the private use area of the basic
+// multilingual plane
+static const int gFirstGlyph = 0xE000;
+static const int gLastGlyph = 0xF8FF;
+
+ImgIconRegistry &ImgIconRegistry::Get() {
+    static ImgIconRegistry registry;
+    return registry;
+}
+
+int ImgIconRegistry::AddIcon(const std::string &name, int width, int height,
+                             const unsigned char *alpha) {
+    int id = Find(name);
+    if (id < 0) {
+        if (gFirstGlyph + static_cast<int>(mIcons.size()) > gLastGlyph)
+            return -1;
+        id = static_cast<int>(mIcons.size());
+        mIcons.push_back(Icon());
+    }
+
+    Icon &icon = mIcons[id];
+    icon.name = name;
+    icon.width = width;
+    icon.height = height;
+    icon.alpha.assign(alpha, alpha + static_cast<size_t>(width) * height);
+    // UTF-8 of a code point between U+0800 and U+FFFF
+    unsigned int c = glyphOf(id);
+    icon.text[0] = static_cast<char>(0xE0 | (c >> 12));
+    icon.text[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    icon.text[2] = static_cast<char>(0x80 | (c & 0x3F));
+    icon.text[3] = '\0';
+    return id;
+}
+
+int ImgIconRegistry::AddIconFile(const std::string &name, const std::string &path) {
+    ImgImageCache::Image image;
+    if (!ImgImageCache::Get().DecodeFile(path, image)) {
+        XPLMDebugString(("imgx: can't load icon " + path + "\n").c_str());
+        return -1;
+    }
+
+    size_t count = static_cast<size_t>(image.width) * image.height;
+    const unsigned char *pixels = image.pixels.data();
+    bool opaque = true;
+    for (size_t i = 0; i < count && opaque; i++)
+        opaque = pixels[i * 4 + 3] == 255;
+
+    std::vector<unsigned char> alpha(count);
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *p = pixels + i * 4;
+        if (opaque)
+            alpha[i] = static_cast<unsigned char>((p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8);
+        else
+            alpha[i] = p[3];
+    }
+    return AddIcon(name, image.width, image.height, alpha.data());
+}
+
+int ImgIconRegistry::Find(const std::string &name) const {
+    for (size_t i = 0; i < mIcons.size(); i++) {
+        if (mIcons[i].name == name)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+int ImgIconRegistry::GetIconCount() const {
+    return static_cast<int>(mIcons.size());
+}
+
+ImVec2 ImgIconRegistry::GetSize(int icon) const {
+    const Icon &entry = mIcons[icon];
+    return ImVec2(static_cast<float>(entry.width), static_cast<float>(entry.height));
+}
+
+ImWchar ImgIconRegistry::GetGlyph(int icon) const {
+    return glyphOf(icon);
+}
+
+const unsigned char *ImgIconRegistry::GetAlpha(int icon) const {
+    return mIcons[icon].alpha.data();
+}
+
+const char *ImgIconRegistry::GetText(int icon) const {
+    return mIcons[icon].text;
+}
+
+void ImgIconRegistry::Image(int icon, const ImVec2 &size, ImU32 tint) {
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    auto it = mRects.find(atlas);
+    if (it == mRects.end() || icon < 0 ||
+            icon >= static_cast<int>(it->second.size()) || it->second[icon] < 0)
+        return;
+
+    ImVec2 uv0, uv1;
+    atlas->CalcCustomRectUV(atlas->GetCustomRectByIndex(it->second[icon]), &uv0, &uv1);
+    ImVec2 drawSize = size.x > 0.0f && size.y > 0.0f ? size : GetSize(icon);
+    ImVec4 color = tint != 0 ? ImGui::ColorConvertU32ToFloat4(tint) :
+                   ImGui::GetStyleColorVec4(ImGuiCol_Text);
+    // the same texture as the text, ImGui continues the current draw command
+    ImGui::Image(atlas->TexID, drawSize, uv0, uv1, color);
+}
+
+void ImgIconRegistry::BuildAtlas(ImFontAtlas *atlas) {
+    if (mRects.count(atlas) != 0)
+        return;
+    PrepareAtlas(atlas);
+    atlas->Build();
+    RenderIcons(atlas);
+}
+
+void ImgIconRegistry::PrepareAtlas(ImFontAtlas *atlas) {
+    if (mRects.count(atlas) != 0)
+        return;
+    std::vector<int> &rects = mRects[atlas];
+    rects.assign(mIcons.size(), -1);
+
+    // every font of the atlas gets the icons as glyphs, vertically centered
+    // on its line, Image() uses the rects of the first font
+    for (int c = 0; c < atlas->ConfigData.Size; c++) {
+        const ImFontConfig &config = atlas->ConfigData[c];
+        if (config.MergeMode || config.DstFont == nullptr)
+            continue;
+        for (size_t i = 0; i < mIcons.size(); i++) {
+            const Icon &icon = mIcons[i];
+            float offsetY = std::max(0.0f, std::floor((config.SizePixels - icon.height) * 0.5f));
+            int rect = atlas->AddCustomRectFontGlyph(config.DstFont, glyphOf(static_cast<int>(i)),
+                                                     icon.width, icon.height,
+                                                     icon.width + 1.0f, ImVec2(0.0f, offsetY));
+            if (rects[i] < 0)
+                rects[i] = rect;
+        }
+    }
+}
+
+void ImgIconRegistry::RenderIcons(ImFontAtlas *atlas) {
+    if (atlas->TexPixelsAlpha8 == nullptr)
+        return;
+    // the rects of all fonts, found by their glyph
+    for (const ImFontAtlas::CustomRect &rect : atlas->CustomRects) {
+        int i = static_cast<int>(rect.ID) - gFirstGlyph;
+        if (rect.Font == nullptr || i < 0 || i >= static_cast<int>(mIcons.size()) ||
+                !rect.IsPacked())
+            continue;
+        const Icon &icon = mIcons[i];
+        for (int y = 0; y < icon.height; y++) {
+            memcpy(atlas->TexPixelsAlpha8 + (rect.Y + y) * atlas->TexWidth + rect.X,
+                   icon.alpha.data() + static_cast<size_t>(y) * icon.width, icon.width);
+        }
+    }
+}
+
+void ImgIconRegistry::ForgetAtlas(ImFontAtlas *atlas) {
+    mRects.erase(atlas);
+}
+
+ImWchar ImgIconRegistry::glyphOf(int icon) {
+    return static_cast<ImWchar>(gFirstGlyph + icon);
+}
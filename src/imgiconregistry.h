@@ -0,0 +1,137 @@
+/*
+ * imgiconregistry.h
+ *
+ * Icons packed into the font atlases of the dear imgui integration into
+ * X-Plane.
+ */
+
+#ifndef IMGICONREGISTRY_H
+#define IMGICONREGISTRY_H
+
+#include "imgui.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgIconRegistry class
+/// \brief ImgIconRegistry puts small icons into the font atlas, so icons
+/// and text are drawn with the same texture.
+///
+/// ImGui starts a new draw command, and the renderer binds a texture, for
+/// every change of texture within a window. An icon in a texture of its own
+/// thus splits the text around it into separate draw calls. The registry
+/// packs the registered icons into custom rects of every font atlas built
+/// by ImgFontRegistry, and registers each icon as a glyph of the atlas
+/// fonts in the private use area of Unicode. An icon is drawn with Image()
+/// or as part of any text through GetText(), both use the atlas texture and
+/// batch with the surrounding text.
+///
+/// The atlas texture has a single alpha channel, so icons are coverage
+/// masks tinted with the text color like the glyphs of an icon font. Icons
+/// are rasterized at a fixed size, register one icon per size needed.
+///
+/// Icons must be registered before the windows using them are created,
+/// atlases built earlier don't contain them. Atlases not built by
+/// ImgFontRegistry get the icons through BuildAtlas().
+class ImgIconRegistry {
+public:
+    /// Returns the icon registry of the plugin
+    static ImgIconRegistry &Get();
+
+    ImgIconRegistry(const ImgIconRegistry &) = delete;
+    ImgIconRegistry &operator=(const ImgIconRegistry &) = delete;
+
+    /// Adds an icon from a coverage mask
+    /// \param name unique name of the icon
+    /// \param width width in pixels
+    /// \param height height in pixels
+    /// \param alpha width * height coverage values, rows from top to bottom
+    /// \return icon id, -1 if there are too many icons
+    int AddIcon(const std::string &name, int width, int height,
+                const unsigned char *alpha);
+
+    /// Adds an icon from an image file decoded by ImgImageCache. The
+    /// coverage is the alpha channel of the image, or the luminance for
+    /// images without transparency.
+    /// \param name unique name of the icon
+    /// \param path path of the image file rasterized at the icon size
+    /// \return icon id, -1 if the file can't be decoded
+    int AddIconFile(const std::string &name, const std::string &path);
+
+    /// Returns the id of an icon
+    /// \param name name of the icon
+    /// \return icon id, -1 if there is no such icon
+    int Find(const std::string &name) const;
+
+    /// Returns the number of icons
+    /// \return icon count
+    int GetIconCount() const;
+
+    /// Returns the size of an icon
+    /// \param icon icon id
+    /// \return size in pixels
+    ImVec2 GetSize(int icon) const;
+
+    /// Returns the glyph of an icon in the atlas fonts
+    /// \param icon icon id
+    /// \return code point in the private use area
+    ImWchar GetGlyph(int icon) const;
+
+    /// Returns the coverage mask of an icon
+    /// \param icon icon id
+    /// \return width * height coverage values
+    const unsigned char *GetAlpha(int icon) const;
+
+    /// Returns the icon as UTF-8 text, for labels of buttons and menus
+    /// \param icon icon id
+    /// \return null terminated text
+    const char *GetText(int icon) const;
+
+    /// Draws an icon like ImGui::Image() with the texture of the current
+    /// font atlas. Nothing is drawn if the atlas doesn't contain the icon.
+    /// \param icon icon id
+    /// \param size drawn size, 0 for the icon size
+    /// \param tint color, 0 for the text color
+    void Image(int icon, const ImVec2 &size = ImVec2(0, 0), ImU32 tint = 0);
+
+    /// Adds the icons to an atlas and builds it. Called by ImgFontRegistry,
+    /// atlases built by the plugin itself need it before their texture is
+    /// created.
+    /// \param atlas atlas to build
+    void BuildAtlas(ImFontAtlas *atlas);
+
+    /// Adds the custom rects of the icons to an atlas not built yet, the
+    /// first step of BuildAtlas()
+    /// \param atlas atlas to add the icons to
+    void PrepareAtlas(ImFontAtlas *atlas);
+
+    /// Copies the icons into the pixels of an atlas built after
+    /// PrepareAtlas(), the last step of BuildAtlas()
+    /// \param atlas built atlas
+    void RenderIcons(ImFontAtlas *atlas);
+
+    /// Forgets an atlas before it is destroyed
+    /// \param atlas atlas built with BuildAtlas()
+    void ForgetAtlas(ImFontAtlas *atlas);
+
+private:
+    struct Icon {
+        std::string name;
+        int width;
+        int height;
+        std::vector<unsigned char> alpha;
+        char text[4];
+    };
+
+    ImgIconRegistry() = default;
+
+    static ImWchar glyphOf(int icon);
+
+    std::vector<Icon> mIcons;
+    /// Index of the custom rect of every icon per atlas
+    std::map<const ImFontAtlas *, std::vector<int>> mRects;
+};
+
+#endif //IMGICONREGISTRY_H
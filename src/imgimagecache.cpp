@@ -0,0 +1,559 @@
+/*
+ * imgimagecache.cpp
+ *
+ * Asynchronous image loading and texture streaming for ImgWindows.
+ */
+
+#include "imgimagecache.h"
+#include "imgglstate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+
+/// \file
+/// This file contains the definition of the ImgImageCache class
+
+// Color of the placeholder, a faint grey which works on light and dark
+// window backgrounds
+static const unsigned char gPlaceholderPixel[4] = {128, 128, 128, 64};
+
+static bool readFile(const std::string &path, std::vector<unsigned char> &outData) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    outData.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+static ImTextureID textureID(GLuint texture) {
+    return (void *) (uintptr_t) texture;
+}
+
+ImgImageCache &ImgImageCache::Get() {
+    static ImgImageCache cache;
+    return cache;
+}
+
+ImTextureID ImgImageCache::GetTexture(const std::string &path, ImVec2 *outSize) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<Entry> entry = request(path);
+    entry->lastUsed = mFrame;
+    if (outSize != nullptr)
+        *outSize = ImVec2(static_cast<float>(entry->width),
+                          static_cast<float>(entry->height));
+    if (entry->state != Ready)
+        return textureID(mPlaceholder);
+    return textureID(entry->texture);
+}
+
+bool ImgImageCache::IsReady(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    return it != mEntries.end() && it->second->state == Ready;
+}
+
+void ImgImageCache::Preload(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    request(path)->lastUsed = mFrame;
+}
+
+void ImgImageCache::Evict(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(path);
+    if (it == mEntries.end())
+        return;
+    Entry &entry = *it->second;
+    // queued entries are skipped by the decode threads and the upload,
+    // the texture is deleted in the draw callback
+    entry.dropped = true;
+    if (entry.texture != 0 && entry.state == Ready) {
+        mDeadTextures.push_back(entry.texture);
+        mTextureBytes -= static_cast<size_t>(entry.width) * entry.height * 4;
+        entry.texture = 0;
+    }
+    mEntries.erase(it);
+}
+
+void ImgImageCache::SetDecoder(Decoder decoder) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDecoder = std::move(decoder);
+}
+
+void ImgImageCache::SetDecodeThreads(int threads) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mThreadCount = std::max(threads, 1);
+}
+
+void ImgImageCache::SetUploadBudget(size_t bytes) {
+    mUploadBudget = std::max<size_t>(bytes, 1);
+}
+
+void ImgImageCache::SetMemoryLimit(size_t bytes) {
+    mMemoryLimit = bytes;
+}
+
+ImgImageCache::Stats ImgImageCache::GetStats() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats;
+    stats.decoded = mDecoded;
+    stats.failed = mFailed;
+    stats.uploadedBytes = mUploadedBytes;
+    stats.throttledFrames = mThrottledFrames;
+    stats.evicted = mEvicted;
+    stats.textureBytes = mTextureBytes;
+    stats.pending = static_cast<int>(mDecodeQueue.size() + mUploadQueue.size()) +
+                    (mUploading ? 1 : 0);
+    return stats;
+}
+
+std::shared_ptr<ImgImageCache::Entry> ImgImageCache::request(const std::string &path) {
+    auto it = mEntries.find(path);
+    if (it != mEntries.end())
+        return it->second;
+
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->path = path;
+    mEntries[path] = entry;
+    mDecodeQueue.push_back(entry);
+    if (mThreads.empty() && !mStop) {
+        for (int i = 0; i < mThreadCount; i++)
+            mThreads.emplace_back(&ImgImageCache::decodeLoop, this);
+    } else {
+        mWake.notify_one();
+    }
+    return entry;
+}
+
+void ImgImageCache::decodeLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mWake.wait(lock, [this] { return mStop || !mDecodeQueue.empty(); });
+        if (mStop)
+            return;
+        std::shared_ptr<Entry> entry = std::move(mDecodeQueue.front());
+        mDecodeQueue.pop_front();
+        if (entry->dropped)
+            continue;
+        entry->state = Decoding;
+        lock.unlock();
+
+        // the entry is not touched by other threads while it is decoding
+        Image image;
+        bool ok = DecodeFile(entry->path, image);
+
+        lock.lock();
+        if (!ok) {
+            entry->state = Failed;
+            mFailed++;
+            continue;
+        }
+        mDecoded++;
+        if (entry->dropped)
+            continue;
+        entry->width = image.width;
+        entry->height = image.height;
+        entry->image = std::move(image);
+        entry->state = Decoded;
+        mUploadQueue.push_back(entry);
+    }
+}
+
+bool ImgImageCache::DecodeFile(const std::string &path, Image &outImage) {
+    Decoder decoder;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        decoder = mDecoder;
+    }
+    // file access and decoding run without the lock. A file too large for
+    // memory fails like a corrupt one instead of ending the decode thread.
+    try {
+        std::vector<unsigned char> file;
+        if (!readFile(path, file))
+            return false;
+        if (!(decoder && decoder(file, outImage)) && !decode(file, outImage))
+            return false;
+    } catch (const std::bad_alloc &) {
+        outImage = Image();
+        return false;
+    }
+    return outImage.width > 0 && outImage.height > 0 &&
+           outImage.pixels.size() == static_cast<size_t>(outImage.width) * outImage.height * 4;
+}
+
+bool ImgImageCache::decode(const std::vector<unsigned char> &file, Image &outImage) {
+    if (file.size() >= 2 && file[0] == 'P' && (file[1] == '5' || file[1] == '6'))
+        return decodePnm(file, outImage);
+    // TGA has no signature, the header is checked by the decoder
+    return decodeTga(file, outImage);
+}
+
+bool ImgImageCache::decodeTga(const std::vector<unsigned char> &file, Image &outImage) {
+    if (file.size() < 18)
+        return false;
+    const unsigned char *header = file.data();
+    int idLength = header[0];
+    int colorMapType = header[1];
+    int imageType = header[2];
+    int width = header[12] | header[13] << 8;
+    int height = header[14] | header[15] << 8;
+    int bitsPerPixel = header[16];
+    bool topDown = (header[17] & 0x20) != 0;
+
+    bool rle = imageType == 10 || imageType == 11;
+    bool grey = imageType == 3 || imageType == 11;
+    if (colorMapType != 0 || width == 0 || height == 0)
+        return false;
+    if (imageType != 2 && imageType != 3 && !rle)
+        return false;
+    if (grey ? bitsPerPixel != 8 : (bitsPerPixel != 24 && bitsPerPixel != 32))
+        return false;
+
+    size_t pixelSize = bitsPerPixel / 8;
+    size_t count = static_cast<size_t>(width) * height;
+    const unsigned char *p = file.data() + 18 + idLength;
+    const unsigned char *end = file.data() + file.size();
+    if (p > end)
+        return false;
+    // the header size is checked against the data before the pixels are
+    // allocated: raw data holds every pixel, an RLE packet of a count byte
+    // and a pixel covers at most 128
+    size_t payload = static_cast<size_t>(end - p);
+    if (rle ? count / 128 > payload / (1 + pixelSize) : payload / pixelSize < count)
+        return false;
+
+    outImage.width = width;
+    outImage.height = height;
+    outImage.pixels.resize(count * 4);
+    unsigned char *out = outImage.pixels.data();
+
+    auto convert = [&](const unsigned char *in, size_t index) {
+        // rows are stored bottom up unless the descriptor says otherwise
+        size_t x = index % width, y = index / width;
+        if (!topDown)
+            y = height - 1 - y;
+        unsigned char *pixel = out + (y * width + x) * 4;
+        if (grey) {
+            pixel[0] = pixel[1] = pixel[2] = in[0];
+            pixel[3] = 255;
+        } else {
+            pixel[0] = in[2];
+            pixel[1] = in[1];
+            pixel[2] = in[0];
+            pixel[3] = pixelSize == 4 ? in[3] : 255;
+        }
+    };
+
+    size_t index = 0;
+    while (index < count) {
+        size_t run = 1;
+        bool repeat = false;
+        if (rle) {
+            if (p >= end)
+                return false;
+            repeat = (*p & 0x80) != 0;
+            run = (*p & 0x7f) + 1u;
+            p++;
+            run = std::min(run, count - index);
+        } else {
+            run = count;
+        }
+        size_t bytes = repeat ? pixelSize : run * pixelSize;
+        if (static_cast<size_t>(end - p) < bytes)
+            return false;
+        for (size_t i = 0; i < run; i++)
+            convert(repeat ? p : p + i * pixelSize, index + i);
+        p += bytes;
+        index += run;
+    }
+    return true;
+}
+
+bool ImgImageCache::decodePnm(const std::vector<unsigned char> &file, Image &outImage) {
+    bool grey = file[1] == '5';
+    size_t pos = 2;
+    int values[3];
+    for (int &value : values) {
+        // whitespace and comments between the header fields
+        for (;;) {
+            while (pos < file.size() && isspace(file[pos]))
+                pos++;
+            if (pos < file.size() && file[pos] == '#') {
+                while (pos < file.size() && file[pos] != '\n')
+                    pos++;
+                continue;
+            }
+            break;
+        }
+        if (pos >= file.size() || !isdigit(file[pos]))
+            return false;
+        value = 0;
+        while (pos < file.size() && isdigit(file[pos]) && value < 65536)
+            value = value * 10 + (file[pos++] - '0');
+    }
+    int width = values[0], height = values[1], maxValue = values[2];
+    if (width <= 0 || height <= 0 || maxValue <= 0 || maxValue > 255)
+        return false;
+    // a single whitespace character ends the header
+    pos++;
+
+    size_t count = static_cast<size_t>(width) * height;
+    size_t channels = grey ? 1 : 3;
+    if (pos > file.size() || file.size() - pos < count * channels)
+        return false;
+
+    outImage.width = width;
+    outImage.height = height;
+    outImage.pixels.resize(count * 4);
+    const unsigned char *in = file.data() + pos;
+    unsigned char *out = outImage.pixels.data();
+    for (size_t i = 0; i < count; i++, in += channels, out += 4) {
+        for (int c = 0; c < 3; c++)
+            out[c] = static_cast<unsigned char>(in[grey ? 0 : c] * 255 / maxValue);
+        out[3] = 255;
+    }
+    return true;
+}
+
+void ImgImageCache::update() {
+    std::vector<GLuint> deadTextures;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFrame++;
+        // textures drawn in the last frame are deleted once the windows
+        // drawing them were rebuilt
+        std::vector<GLuint> drawnTextures;
+        for (GLuint texture : mDeadTextures) {
+            auto it = mDrawnFrames.find(texture);
+            if (it != mDrawnFrames.end() && it->second + 1 >= mFrame) {
+                drawnTextures.push_back(texture);
+                continue;
+            }
+            if (it != mDrawnFrames.end())
+                mDrawnFrames.erase(it);
+            deadTextures.push_back(texture);
+        }
+        mDeadTextures.swap(drawnTextures);
+        if (!deadTextures.empty())
+            mDeleteSerial++;
+    }
+    if (!deadTextures.empty()) {
+        glDeleteTextures(static_cast<GLsizei>(deadTextures.size()), deadTextures.data());
+        // a new texture may get the name of a deleted one
+        ImgGLState::Get().Invalidate();
+    }
+
+    if (mPlaceholder == 0) {
+        glGenTextures(1, &mPlaceholder);
+        ImgGLState::Get().BindTexture(mPlaceholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, gPlaceholderPixel);
+    }
+
+    size_t budget = mUploadBudget;
+    while (budget > 0) {
+        if (!mUploading) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mUploadQueue.empty())
+                break;
+            mUploading = std::move(mUploadQueue.front());
+            mUploadQueue.pop_front();
+        }
+        // the image is only uploaded by this thread, the lock is not held
+        // while the GL copies the pixels
+        if (!mUploading->dropped && !upload(*mUploading, budget)) {
+            // the rest of the image follows in the next frames
+            std::lock_guard<std::mutex> lock(mMutex);
+            mThrottledFrames++;
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Entry &entry = *mUploading;
+        entry.image = Image();
+        if (entry.dropped) {
+            // evicted while uploading
+            if (entry.texture != 0)
+                mDeadTextures.push_back(entry.texture);
+            entry.texture = 0;
+        } else {
+            entry.state = Ready;
+            mDrawnFrames[entry.texture] = 0;
+            mTextureBytes += static_cast<size_t>(entry.width) * entry.height * 4;
+        }
+        mUploading.reset();
+    }
+
+    evict();
+}
+
+bool ImgImageCache::upload(Entry &entry, size_t &budget) {
+    const ImgGL &gl = ImgGL::Get();
+    ImgGLState &state = ImgGLState::Get();
+    if (entry.texture == 0) {
+        glGenTextures(1, &entry.texture);
+        state.BindTexture(entry.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, entry.width, entry.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        state.BindTexture(entry.texture);
+    }
+
+    // at least one row per frame, so images wider than the budget finish
+    size_t rowBytes = static_cast<size_t>(entry.width) * 4;
+    int rows = static_cast<int>(std::min<size_t>(budget / rowBytes,
+                                                 entry.height - entry.uploadedRows));
+    rows = std::max(rows, 1);
+    size_t bytes = rows * rowBytes;
+    const unsigned char *pixels = entry.image.pixels.data() + entry.uploadedRows * rowBytes;
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (!mUploadBuffer)
+        mUploadBuffer.reset(new ImgStreamBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadBudget));
+    size_t offset = 0;
+    void *mapped = mUploadBuffer->Map(bytes, offset, 4);
+    if (mapped != nullptr) {
+        // the copy into the buffer returns at once, the driver transfers
+        // the pixels to the texture without blocking the sim thread
+        memcpy(mapped, pixels, bytes);
+        mUploadBuffer->Unmap();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, entry.uploadedRows, entry.width, rows,
+                        GL_RGBA, GL_UNSIGNED_BYTE, (const void *) (uintptr_t) offset);
+        mUploadBuffer->Unbind();
+    } else {
+        if (gl.HasBufferObject)
+            mUploadBuffer->Unbind();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, entry.uploadedRows, entry.width, rows,
+                        GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    entry.uploadedRows += rows;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUploadedBytes += bytes;
+    }
+    budget -= std::min(budget, bytes);
+    return entry.uploadedRows == entry.height;
+}
+
+void ImgImageCache::evict() {
+    std::vector<GLuint> textures;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mTextureBytes <= mMemoryLimit)
+            return;
+
+        // textures requested or drawn in the last frame stay, even above
+        // the limit
+        std::vector<std::shared_ptr<Entry>> candidates;
+        for (auto &it : mEntries) {
+            const Entry &entry = *it.second;
+            if (entry.state == Ready && entry.lastUsed + 1 < mFrame &&
+                    mDrawnFrames[entry.texture] + 1 < mFrame)
+                candidates.push_back(it.second);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const std::shared_ptr<Entry> &a, const std::shared_ptr<Entry> &b) {
+                      return a->lastUsed < b->lastUsed;
+                  });
+        for (auto &entry : candidates) {
+            if (mTextureBytes <= mMemoryLimit)
+                break;
+            textures.push_back(entry->texture);
+            mDrawnFrames.erase(entry->texture);
+            mTextureBytes -= static_cast<size_t>(entry->width) * entry->height * 4;
+            mEvicted++;
+            mEntries.erase(entry->path);
+        }
+        if (textures.empty())
+            return;
+        mDeleteSerial++;
+    }
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    ImgGLState::Get().Invalidate();
+}
+
+void ImgImageCache::collectDrawn(const ImDrawData *drawData,
+                                 std::vector<ImTextureID> &outTextures,
+                                 unsigned long &outDeleteSerial) {
+    outTextures.clear();
+    std::lock_guard<std::mutex> lock(mMutex);
+    outDeleteSerial = mDeleteSerial;
+    if (mDrawnFrames.empty())
+        return;
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        for (const ImDrawCmd &cmd : drawData->CmdLists[n]->CmdBuffer) {
+            if (cmd.UserCallback != nullptr)
+                continue;
+            auto it = mDrawnFrames.find(static_cast<GLuint>((uintptr_t) cmd.TextureId));
+            if (it == mDrawnFrames.end() ||
+                    std::find(outTextures.begin(), outTextures.end(), cmd.TextureId) != outTextures.end())
+                continue;
+            it->second = mFrame;
+            outTextures.push_back(cmd.TextureId);
+        }
+    }
+}
+
+bool ImgImageCache::markDrawn(const std::vector<ImTextureID> &textures,
+                              unsigned long deleteSerial) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    // a deleted texture name may have been reused by another image
+    if (deleteSerial != mDeleteSerial)
+        return false;
+    for (ImTextureID textureId : textures) {
+        auto texture = static_cast<GLuint>((uintptr_t) textureId);
+        mDrawnFrames[texture] = mFrame;
+        if (std::find(mDeadTextures.begin(), mDeadTextures.end(), texture) != mDeadTextures.end())
+            return false;
+    }
+    return true;
+}
+
+void ImgImageCache::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (std::thread &thread : mThreads)
+        thread.join();
+    mThreads.clear();
+
+    std::vector<GLuint> textures;
+    textures.swap(mDeadTextures);
+    for (auto &it : mEntries) {
+        if (it.second->texture != 0)
+            textures.push_back(it.second->texture);
+    }
+    if (mUploading && mUploading->texture != 0 && mUploading->dropped)
+        textures.push_back(mUploading->texture);
+    if (mPlaceholder != 0)
+        textures.push_back(mPlaceholder);
+    if (!textures.empty()) {
+        glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+        ImgGLState::Get().Invalidate();
+    }
+
+    mEntries.clear();
+    mDecodeQueue.clear();
+    mUploadQueue.clear();
+    mUploading.reset();
+    mUploadBuffer.reset();
+    mDrawnFrames.clear();
+    mDeleteSerial++;
+    mPlaceholder = 0;
+    mTextureBytes = 0;
+    mStop = false;
+}
@@ -0,0 +1,235 @@
+/*
+ * imgimagecache.h
+ *
+ * Asynchronous image loading and texture streaming for ImgWindows.
+ */
+
+#ifndef IMGIMAGECACHE_H
+#define IMGIMAGECACHE_H
+
+#include "imggl.h"
+#include "imgstreambuffer.h"
+#include "imgui.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgImageCache class
+/// \brief ImgImageCache turns image files into textures without stalling
+/// the sim thread.
+///
+/// GetTexture() returns a placeholder texture until the image is ready, so
+/// BuildInterface() can draw an image from the first frame on. Files are
+/// read and decoded on the decode threads of the cache. The decoded pixels
+/// are uploaded at the start of the following frames through a pixel
+/// buffer object, at most the upload budget per frame: a large image is
+/// uploaded in bands of rows over several frames.
+///
+/// The textures are kept in least recently used order. When they take more
+/// memory than the limit, the textures not drawn in the last frame are
+/// deleted, oldest first, and are loaded again when they are requested
+/// again. A texture counts as drawn while it is in the draw data of a
+/// window, so idle windows and render caches which draw the draw data of an
+/// earlier frame keep their textures. Windows drawing a texture which was
+/// deleted or evicted are rebuilt.
+///
+/// Uncompressed and run-length encoded TGA files and binary PGM and PPM
+/// files are decoded by the cache. Other formats need a decoder set with
+/// SetDecoder(), e.g. one calling stb_image or libpng.
+///
+/// GetTexture() may be called on any thread, the build workers of the
+/// parallel build included. Textures are uploaded and deleted by ImgFrame
+/// in the first draw callback of every frame.
+class ImgImageCache {
+    friend class ImgFrame;
+    friend class ImgWindow;
+public:
+    /// Decoded image
+    struct Image {
+        int width = 0;
+        int height = 0;
+        /// RGBA pixels, rows from top to bottom
+        std::vector<unsigned char> pixels;
+    };
+
+    /// Decodes the content of a file, called on the decode threads
+    typedef std::function<bool(const std::vector<unsigned char> &file,
+                               Image &outImage)> Decoder;
+
+    /// Work done by the cache
+    struct Stats {
+        /// images decoded
+        unsigned long decoded;
+        /// images which could not be read or decoded
+        unsigned long failed;
+        /// bytes uploaded to textures
+        unsigned long long uploadedBytes;
+        /// frames which left an image partly uploaded for lack of budget
+        unsigned long throttledFrames;
+        /// textures deleted to stay within the memory limit
+        unsigned long evicted;
+        /// memory of the loaded textures
+        size_t textureBytes;
+        /// images waiting for decoding or uploading
+        int pending;
+    };
+
+    /// Returns the image cache of the plugin
+    static ImgImageCache &Get();
+
+    ImgImageCache(const ImgImageCache &) = delete;
+    ImgImageCache &operator=(const ImgImageCache &) = delete;
+
+    /// Returns the texture of an image file and starts loading it if
+    /// needed. The texture stays valid until the end of the frame.
+    /// \param path path of the image file
+    /// \param outSize size of the image in pixels, 0 until it is decoded
+    /// \return texture of the image or the placeholder
+    ImTextureID GetTexture(const std::string &path, ImVec2 *outSize = nullptr);
+
+    /// Returns true if the texture of an image is loaded
+    /// \param path path of the image file
+    /// \return false while the placeholder is shown
+    bool IsReady(const std::string &path);
+
+    /// Starts loading an image which will be drawn later
+    /// \param path path of the image file
+    void Preload(const std::string &path);
+
+    /// Deletes the texture of an image, e.g. after the file changed
+    /// \param path path of the image file
+    void Evict(const std::string &path);
+
+    /// Sets a decoder tried before the built-in ones
+    /// \param decoder decoder, nullptr for the built-in decoders only
+    void SetDecoder(Decoder decoder);
+
+    /// Sets the number of decode threads, applied when the threads are
+    /// started with the first image
+    /// \param threads decode threads (default 2)
+    void SetDecodeThreads(int threads);
+
+    /// Sets the bytes uploaded to textures per frame
+    /// \param bytes upload budget (default 4 MiB)
+    void SetUploadBudget(size_t bytes);
+
+    /// Sets the texture memory kept for images not in use
+    /// \param bytes memory limit (default 256 MiB)
+    void SetMemoryLimit(size_t bytes);
+
+    /// Reads and decodes an image file with the decoders of the cache,
+    /// may be called on any thread
+    /// \param path path of the image file
+    /// \param outImage decoded image
+    /// \return false if the file can't be read or decoded
+    bool DecodeFile(const std::string &path, Image &outImage);
+
+    /// Returns the counters since the start
+    /// \return cache counters
+    Stats GetStats();
+
+private:
+    enum State {
+        Queued,
+        Decoding,
+        Decoded,
+        Ready,
+        Failed
+    };
+
+    struct Entry {
+        std::string path;
+        State state = Queued;
+        /// pixels while decoded but not uploaded
+        Image image;
+        int width = 0, height = 0;
+        GLuint texture = 0;
+        int uploadedRows = 0;
+        /// frame of the last GetTexture()
+        unsigned int lastUsed = 0;
+        /// the entry was evicted before its texture was ready
+        bool dropped = false;
+    };
+
+    ImgImageCache() = default;
+
+    // finds or queues the entry of a path, called with mMutex locked
+    std::shared_ptr<Entry> request(const std::string &path);
+
+    // uploads the decoded images and evicts unused textures, called by
+    // ImgFrame at the start of the frame
+    void update();
+
+    // uploads rows of an image within the budget, returns true when the
+    // whole image is uploaded
+    bool upload(Entry &entry, size_t &budget);
+
+    void evict();
+
+    // collects the textures of the cache in the draw data of a window and
+    // marks them drawn, called after the window was built
+    void collectDrawn(const ImDrawData *drawData, std::vector<ImTextureID> &outTextures,
+                      unsigned long &outDeleteSerial);
+
+    // marks the textures of draw data drawn again, returns false if a
+    // texture was evicted or deleted since they were collected and the
+    // window must be rebuilt
+    bool markDrawn(const std::vector<ImTextureID> &textures, unsigned long deleteSerial);
+
+    // stops the decode threads and deletes all textures, called with the
+    // last window
+    void shutdown();
+
+    void decodeLoop();
+
+    static bool decode(const std::vector<unsigned char> &file, Image &outImage);
+
+    static bool decodeTga(const std::vector<unsigned char> &file, Image &outImage);
+
+    static bool decodePnm(const std::vector<unsigned char> &file, Image &outImage);
+
+    /// Entries and queues, guarded by mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> mEntries;
+    std::deque<std::shared_ptr<Entry>> mDecodeQueue;
+    std::deque<std::shared_ptr<Entry>> mUploadQueue;
+    /// textures of evicted entries, deleted in the next update() not drawn
+    /// in the last frame
+    std::vector<GLuint> mDeadTextures;
+    /// frame the textures of the cache were last drawn by a window
+    std::unordered_map<GLuint, unsigned int> mDrawnFrames;
+    /// counter of deletions, windows collected their textures before a
+    /// different value may draw deleted ones
+    unsigned long mDeleteSerial = 0;
+    unsigned int mFrame = 1;
+    bool mStop = false;
+    Decoder mDecoder;
+    unsigned long mDecoded = 0, mFailed = 0;
+    unsigned long long mUploadedBytes = 0;
+    unsigned long mThrottledFrames = 0;
+    unsigned long mEvicted = 0;
+
+    /// Decode threads
+    std::vector<std::thread> mThreads;
+    int mThreadCount = 2;
+
+    /// Upload state of the sim thread
+    std::shared_ptr<Entry> mUploading;
+    std::unique_ptr<ImgStreamBuffer> mUploadBuffer;
+    GLuint mPlaceholder = 0;
+    size_t mUploadBudget = 4 << 20;
+    size_t mMemoryLimit = 256 << 20;
+    size_t mTextureBytes = 0;
+};
+
+#endif //IMGIMAGECACHE_H
@@ -0,0 +1,121 @@
+/*
+ * imgshader.cpp
+ *
+ * GLSL program for the dear imgui integration into X-Plane.
+ */
+
+#include "XPLMUtilities.h"
+
+#include "imgshader.h"
+
+#include <string>
+#include <vector>
+
+/// \file
+/// This file contains the definition of the ImgShaderProgram class
+
+static const char *gVertexShaderSource =
+        "#version 120\n"
+        "uniform mat4 ProjMtx;\n"
+        "attribute vec2 Position;\n"
+        "attribute vec2 UV;\n"
+        "attribute vec4 Color;\n"
+        "varying vec2 Frag_UV;\n"
+        "varying vec4 Frag_Color;\n"
+        "void main() {\n"
+        "    Frag_UV = UV;\n"
+        "    Frag_Color = Color;\n"
+        "    gl_Position = ProjMtx * vec4(Position.xy, 0.0, 1.0);\n"
+        "}\n";
+
+static const char *gFragmentShaderSource =
+        "#version 120\n"
+        "uniform sampler2D Texture;\n"
+        "varying vec2 Frag_UV;\n"
+        "varying vec4 Frag_Color;\n"
+        "void main() {\n"
+        "    gl_FragColor = Frag_Color * texture2D(Texture, Frag_UV.st);\n"
+        "}\n";
+
+ImgShaderProgram::ImgShaderProgram() {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasShaders)
+        return;
+
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, gVertexShaderSource);
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, gFragmentShaderSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        gl.DeleteShader(vertexShader);
+        gl.DeleteShader(fragmentShader);
+        return;
+    }
+
+    mProgram = gl.CreateProgram();
+    gl.AttachShader(mProgram, vertexShader);
+    gl.AttachShader(mProgram, fragmentShader);
+    gl.BindAttribLocation(mProgram, PositionAttribute, "Position");
+    gl.BindAttribLocation(mProgram, UVAttribute, "UV");
+    gl.BindAttribLocation(mProgram, ColorAttribute, "Color");
+    gl.LinkProgram(mProgram);
+    // shaders are deleted together with the program
+    gl.DeleteShader(vertexShader);
+    gl.DeleteShader(fragmentShader);
+
+    GLint status = GL_FALSE;
+    gl.GetProgramiv(mProgram, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        gl.GetProgramiv(mProgram, GL_INFO_LOG_LENGTH, &length);
+        std::vector<ImgGLchar> log(static_cast<size_t>(length) + 1, 0);
+        gl.GetProgramInfoLog(mProgram, length, nullptr, log.data());
+        XPLMDebugString((std::string("imgx: shader link failed: ") +
+                         log.data() + "\n").c_str());
+        gl.DeleteProgram(mProgram);
+        mProgram = 0;
+        return;
+    }
+
+    mProjectionLocation = gl.GetUniformLocation(mProgram, "ProjMtx");
+    mTextureLocation = gl.GetUniformLocation(mProgram, "Texture");
+}
+
+ImgShaderProgram::~ImgShaderProgram() {
+    if (mProgram != 0)
+        ImgGL::Get().DeleteProgram(mProgram);
+}
+
+bool ImgShaderProgram::IsValid() const {
+    return mProgram != 0;
+}
+
+void ImgShaderProgram::Use(const GLfloat projection[16]) {
+    const ImgGL &gl = ImgGL::Get();
+    gl.UseProgram(mProgram);
+    gl.UniformMatrix4fv(mProjectionLocation, 1, GL_FALSE, projection);
+    gl.Uniform1i(mTextureLocation, 0);
+}
+
+void ImgShaderProgram::Release() {
+    ImgGL::Get().UseProgram(0);
+}
+
+GLuint ImgShaderProgram::compile(GLenum type, const char *source) {
+    const ImgGL &gl = ImgGL::Get();
+    GLuint shader = gl.CreateShader(type);
+    gl.ShaderSource(shader, 1, &source, nullptr);
+    gl.CompileShader(shader);
+
+    GLint status = GL_FALSE;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint length = 0;
+        gl.GetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<ImgGLchar> log(static_cast<size_t>(length) + 1, 0);
+        gl.GetShaderInfoLog(shader, length, nullptr, log.data());
+        XPLMDebugString((std::string("imgx: shader compile failed: ") +
+                         log.data() + "\n").c_str());
+        gl.DeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
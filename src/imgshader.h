@@ -0,0 +1,58 @@
+/*
+ * imgshader.h
+ *
+ * GLSL program for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGSHADER_H
+#define IMGSHADER_H
+
+#include "imggl.h"
+
+/// \file
+/// This file contains the declaration of the ImgShaderProgram class
+/// \brief ImgShaderProgram is the GLSL program used by the shader render
+/// backend of ImgWindow.
+///
+/// The program is written in GLSL 1.20 so it links in every compatibility
+/// context X-Plane runs on. Vertices are ImDrawVert in ImGui space, the
+/// transformation to clip space is a single matrix uniform. Textures must
+/// return their coverage in alpha and white in color, single channel font
+/// textures are expected to be swizzled accordingly.
+class ImgShaderProgram {
+public:
+    /// Vertex attribute locations
+    enum Attribute {
+        PositionAttribute = 0,
+        UVAttribute = 1,
+        ColorAttribute = 2
+    };
+
+    /// Compiles and links the program, check IsValid() afterwards
+    ImgShaderProgram();
+
+    ~ImgShaderProgram();
+
+    ImgShaderProgram(const ImgShaderProgram &) = delete;
+    ImgShaderProgram &operator=(const ImgShaderProgram &) = delete;
+
+    /// Returns true if the program compiled and linked
+    /// \return true if the program can be used
+    bool IsValid() const;
+
+    /// Makes the program current and sets its uniforms
+    /// \param projection column-major matrix from ImGui to clip space
+    void Use(const GLfloat projection[16]);
+
+    /// Makes the fixed function pipeline current again
+    void Release();
+
+private:
+    static GLuint compile(GLenum type, const char *source);
+
+    GLuint mProgram = 0;
+    GLint mProjectionLocation = -1;
+    GLint mTextureLocation = -1;
+};
+
+#endif //IMGSHADER_H
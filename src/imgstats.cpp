@@ -0,0 +1,176 @@
+/*
+ * imgstats.cpp
+ *
+ * Frame time metrics for the dear imgui integration into X-Plane.
+ */
+
+#include "imgstats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/// \file
+/// This file contains the definition of the ImgStatsRing and ImgStats
+/// classes
+
+static std::string gPublishPrefix;
+
+// Number of windows published so far, names the dataref group of a window
+static int gPublishedWindows = 0;
+
+void ImgStatsRing::Push(float value) {
+    unsigned int head = mHead.load(std::memory_order_relaxed);
+    mSamples[head % Capacity].store(value, std::memory_order_relaxed);
+    mHead.store(head + 1, std::memory_order_release);
+}
+
+int ImgStatsRing::Snapshot(float outSamples[Capacity]) const {
+    unsigned int head = mHead.load(std::memory_order_acquire);
+    int count = static_cast<int>(std::min(head, static_cast<unsigned int>(Capacity)));
+    for (int i = 0; i < count; i++) {
+        unsigned int index = (head - count + i) % Capacity;
+        outSamples[i] = mSamples[index].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+ImgStats::~ImgStats() {
+    for (Binding &binding : mBindings) {
+        if (binding.ref != nullptr)
+            XPLMUnregisterDataAccessor(binding.ref);
+    }
+    if (mTitleRef != nullptr)
+        XPLMUnregisterDataAccessor(mTitleRef);
+}
+
+ImgStats::TimePoint ImgStats::Now() {
+    return std::chrono::steady_clock::now();
+}
+
+float ImgStats::Elapsed(TimePoint start) {
+    return std::chrono::duration<float, std::milli>(Now() - start).count();
+}
+
+void ImgStats::Push(Metric metric, float value) {
+    mRings[metric].Push(value);
+}
+
+int ImgStats::Snapshot(Metric metric,
+                       float outSamples[ImgStatsRing::Capacity]) const {
+    return mRings[metric].Snapshot(outSamples);
+}
+
+ImgStats::Summary ImgStats::GetSummary(Metric metric) const {
+    Summary summary = {0.0f, 0.0f, 0.0f, 0};
+    float samples[ImgStatsRing::Capacity];
+    int count = mRings[metric].Snapshot(samples);
+    if (count == 0)
+        return summary;
+
+    std::sort(samples, samples + count);
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++)
+        sum += samples[i];
+    int p99 = static_cast<int>(std::ceil(0.99f * count)) - 1;
+
+    summary.min = samples[0];
+    summary.avg = sum / count;
+    summary.p99 = samples[std::max(p99, 0)];
+    summary.count = count;
+    return summary;
+}
+
+const char *ImgStats::GetMetricName(Metric metric) {
+    switch (metric) {
+    case UpdateTime:
+        return "update_ms";
+    case BuildInterfaceTime:
+        return "build_interface_ms";
+    case RenderTime:
+        return "render_ms";
+    case DrawTime:
+        return "draw_ms";
+    case GpuTime:
+        return "gpu_ms";
+    case Vertices:
+        return "vertices";
+    case Indices:
+        return "indices";
+    case Commands:
+        return "commands";
+    case MemoryKiB:
+        return "memory_kib";
+    case Allocations:
+        return "allocations";
+    default:
+        return "";
+    }
+}
+
+void ImgStats::SetTitle(const std::string &title) {
+    mTitle = title;
+}
+
+void ImgStats::SetPublishPrefix(const std::string &prefix) {
+    gPublishPrefix = prefix;
+}
+
+const std::string &ImgStats::GetPublishPrefix() {
+    return gPublishPrefix;
+}
+
+void ImgStats::Publish() {
+    if (gPublishPrefix.empty() || mTitleRef != nullptr)
+        return;
+
+    std::string group = gPublishPrefix + "/window" +
+                        std::to_string(gPublishedWindows++) + "/";
+    for (int m = 0; m < MetricCount; m++) {
+        Binding &binding = mBindings[m];
+        binding.stats = this;
+        binding.metric = static_cast<Metric>(m);
+        binding.ref = XPLMRegisterDataAccessor(
+                (group + GetMetricName(binding.metric)).c_str(),
+                xplmType_FloatArray, 0,
+                nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                nullptr, nullptr, readSummary, nullptr, nullptr, nullptr,
+                &binding, nullptr);
+    }
+    mTitleRef = XPLMRegisterDataAccessor(
+            (group + "title").c_str(), xplmType_Data, 0,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            nullptr, nullptr, nullptr, nullptr, readTitle, nullptr,
+            this, nullptr);
+}
+
+int ImgStats::readSummary(void *inRefcon, float *outValues, int inOffset,
+                          int inMax) {
+    const int size = 3;
+    auto binding = static_cast<Binding *>(inRefcon);
+    Summary summary = binding->stats->GetSummary(binding->metric);
+    if (summary.count == 0)
+        return 0;
+    if (outValues == nullptr)
+        return size;
+
+    const float values[size] = {summary.min, summary.avg, summary.p99};
+    int count = 0;
+    for (int i = inOffset; i < size && count < inMax; i++)
+        outValues[count++] = values[i];
+    return count;
+}
+
+int ImgStats::readTitle(void *inRefcon, void *outValue, int inOffset,
+                        int inMaxLength) {
+    auto stats = static_cast<ImgStats *>(inRefcon);
+    // the string is published with its terminating zero
+    int size = static_cast<int>(stats->mTitle.size()) + 1;
+    if (outValue == nullptr)
+        return size;
+    if (inOffset >= size)
+        return 0;
+    int count = std::min(size - inOffset, inMaxLength);
+    memcpy(outValue, stats->mTitle.c_str() + inOffset, static_cast<size_t>(count));
+    return count;
+}
@@ -0,0 +1,165 @@
+/*
+ * imgstats.h
+ *
+ * Frame time metrics for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGSTATS_H
+#define IMGSTATS_H
+
+#include "XPLMDataAccess.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/// \file
+/// This file contains the declaration of the ImgStatsRing and ImgStats
+/// classes
+/// \brief ImgStats keeps the recent frame metrics of one ImgWindow.
+///
+/// Every metric is a ring of the last samples. One thread at a time writes
+/// the metrics of a window, the sim thread or the worker building it, and
+/// the pool hands the window back before it's written again. Readers on any
+/// thread copy the samples without locking, a reader
+/// racing the writer may see one sample of the next frame. With a publish
+/// prefix set, the min, average and 99th percentile of every metric are
+/// published as float[3] datarefs
+/// <prefix>/window<N>/<metric>, the window title as the byte dataref
+/// <prefix>/window<N>/title. Metrics without samples, e.g. GPU time on a
+/// context without timer queries, read as empty arrays.
+
+/// Lock-free ring of the last float samples
+class ImgStatsRing {
+public:
+    static const int Capacity = 128;
+
+    /// Adds a sample, overwriting the oldest one when full
+    /// \param value sample to add
+    void Push(float value);
+
+    /// Copies the samples, oldest first
+    /// \param outSamples array of Capacity floats
+    /// \return number of samples copied
+    int Snapshot(float outSamples[Capacity]) const;
+
+private:
+    std::atomic<float> mSamples[Capacity];
+    std::atomic<unsigned int> mHead{0};
+};
+
+class ImgStats {
+public:
+    /// Measured values
+    enum Metric {
+        /// ms in updateImGui(), including BuildInterface()
+        UpdateTime,
+        /// ms in BuildInterface()
+        BuildInterfaceTime,
+        /// ms in ImGui::Render()
+        RenderTime,
+        /// ms rendering the draw data, summed over the draw callbacks of a
+        /// frame
+        DrawTime,
+        /// ms the GPU spent on the draw calls of a draw callback, measured
+        /// only with GPU timing enabled and supported
+        GpuTime,
+        /// vertices in the draw data
+        Vertices,
+        /// indices in the draw data
+        Indices,
+        /// ImDrawCmd in the draw data
+        Commands,
+        /// KiB allocated by the ImGui context, sampled every frame
+        MemoryKiB,
+        /// ImGui allocations of the last frame
+        Allocations,
+        MetricCount
+    };
+
+    /// Statistics of the samples of a metric
+    struct Summary {
+        float min;
+        float avg;
+        float p99;
+        /// number of samples
+        int count;
+    };
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    ImgStats() = default;
+    ~ImgStats();
+
+    ImgStats(const ImgStats &) = delete;
+    ImgStats &operator=(const ImgStats &) = delete;
+
+    /// Returns the current time for Elapsed()
+    /// \return current time
+    static TimePoint Now();
+
+    /// Returns the time since a point in milliseconds
+    /// \param start time returned by Now()
+    /// \return elapsed milliseconds
+    static float Elapsed(TimePoint start);
+
+    /// Adds a sample to a metric
+    /// \param metric metric to update
+    /// \param value sample to add
+    void Push(Metric metric, float value);
+
+    /// Copies the samples of a metric, oldest first
+    /// \param metric metric to read
+    /// \param outSamples array of ImgStatsRing::Capacity floats
+    /// \return number of samples copied
+    int Snapshot(Metric metric, float outSamples[ImgStatsRing::Capacity]) const;
+
+    /// Computes min, average and 99th percentile of a metric
+    /// \param metric metric to read
+    /// \return statistics of the metric
+    Summary GetSummary(Metric metric) const;
+
+    /// Returns a short name of a metric, used for datarefs
+    /// \param metric metric
+    /// \return name of the metric
+    static const char *GetMetricName(Metric metric);
+
+    /// Sets the title published with the metrics
+    /// \param title window title
+    void SetTitle(const std::string &title);
+
+    /// Publishes the metrics of the windows created from now on as
+    /// datarefs under the prefix. The prefix must be unique to the plugin.
+    /// \param prefix dataref prefix, empty to not publish
+    static void SetPublishPrefix(const std::string &prefix);
+
+    /// Returns the dataref prefix
+    /// \return dataref prefix, empty if metrics are not published
+    static const std::string &GetPublishPrefix();
+
+    /// Registers the datarefs of the metrics if a prefix is set
+    void Publish();
+
+private:
+    struct Binding {
+        ImgStats *stats;
+        Metric metric;
+        XPLMDataRef ref;
+    };
+
+    static int readSummary(void *inRefcon, float *outValues, int inOffset,
+                           int inMax);
+
+    static int readTitle(void *inRefcon, void *outValue, int inOffset,
+                         int inMaxLength);
+
+    ImgStatsRing mRings[MetricCount];
+
+    std::string mTitle;
+
+    /// Registered datarefs
+    Binding mBindings[MetricCount] = {};
+    XPLMDataRef mTitleRef = nullptr;
+};
+
+#endif //IMGSTATS_H
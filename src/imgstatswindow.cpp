@@ -0,0 +1,60 @@
+/*
+ * imgstatswindow.cpp
+ *
+ * Frame time metrics overlay for the dear imgui integration into X-Plane.
+ */
+
+#include "imgstatswindow.h"
+#include "imgframe.h"
+
+#include <cfloat>
+#include <cstdio>
+
+/// \file
+/// This file contains the definition of the ImgStatsWindow class
+
+ImgStatsWindow::ImgStatsWindow(ImFontAtlas *fontAtlas) : ImgWindow(fontAtlas) {
+    Init(420, 480, 100, 700);
+    SetWindowTitle("Frame metrics");
+}
+
+void ImgStatsWindow::BuildInterface() {
+    const ImgStats::Metric times[] = {
+            ImgStats::UpdateTime, ImgStats::BuildInterfaceTime,
+            ImgStats::RenderTime, ImgStats::DrawTime, ImgStats::GpuTime
+    };
+    float samples[ImgStatsRing::Capacity];
+    char overlay[64];
+
+    for (ImgWindow *window : ImgFrame::Get().Windows()) {
+        const ImgStats &stats = window->GetStats();
+        // titles are not unique
+        ImGui::PushID(window);
+        if (ImGui::CollapsingHeader(window->GetWindowTitle().c_str(),
+                                    ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (ImgStats::Metric metric : times) {
+                int count = stats.Snapshot(metric, samples);
+                ImgStats::Summary summary = stats.GetSummary(metric);
+                if (metric == ImgStats::GpuTime && count == 0) {
+                    ImGui::Text("%s: %s", ImgStats::GetMetricName(metric),
+                                IsGpuTimingAvailable() ? "off" : "unavailable");
+                    continue;
+                }
+                snprintf(overlay, sizeof(overlay), "min %.2f  avg %.2f  p99 %.2f",
+                         summary.min, summary.avg, summary.p99);
+                ImGui::PlotHistogram(ImgStats::GetMetricName(metric), samples,
+                                     count, 0, overlay, 0.0f, FLT_MAX,
+                                     ImVec2(0.0f, 40.0f));
+            }
+            ImGui::Text("avg vertices: %.0f  indices: %.0f  commands: %.0f",
+                        stats.GetSummary(ImgStats::Vertices).avg,
+                        stats.GetSummary(ImgStats::Indices).avg,
+                        stats.GetSummary(ImgStats::Commands).avg);
+            ImgArena::Stats memory = window->GetMemoryStats();
+            ImGui::Text("memory: %.0f KiB  peak: %.0f KiB  allocations/frame: %lu",
+                        memory.liveBytes / 1024.0, memory.peakBytes / 1024.0,
+                        memory.frameAllocations);
+        }
+        ImGui::PopID();
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ * imgstatswindow.h
+ *
+ * Frame time metrics overlay for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGSTATSWINDOW_H
+#define IMGSTATSWINDOW_H
+
+#include "imgwindow.h"
+
+/// \file
+/// This file contains the declaration of the ImgStatsWindow class
+/// \brief ImgStatsWindow shows the frame time metrics of all live
+/// ImgWindows of the plugin, itself included, as histograms of the recent
+/// frames with their min, average and 99th percentile.
+class ImgStatsWindow : public ImgWindow {
+public:
+    /// Creates the window, it is hidden until SetVisible() is called
+    /// \param fontAtlas shared ImFontAtlas
+    explicit ImgStatsWindow(ImFontAtlas *fontAtlas = nullptr);
+
+protected:
+    void BuildInterface() override;
+};
+
+#endif //IMGSTATSWINDOW_H
@@ -0,0 +1,103 @@
+/*
+ * imgstreambuffer.cpp
+ *
+ * Streaming buffer objects for the dear imgui integration into X-Plane.
+ */
+
+#include "imgstreambuffer.h"
+
+/// \file
+/// This file contains the definition of the ImgStreamBuffer class
+
+ImgStreamBuffer::ImgStreamBuffer(GLenum target, size_t initialSize)
+        : mTarget(target), mCapacity(initialSize) {
+}
+
+ImgStreamBuffer::~ImgStreamBuffer() {
+    if (mBuffer != 0)
+        ImgGL::Get().DeleteBuffers(1, &mBuffer);
+}
+
+void *ImgStreamBuffer::Map(size_t size, size_t &outOffset, size_t alignment) {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasBufferObject || mMapped)
+        return nullptr;
+
+    if (mBuffer == 0) {
+        gl.GenBuffers(1, &mBuffer);
+        gl.BindBuffer(mTarget, mBuffer);
+        orphan(size);
+    } else {
+        gl.BindBuffer(mTarget, mBuffer);
+    }
+
+    size_t offset = (mOffset + alignment - 1) / alignment * alignment;
+    if (offset + size > mCapacity) {
+        orphan(size);
+        offset = 0;
+    }
+
+    void *ptr;
+    if (gl.HasMapBufferRange) {
+        // the range has never been used since the last orphaning, so there
+        // is nothing to synchronize with
+        ptr = gl.MapBufferRange(mTarget, static_cast<ImgGLintptr>(offset),
+                                static_cast<ImgGLsizeiptr>(size),
+                                GL_MAP_WRITE_BIT |
+                                GL_MAP_INVALIDATE_RANGE_BIT |
+                                GL_MAP_UNSYNCHRONIZED_BIT);
+        if (ptr == nullptr)
+            return nullptr;
+    } else {
+        if (mStaging.size() < size)
+            mStaging.resize(size);
+        ptr = mStaging.data();
+    }
+
+    mMapped = true;
+    mMappedOffset = offset;
+    mMappedSize = size;
+    mOffset = offset + size;
+    outOffset = offset;
+    return ptr;
+}
+
+void ImgStreamBuffer::Unmap() {
+    if (!mMapped)
+        return;
+    const ImgGL &gl = ImgGL::Get();
+    if (gl.HasMapBufferRange) {
+        gl.UnmapBuffer(mTarget);
+    } else {
+        gl.BufferSubData(mTarget, static_cast<ImgGLintptr>(mMappedOffset),
+                         static_cast<ImgGLsizeiptr>(mMappedSize),
+                         mStaging.data());
+    }
+    mMapped = false;
+}
+
+void ImgStreamBuffer::Bind() {
+    ImgGL::Get().BindBuffer(mTarget, mBuffer);
+}
+
+void ImgStreamBuffer::Unbind() {
+    ImgGL::Get().BindBuffer(mTarget, 0);
+}
+
+unsigned long ImgStreamBuffer::Generation() const {
+    return mGeneration;
+}
+
+size_t ImgStreamBuffer::Capacity() const {
+    return mCapacity;
+}
+
+void ImgStreamBuffer::orphan(size_t minSize) {
+    // grow so a few frames of this size fit before the next orphaning
+    while (mCapacity < minSize * 4)
+        mCapacity *= 2;
+    ImgGL::Get().BufferData(mTarget, static_cast<ImgGLsizeiptr>(mCapacity),
+                            nullptr, GL_STREAM_DRAW);
+    mOffset = 0;
+    mGeneration++;
+}
@@ -0,0 +1,77 @@
+/*
+ * imgstreambuffer.h
+ *
+ * Streaming buffer objects for the dear imgui integration into X-Plane.
+ */
+
+#ifndef IMGSTREAMBUFFER_H
+#define IMGSTREAMBUFFER_H
+
+#include "imggl.h"
+
+#include <cstddef>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgStreamBuffer class
+/// \brief ImgStreamBuffer is a ring of buffer object memory which is written
+/// once per frame and drawn from with offsets.
+///
+/// Every Map() call allocates the next range of the buffer. When the buffer
+/// is full it is orphaned: the driver hands out fresh storage while the GPU
+/// still reads the old one, so mapped ranges are never synchronized with
+/// pending draws. Generation() changes with every orphaning, offsets returned
+/// before that must not be used anymore.
+class ImgStreamBuffer {
+public:
+    /// Constructs a buffer, the GL object is created on first use
+    /// \param target GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+    /// \param initialSize initial size of the buffer in bytes
+    ImgStreamBuffer(GLenum target, size_t initialSize);
+
+    ~ImgStreamBuffer();
+
+    ImgStreamBuffer(const ImgStreamBuffer &) = delete;
+    ImgStreamBuffer &operator=(const ImgStreamBuffer &) = delete;
+
+    /// Binds the buffer and returns memory to write size bytes to
+    /// \param size size of the range in bytes
+    /// \param outOffset offset of the range in the buffer
+    /// \param alignment the offset is a multiple of it, use the vertex size
+    /// to draw with base vertices
+    /// \return pointer to write the data to or nullptr on failure
+    void *Map(size_t size, size_t &outOffset, size_t alignment = 16);
+
+    /// Finishes writing the range returned by Map(), the buffer stays bound
+    void Unmap();
+
+    /// Binds the buffer to its target
+    void Bind();
+
+    /// Binds no buffer to the target of this buffer
+    void Unbind();
+
+    /// Returns the number of orphanings of the buffer
+    /// \return generation of the buffer storage
+    unsigned long Generation() const;
+
+    /// Returns the size of the buffer storage
+    /// \return size in bytes
+    size_t Capacity() const;
+
+private:
+    void orphan(size_t minSize);
+
+    GLenum mTarget;
+    GLuint mBuffer = 0;
+    size_t mCapacity;
+    size_t mOffset = 0;
+    unsigned long mGeneration = 0;
+
+    /// Staging memory used when buffer mapping is not supported
+    std::vector<unsigned char> mStaging;
+    size_t mMappedOffset = 0, mMappedSize = 0;
+    bool mMapped = false;
+};
+
+#endif //IMGSTREAMBUFFER_H
@@ -0,0 +1,538 @@
+/*
+ * imgtable.cpp
+ *
+ * Virtualized table widget for large data sets.
+ */
+
+#include "imgtable.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+/// \file
+/// This file contains the definition of the ImgTableData and ImgTable
+/// classes
+
+// Rows filtered or merged between two deadline checks
+static const size_t gChunkRows = 4096;
+
+// Length of the runs sorted before merging
+static const size_t gRunRows = 4096;
+
+// Work done by the background thread before it looks for a new request
+static const std::chrono::milliseconds gWorkerSlice(5);
+
+// Interval of partial results while filtering
+static const std::chrono::milliseconds gPublishInterval(50);
+
+static char lower(char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static bool containsIgnoreCase(const char *begin, const char *end,
+                               const std::string &pattern) {
+    return std::search(begin, end, pattern.begin(), pattern.end(),
+                       [](char a, char b) { return lower(a) == b; }) != end;
+}
+
+static bool fuzzyMatch(const char *begin, const char *end,
+                       const std::string &pattern) {
+    size_t matched = 0;
+    for (const char *p = begin; p != end && matched < pattern.size(); ++p) {
+        if (lower(*p) == pattern[matched])
+            matched++;
+    }
+    return matched == pattern.size();
+}
+
+int ImgTableData::AddTextColumn(const std::string &name) {
+    Column column;
+    column.name = name;
+    column.type = Text;
+    column.offsets.push_back(0);
+    mColumns.push_back(std::move(column));
+    return static_cast<int>(mColumns.size()) - 1;
+}
+
+int ImgTableData::AddNumberColumn(const std::string &name, const char *format) {
+    Column column;
+    column.name = name;
+    column.type = Number;
+    column.format = format;
+    mColumns.push_back(std::move(column));
+    return static_cast<int>(mColumns.size()) - 1;
+}
+
+void ImgTableData::Reserve(size_t rows, size_t textBytes) {
+    for (Column &column : mColumns) {
+        if (column.type == Text) {
+            column.offsets.reserve(rows + 1);
+            column.chars.reserve(textBytes);
+        } else {
+            column.numbers.reserve(rows);
+        }
+    }
+}
+
+uint32_t ImgTableData::AddRow() {
+    for (Column &column : mColumns) {
+        if (column.type == Text)
+            column.offsets.push_back(static_cast<uint32_t>(column.chars.size()));
+        else
+            column.numbers.push_back(0.0);
+    }
+    return mRowCount++;
+}
+
+void ImgTableData::SetText(int column, const char *text) {
+    Column &target = mColumns[column];
+    // the text of the last row ends where the chars end
+    target.chars.insert(target.chars.end(), text, text + strlen(text));
+    target.offsets.back() = static_cast<uint32_t>(target.chars.size());
+}
+
+void ImgTableData::SetNumber(uint32_t row, int column, double value) {
+    mColumns[column].numbers[row] = value;
+}
+
+uint32_t ImgTableData::GetRowCount() const {
+    return mRowCount;
+}
+
+int ImgTableData::GetColumnCount() const {
+    return static_cast<int>(mColumns.size());
+}
+
+const std::string &ImgTableData::GetColumnName(int column) const {
+    return mColumns[column].name;
+}
+
+ImgTableData::ColumnType ImgTableData::GetColumnType(int column) const {
+    return mColumns[column].type;
+}
+
+const char *ImgTableData::GetText(uint32_t row, int column,
+                                  const char *&outEnd) const {
+    const Column &source = mColumns[column];
+    const char *chars = source.chars.data();
+    outEnd = chars + source.offsets[row + 1];
+    return chars + source.offsets[row];
+}
+
+double ImgTableData::GetNumber(uint32_t row, int column) const {
+    return mColumns[column].numbers[row];
+}
+
+const char *ImgTableData::FormatCell(uint32_t row, int column, char *buffer,
+                                     size_t size, const char *&outEnd) const {
+    const Column &source = mColumns[column];
+    if (source.type == Text)
+        return GetText(row, column, outEnd);
+    int length = snprintf(buffer, size, source.format.c_str(),
+                          source.numbers[row]);
+    length = std::max(0, std::min(length, static_cast<int>(size) - 1));
+    outEnd = buffer + length;
+    return buffer;
+}
+
+ImgTable::ImgTable() = default;
+
+ImgTable::~ImgTable() {
+    SetThreaded(false);
+}
+
+void ImgTable::SetData(std::shared_ptr<const ImgTableData> data) {
+    mSettings.data = std::move(data);
+    mSelectedRow = -1;
+    submit(mSettings);
+}
+
+void ImgTable::SetFilter(const std::string &text, FilterMode mode, int column) {
+    std::string filter = text;
+    std::transform(filter.begin(), filter.end(), filter.begin(), lower);
+    if (filter == mSettings.filter && mode == mSettings.mode &&
+            column == mSettings.filterColumn)
+        return;
+    mSettings.filter = filter;
+    mSettings.mode = mode;
+    mSettings.filterColumn = column;
+    if (text != mFilterText) {
+        strncpy(mFilterText, text.c_str(), sizeof(mFilterText) - 1);
+        mFilterText[sizeof(mFilterText) - 1] = '\0';
+    }
+    submit(mSettings);
+}
+
+void ImgTable::SetSort(int column, bool ascending) {
+    if (column == mSettings.sortColumn && ascending == mSettings.ascending)
+        return;
+    mSettings.sortColumn = column;
+    mSettings.ascending = ascending;
+    submit(mSettings);
+}
+
+void ImgTable::SetThreaded(bool inEnable) {
+    mThreaded = inEnable;
+    if (inEnable) {
+        // the worker takes over a job started by Draw()
+        wakeWorker();
+        return;
+    }
+    if (!mThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+    mStop = false;
+}
+
+void ImgTable::SetTimeBudget(float seconds) {
+    mTimeBudget = seconds;
+}
+
+void ImgTable::SetShowFilter(bool inShow) {
+    mShowFilter = inShow;
+}
+
+size_t ImgTable::GetShownRowCount() const {
+    return mView.rows ? mView.rows->size() : 0;
+}
+
+bool ImgTable::IsBusy() const {
+    return mView.generation != mSettings.generation || !mView.complete;
+}
+
+int64_t ImgTable::GetSelectedRow() const {
+    return mSelectedRow;
+}
+
+void ImgTable::submit(Request &request) {
+    request.generation++;
+    wakeWorker();
+}
+
+void ImgTable::wakeWorker() {
+    if (!mThreaded || mSettings.generation == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequest = mSettings;
+    }
+    if (!mThread.joinable())
+        mThread = std::thread(&ImgTable::workerLoop, this);
+    else
+        mWake.notify_one();
+}
+
+void ImgTable::workerLoop() {
+    for (;;) {
+        Request request;
+        bool restart = false;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] {
+                return mStop || mRequest.generation != mJob.request.generation ||
+                       mJob.phase != Job::Done;
+            });
+            if (mStop)
+                return;
+            if (mRequest.generation != mJob.request.generation) {
+                request = mRequest;
+                restart = true;
+            }
+        }
+        // a new request drops the running job
+        if (restart)
+            startJob(mJob, request);
+        stepJob(mJob, Clock::now() + gWorkerSlice);
+        publish(mJob, false);
+    }
+}
+
+void ImgTable::startJob(Job &job, const Request &request) {
+    job.request = request;
+    job.rows.clear();
+    job.scratch.clear();
+    job.candidates.reset();
+    job.position = 0;
+    job.phase = Job::Filtering;
+    job.lastPublish = Clock::now();
+
+    const Request &last = mLastRequest;
+    bool sameFilter = false, narrower = false, sameSort = false;
+    if (mHasLast && last.data == request.data && last.mode == request.mode &&
+            last.filterColumn == request.filterColumn) {
+        sameFilter = last.filter == request.filter;
+        // rows matching the longer filter are a subset of the last result
+        if (request.mode == Substring)
+            narrower = request.filter.find(last.filter) != std::string::npos;
+        else
+            narrower = request.filter.compare(0, last.filter.size(), last.filter) == 0;
+        sameSort = last.sortColumn == request.sortColumn &&
+                   last.ascending == request.ascending;
+    }
+
+    if (sameFilter) {
+        // only the order changes
+        job.rows = *mLastRows;
+        job.presorted = sameSort;
+        job.phase = Job::SortingRuns;
+    } else if (narrower) {
+        // filtering keeps the order of the last result
+        job.candidates = mLastRows;
+        job.presorted = sameSort;
+    } else {
+        // a full scan finds the rows in data order
+        job.presorted = request.sortColumn < 0;
+    }
+    if (request.data == nullptr)
+        job.phase = Job::SortingRuns;
+}
+
+bool ImgTable::stepJob(Job &job, Clock::time_point deadline) {
+    const Request &request = job.request;
+    while (job.phase != Job::Done) {
+        if (Clock::now() >= deadline)
+            return false;
+
+        switch (job.phase) {
+        case Job::Filtering: {
+            size_t total = job.candidates ? job.candidates->size() :
+                           request.data->GetRowCount();
+            size_t end = std::min(job.position + gChunkRows, total);
+            for (size_t i = job.position; i < end; i++) {
+                auto row = job.candidates ? (*job.candidates)[i] :
+                           static_cast<uint32_t>(i);
+                if (matches(request, row))
+                    job.rows.push_back(row);
+            }
+            job.position = end;
+            if (end == total) {
+                job.phase = Job::SortingRuns;
+                job.position = 0;
+            }
+            break;
+        }
+        case Job::SortingRuns: {
+            if (job.presorted || job.rows.size() < 2) {
+                job.phase = Job::Done;
+                break;
+            }
+            size_t end = std::min(job.position + gRunRows, job.rows.size());
+            std::sort(job.rows.begin() + job.position, job.rows.begin() + end,
+                      [this, &request](uint32_t a, uint32_t b) {
+                          return less(request, a, b);
+                      });
+            job.position = end;
+            if (end == job.rows.size()) {
+                if (job.rows.size() <= gRunRows) {
+                    job.phase = Job::Done;
+                    break;
+                }
+                job.phase = Job::Merging;
+                job.scratch.resize(job.rows.size());
+                job.width = gRunRows;
+                job.pairStart = 0;
+                job.left = 0;
+                job.right = std::min(job.width, job.rows.size());
+            }
+            break;
+        }
+        case Job::Merging: {
+            // bottom-up merge sort, resumable within a pair of runs
+            size_t size = job.rows.size();
+            size_t middle = std::min(job.pairStart + job.width, size);
+            size_t end = std::min(job.pairStart + 2 * job.width, size);
+            size_t out = job.left + job.right - middle;
+            size_t stop = std::min(out + gChunkRows, end);
+            while (out < stop) {
+                if (job.right >= end || (job.left < middle &&
+                        !less(request, job.rows[job.right], job.rows[job.left])))
+                    job.scratch[out++] = job.rows[job.left++];
+                else
+                    job.scratch[out++] = job.rows[job.right++];
+            }
+            if (out < end)
+                break;
+            job.pairStart = end;
+            if (job.pairStart >= size) {
+                job.rows.swap(job.scratch);
+                job.width *= 2;
+                job.pairStart = 0;
+                if (job.width >= size) {
+                    job.phase = Job::Done;
+                    break;
+                }
+            }
+            job.left = job.pairStart;
+            job.right = std::min(job.pairStart + job.width, size);
+            break;
+        }
+        case Job::Done:
+            break;
+        }
+    }
+
+    mLastRequest = request;
+    mLastRows = std::make_shared<const std::vector<uint32_t>>(std::move(job.rows));
+    mHasLast = true;
+    job.rows.clear();
+    job.scratch = std::vector<uint32_t>();
+    publish(job, true);
+    return true;
+}
+
+void ImgTable::publish(Job &job, bool force) {
+    View view;
+    view.data = job.request.data;
+    view.generation = job.request.generation;
+    if (force) {
+        view.rows = mLastRows;
+        view.complete = true;
+    } else {
+        // the rows found so far, while sorting the last partial result stays
+        Clock::time_point now = Clock::now();
+        if (job.phase != Job::Filtering || now - job.lastPublish < gPublishInterval)
+            return;
+        job.lastPublish = now;
+        view.rows = std::make_shared<const std::vector<uint32_t>>(job.rows);
+        view.complete = false;
+    }
+    mViews.Write(view);
+}
+
+bool ImgTable::matches(const Request &request, uint32_t row) const {
+    if (request.filter.empty())
+        return true;
+    const ImgTableData &data = *request.data;
+    int first = request.filterColumn >= 0 ? request.filterColumn : 0;
+    int last = request.filterColumn >= 0 ? request.filterColumn + 1 :
+               data.GetColumnCount();
+    for (int column = first; column < last; column++) {
+        if (data.GetColumnType(column) != ImgTableData::Text)
+            continue;
+        const char *end;
+        const char *text = data.GetText(row, column, end);
+        bool found = request.mode == Substring ?
+                     containsIgnoreCase(text, end, request.filter) :
+                     fuzzyMatch(text, end, request.filter);
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+bool ImgTable::less(const Request &request, uint32_t a, uint32_t b) const {
+    int column = request.sortColumn;
+    if (column < 0)
+        return a < b;
+
+    const ImgTableData &data = *request.data;
+    int order = 0;
+    if (data.GetColumnType(column) == ImgTableData::Text) {
+        const char *endA, *endB;
+        const char *textA = data.GetText(a, column, endA);
+        const char *textB = data.GetText(b, column, endB);
+        if (std::lexicographical_compare(textA, endA, textB, endB))
+            order = -1;
+        else if (std::lexicographical_compare(textB, endB, textA, endA))
+            order = 1;
+    } else {
+        double valueA = data.GetNumber(a, column);
+        double valueB = data.GetNumber(b, column);
+        order = valueA < valueB ? -1 : (valueB < valueA ? 1 : 0);
+    }
+    // equal keys keep the data order, so the result is deterministic
+    if (order == 0)
+        return a < b;
+    return request.ascending ? order < 0 : order > 0;
+}
+
+void ImgTable::Draw(const char *id, const ImVec2 &size) {
+    if (!mThreaded) {
+        if (mJob.request.generation != mSettings.generation)
+            startJob(mJob, mSettings);
+        if (mJob.phase != Job::Done) {
+            auto budget = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<float>(mTimeBudget));
+            if (!stepJob(mJob, Clock::now() + budget))
+                publish(mJob, false);
+        }
+    }
+    mView = mViews.Read();
+
+    ImGui::PushID(id);
+    if (mShowFilter) {
+        if (ImGui::InputText("Filter", mFilterText, sizeof(mFilterText)))
+            SetFilter(mFilterText, mSettings.mode, mSettings.filterColumn);
+        ImGui::SameLine();
+        if (IsBusy())
+            ImGui::TextDisabled("%zu rows ...", GetShownRowCount());
+        else
+            ImGui::TextDisabled("%zu rows", GetShownRowCount());
+    }
+
+    if (mView.data != nullptr && mView.data->GetColumnCount() > 0) {
+        ImGui::BeginChild("rows", size, true);
+        ImGui::Columns(mView.data->GetColumnCount(), "columns");
+        drawHeader(*mView.data);
+        ImGui::Separator();
+        drawRows(mView);
+        ImGui::Columns(1);
+        ImGui::EndChild();
+    }
+    ImGui::PopID();
+}
+
+void ImgTable::drawHeader(const ImgTableData &data) {
+    std::string label;
+    for (int column = 0; column < data.GetColumnCount(); column++) {
+        label = data.GetColumnName(column);
+        if (column == mSettings.sortColumn)
+            label += mSettings.ascending ? " ^" : " v";
+        ImGui::PushID(column);
+        if (ImGui::Selectable(label.c_str())) {
+            bool ascending = column != mSettings.sortColumn || !mSettings.ascending;
+            SetSort(column, ascending);
+        }
+        ImGui::PopID();
+        ImGui::NextColumn();
+    }
+}
+
+void ImgTable::drawRows(const View &view) {
+    if (!view.rows)
+        return;
+    const ImgTableData &data = *view.data;
+    const std::vector<uint32_t> &rows = *view.rows;
+    int columns = data.GetColumnCount();
+    char buffer[64];
+
+    // only the rows in view are submitted
+    ImGuiListClipper clipper(static_cast<int>(rows.size()));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            uint32_t row = rows[i];
+            ImGui::PushID(static_cast<int>(row));
+            for (int column = 0; column < columns; column++) {
+                const char *end;
+                const char *text = data.FormatCell(row, column, buffer,
+                                                   sizeof(buffer), end);
+                if (column == 0) {
+                    if (ImGui::Selectable("##row", mSelectedRow == row,
+                                          ImGuiSelectableFlags_SpanAllColumns))
+                        mSelectedRow = row;
+                    ImGui::SameLine();
+                }
+                ImGui::TextUnformatted(text, end);
+                ImGui::NextColumn();
+            }
+            ImGui::PopID();
+        }
+    }
+}
@@ -0,0 +1,311 @@
+/*
+ * imgtable.h
+ *
+ * Virtualized table widget for large data sets.
+ */
+
+#ifndef IMGTABLE_H
+#define IMGTABLE_H
+
+#include "imgchannel.h"
+#include "imgui.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgTableData and ImgTable
+/// classes
+/// \brief ImgTable shows hundreds of thousands of rows in an ImgWindow.
+///
+/// Only the rows in view are submitted to ImGui, through ImGuiListClipper,
+/// so the cost of a frame depends on the height of the table and not on
+/// the number of rows. The data is stored column by column: numbers in one
+/// array per column, text in one character pool per column.
+///
+/// Filtering and sorting run as a job on a background thread of the table.
+/// The job publishes the rows found so far while it filters, Draw() picks
+/// up the latest result without waiting and shows the previous result
+/// until the new one is complete. A filter that extends the last one only
+/// searches the rows of the last result, so typing into the filter field
+/// gets faster with every character. Without the thread, Draw() runs the
+/// job itself for at most the time budget per frame.
+
+/// Column-oriented rows shown by ImgTable. The data is filled once and
+/// handed to the table, it is immutable while the table uses it.
+class ImgTableData {
+public:
+    /// Content of a column
+    enum ColumnType {
+        /// text, filtered and sorted as bytes
+        Text,
+        /// numbers, sorted by value
+        Number
+    };
+
+    ImgTableData() = default;
+
+    ImgTableData(const ImgTableData &) = delete;
+    ImgTableData &operator=(const ImgTableData &) = delete;
+
+    /// Adds a text column, call before adding rows
+    /// \param name header of the column
+    /// \return column index
+    int AddTextColumn(const std::string &name);
+
+    /// Adds a number column, call before adding rows
+    /// \param name header of the column
+    /// \param format printf format of the values
+    /// \return column index
+    int AddNumberColumn(const std::string &name, const char *format = "%g");
+
+    /// Reserves memory for a number of rows
+    /// \param rows expected rows
+    /// \param textBytes expected text bytes per text column
+    void Reserve(size_t rows, size_t textBytes = 0);
+
+    /// Appends a row of empty text and zeros
+    /// \return row index
+    uint32_t AddRow();
+
+    /// Sets a text cell of the last added row
+    /// \param column text column
+    /// \param text text of the cell
+    void SetText(int column, const char *text);
+
+    /// Sets a number cell
+    /// \param row row index
+    /// \param column number column
+    /// \param value value of the cell
+    void SetNumber(uint32_t row, int column, double value);
+
+    /// Returns the number of rows
+    /// \return row count
+    uint32_t GetRowCount() const;
+
+    /// Returns the number of columns
+    /// \return column count
+    int GetColumnCount() const;
+
+    /// Returns the header of a column
+    /// \param column column index
+    /// \return column name
+    const std::string &GetColumnName(int column) const;
+
+    /// Returns the type of a column
+    /// \param column column index
+    /// \return column type
+    ColumnType GetColumnType(int column) const;
+
+    /// Returns a text cell
+    /// \param row row index
+    /// \param column text column
+    /// \param outEnd end of the text
+    /// \return start of the text, not null terminated
+    const char *GetText(uint32_t row, int column, const char *&outEnd) const;
+
+    /// Returns a number cell
+    /// \param row row index
+    /// \param column number column
+    /// \return value of the cell
+    double GetNumber(uint32_t row, int column) const;
+
+    /// Formats a cell for display
+    /// \param row row index
+    /// \param column column index
+    /// \param buffer buffer for number cells
+    /// \param size size of the buffer
+    /// \param outEnd end of the text
+    /// \return start of the text
+    const char *FormatCell(uint32_t row, int column, char *buffer, size_t size,
+                           const char *&outEnd) const;
+
+private:
+    struct Column {
+        std::string name;
+        ColumnType type;
+        std::string format;
+        std::vector<double> numbers;
+        /// start of each text in chars, the next start ends it
+        std::vector<uint32_t> offsets;
+        std::vector<char> chars;
+    };
+
+    std::vector<Column> mColumns;
+    uint32_t mRowCount = 0;
+};
+
+/// Table widget showing an ImgTableData
+class ImgTable {
+public:
+    /// How the filter text is matched
+    enum FilterMode {
+        /// the text contains the filter, ignoring case
+        Substring,
+        /// the text contains the characters of the filter in order,
+        /// ignoring case
+        Fuzzy
+    };
+
+    ImgTable();
+
+    /// Stops the background thread
+    ~ImgTable();
+
+    ImgTable(const ImgTable &) = delete;
+    ImgTable &operator=(const ImgTable &) = delete;
+
+    /// Shows new data, the filter and sorting are applied again
+    /// \param data rows to show
+    void SetData(std::shared_ptr<const ImgTableData> data);
+
+    /// Sets the filter, an empty text shows all rows
+    /// \param text text to search
+    /// \param mode matching mode
+    /// \param column text column to search, -1 for all text columns
+    void SetFilter(const std::string &text, FilterMode mode = Substring,
+                   int column = -1);
+
+    /// Sorts the rows by a column
+    /// \param column column index, -1 for the order of the data
+    /// \param ascending true for ascending order
+    void SetSort(int column, bool ascending = true);
+
+    /// Selects where filtering and sorting run. Without the thread Draw()
+    /// runs them within the time budget, results are the same.
+    /// \param inEnable true to use the background thread (default)
+    void SetThreaded(bool inEnable);
+
+    /// Sets the time Draw() may spend on filtering and sorting per frame
+    /// without the background thread
+    /// \param seconds time budget
+    void SetTimeBudget(float seconds);
+
+    /// Shows or hides the filter input above the table
+    /// \param inShow true to show the filter input (default)
+    void SetShowFilter(bool inShow);
+
+    /// Draws the table into the current ImGui window. Clicking a header
+    /// sorts by its column, clicking it again reverses the order.
+    /// \param id ImGui id of the table
+    /// \param size size of the table, 0 fills the available space
+    void Draw(const char *id, const ImVec2 &size = ImVec2(0, 0));
+
+    /// Returns the number of rows passing the filter in the shown result
+    /// \return shown rows
+    size_t GetShownRowCount() const;
+
+    /// Returns true while a filter or sort job is running
+    /// \return true if the shown result is not final
+    bool IsBusy() const;
+
+    /// Returns the selected row
+    /// \return data row index, -1 if no row is selected
+    int64_t GetSelectedRow() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Everything a job result depends on
+    struct Request {
+        std::shared_ptr<const ImgTableData> data;
+        /// lowercase filter text
+        std::string filter;
+        FilterMode mode = Substring;
+        int filterColumn = -1;
+        int sortColumn = -1;
+        bool ascending = true;
+        unsigned int generation = 0;
+    };
+
+    /// Result of a job as seen by Draw()
+    struct View {
+        std::shared_ptr<const ImgTableData> data;
+        std::shared_ptr<const std::vector<uint32_t>> rows;
+        unsigned int generation = 0;
+        bool complete = true;
+    };
+
+    /// Resumable filter and sort of one request
+    struct Job {
+        enum Phase {
+            Filtering,
+            SortingRuns,
+            Merging,
+            Done
+        };
+
+        Request request;
+        Phase phase = Done;
+        /// rows to test, all rows if not set
+        std::shared_ptr<const std::vector<uint32_t>> candidates;
+        /// the filtered rows are already in the requested order
+        bool presorted = false;
+        size_t position = 0;
+        std::vector<uint32_t> rows;
+        std::vector<uint32_t> scratch;
+        /// merge state: width of the sorted runs, start of the pair and
+        /// the read positions in the left and right run
+        size_t width = 0, pairStart = 0, left = 0, right = 0;
+        Clock::time_point lastPublish;
+    };
+
+    // starts a new generation of the request
+    void submit(Request &request);
+
+    // hands the settings to the worker, starting it if needed
+    void wakeWorker();
+
+    void workerLoop();
+
+    // starts a job, reusing the last result where the request allows
+    void startJob(Job &job, const Request &request);
+
+    // runs the job until it is done or the deadline passed, returns true
+    // when the job is done
+    bool stepJob(Job &job, Clock::time_point deadline);
+
+    // publishes the job state, partial results while filtering
+    void publish(Job &job, bool force);
+
+    bool matches(const Request &request, uint32_t row) const;
+
+    bool less(const Request &request, uint32_t a, uint32_t b) const;
+
+    void drawHeader(const ImgTableData &data);
+
+    void drawRows(const View &view);
+
+    /// Request of the UI, guarded by mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    Request mRequest;
+    bool mStop = false;
+    std::thread mThread;
+
+    /// Settings of the UI thread
+    Request mSettings;
+    bool mThreaded = true;
+    float mTimeBudget = 0.002f;
+    bool mShowFilter = true;
+    char mFilterText[128] = "";
+    int64_t mSelectedRow = -1;
+
+    /// Job state of the processing thread, the worker or Draw()
+    Job mJob;
+    Request mLastRequest;
+    std::shared_ptr<const std::vector<uint32_t>> mLastRows;
+    bool mHasLast = false;
+
+    ImgLatestChannel<View> mViews;
+    /// View shown by Draw()
+    View mView;
+};
+
+#endif //IMGTABLE_H
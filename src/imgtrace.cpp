@@ -0,0 +1,358 @@
+/*
+ * imgtrace.cpp
+ *
+ * Recording and replay of the input of ImgWindows.
+ */
+
+#include "XPLMDisplay.h"
+#include "XPLMUtilities.h"
+
+#include "imgframe.h"
+#include "imgtrace.h"
+#include "imgwindow.h"
+
+#include <algorithm>
+#include <cstring>
+
+/// \file
+/// This file contains the definition of the ImgTraceRecorder and
+/// ImgTracePlayer classes
+
+static const char gTraceMagic[7] = {'I', 'M', 'G', 'X', 'T', 'R', 'C'};
+static const uint8_t gTraceVersion = 1;
+
+// Record types
+enum : uint8_t {
+    RecordWindow = 1,
+    RecordFrame,
+    RecordGeometry,
+    RecordMouseClick,
+    RecordRightClick,
+    RecordMouseWheel,
+    RecordKey
+};
+
+ImgTraceRecorder &ImgTraceRecorder::Get() {
+    static ImgTraceRecorder recorder;
+    return recorder;
+}
+
+ImgTraceRecorder::~ImgTraceRecorder() {
+    Stop();
+}
+
+bool ImgTraceRecorder::Start(const std::string &path) {
+    Stop();
+    mFile = fopen(path.c_str(), "wb");
+    if (mFile == nullptr)
+        return false;
+    write(gTraceMagic, sizeof(gTraceMagic));
+    write(gTraceVersion);
+    mFrameCount = 0;
+    mWindows.clear();
+    return true;
+}
+
+void ImgTraceRecorder::Stop() {
+    if (mFile == nullptr)
+        return;
+    fclose(mFile);
+    mFile = nullptr;
+}
+
+bool ImgTraceRecorder::IsRecording() const {
+    return mFile != nullptr;
+}
+
+int ImgTraceRecorder::GetFrameCount() const {
+    return mFrameCount;
+}
+
+void ImgTraceRecorder::recordFrame(float elapsedTime, int mouseX, int mouseY) {
+    write(RecordFrame);
+    write(elapsedTime);
+    write(static_cast<int32_t>(mouseX));
+    write(static_cast<int32_t>(mouseY));
+    mFrameCount++;
+}
+
+void ImgTraceRecorder::recordGeometry(ImgWindow *window, int left, int top,
+                                      int right, int bottom) {
+    uint16_t id = windowId(window);
+    WindowEntry &entry = mWindows[id];
+    const int geometry[4] = {left, top, right, bottom};
+    if (entry.hasGeometry && std::equal(geometry, geometry + 4, entry.geometry))
+        return;
+    std::copy(geometry, geometry + 4, entry.geometry);
+    entry.hasGeometry = true;
+
+    write(RecordGeometry);
+    write(id);
+    for (int value : geometry)
+        write(static_cast<int32_t>(value));
+}
+
+void ImgTraceRecorder::recordMouseClick(ImgWindow *window, int x, int y,
+                                        int status, bool right) {
+    uint16_t id = windowId(window);
+    write(right ? RecordRightClick : RecordMouseClick);
+    write(id);
+    write(static_cast<int32_t>(x));
+    write(static_cast<int32_t>(y));
+    write(static_cast<uint8_t>(status));
+}
+
+void ImgTraceRecorder::recordMouseWheel(ImgWindow *window, int x, int y,
+                                        int wheel, int clicks) {
+    uint16_t id = windowId(window);
+    write(RecordMouseWheel);
+    write(id);
+    write(static_cast<int32_t>(x));
+    write(static_cast<int32_t>(y));
+    write(static_cast<uint8_t>(wheel));
+    write(static_cast<int32_t>(clicks));
+}
+
+void ImgTraceRecorder::recordKey(ImgWindow *window, char key, int flags,
+                                 char virtualKey) {
+    uint16_t id = windowId(window);
+    write(RecordKey);
+    write(id);
+    write(key);
+    write(static_cast<uint8_t>(flags));
+    write(virtualKey);
+}
+
+void ImgTraceRecorder::forget(ImgWindow *window) {
+    for (WindowEntry &entry : mWindows) {
+        if (entry.window == window)
+            entry.window = nullptr;
+    }
+}
+
+uint16_t ImgTraceRecorder::windowId(ImgWindow *window) {
+    for (size_t id = 0; id < mWindows.size(); id++) {
+        if (mWindows[id].window == window)
+            return static_cast<uint16_t>(id);
+    }
+
+    auto id = static_cast<uint16_t>(mWindows.size());
+    WindowEntry entry = {window, {0, 0, 0, 0}, false};
+    mWindows.push_back(entry);
+
+    const std::string &title = window->GetWindowTitle();
+    write(RecordWindow);
+    write(id);
+    write(static_cast<uint16_t>(title.size()));
+    write(title.data(), title.size());
+    return id;
+}
+
+void ImgTraceRecorder::write(const void *data, size_t size) {
+    // the remaining fields of a record failed before are dropped
+    if (mFile == nullptr)
+        return;
+    if (fwrite(data, 1, size, mFile) != size) {
+        // a truncated trace is still readable up to the last full record
+        XPLMDebugString("imgx: trace recording stopped, can't write the trace\n");
+        Stop();
+    }
+}
+
+ImgTracePlayer::~ImgTracePlayer() {
+    Close();
+}
+
+bool ImgTracePlayer::Open(const std::string &path, std::string &outError) {
+    Close();
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        outError = "can't open " + path;
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        mData.insert(mData.end(), buffer, buffer + count);
+    fclose(file);
+
+    if (mData.size() < sizeof(gTraceMagic) + 1 ||
+            memcmp(mData.data(), gTraceMagic, sizeof(gTraceMagic)) != 0) {
+        outError = path + " is not a trace";
+        mData.clear();
+        return false;
+    }
+    if (mData[sizeof(gTraceMagic)] != gTraceVersion) {
+        outError = path + " has an unsupported trace version";
+        mData.clear();
+        return false;
+    }
+    mOffset = sizeof(gTraceMagic) + 1;
+    return true;
+}
+
+bool ImgTracePlayer::Step() {
+    bool frameApplied = false;
+    while (mOffset < mData.size()) {
+        uint8_t type = mData[mOffset];
+        // events recorded after the frame belong to the next one
+        if (frameApplied && type != RecordWindow && type != RecordGeometry)
+            break;
+        mOffset++;
+
+        bool complete = true;
+        uint16_t id = 0;
+        int32_t x = 0, y = 0;
+        switch (type) {
+        case RecordWindow: {
+            uint16_t length = 0;
+            complete = read(id) && read(length) && mOffset + length <= mData.size();
+            if (complete) {
+                std::string title(reinterpret_cast<const char *>(&mData[mOffset]), length);
+                mOffset += length;
+                bindWindow(id, title);
+            }
+            break;
+        }
+        case RecordFrame: {
+            float elapsedTime = 0.0f;
+            complete = read(elapsedTime) && read(x) && read(y);
+            if (complete) {
+                ImgFrame::Get().OverrideInput(elapsedTime, x, y);
+                frameApplied = true;
+                mFrame++;
+            }
+            break;
+        }
+        case RecordGeometry: {
+            int32_t geometry[4];
+            complete = read(id) && read(geometry);
+            ImgWindow *target = window(id);
+            if (complete && target != nullptr)
+                XPLMSetWindowGeometry(target->mWindowID, geometry[0], geometry[1],
+                                      geometry[2], geometry[3]);
+            break;
+        }
+        case RecordMouseClick:
+        case RecordRightClick: {
+            uint8_t status = 0;
+            complete = read(id) && read(x) && read(y) && read(status);
+            ImgWindow *target = window(id);
+            if (complete && target != nullptr && type == RecordRightClick)
+                ImgWindow::handleRightClickFuncCB(target->mWindowID, x, y, status,
+                                                  target);
+            else if (complete && target != nullptr)
+                ImgWindow::handleMouseClickCB(target->mWindowID, x, y, status,
+                                              target);
+            break;
+        }
+        case RecordMouseWheel: {
+            uint8_t wheel = 0;
+            int32_t clicks = 0;
+            complete = read(id) && read(x) && read(y) && read(wheel) && read(clicks);
+            ImgWindow *target = window(id);
+            if (complete && target != nullptr)
+                ImgWindow::handleMouseWheelFuncCB(target->mWindowID, x, y, wheel,
+                                                  clicks, target);
+            break;
+        }
+        case RecordKey: {
+            char key = 0, virtualKey = 0;
+            uint8_t flags = 0;
+            complete = read(id) && read(key) && read(flags) && read(virtualKey);
+            ImgWindow *target = window(id);
+            if (complete && target != nullptr)
+                ImgWindow::handleKeyFuncCB(target->mWindowID, key, flags,
+                                           virtualKey, target, 0);
+            break;
+        }
+        default:
+            complete = false;
+            break;
+        }
+
+        if (!complete) {
+            // truncated or unknown record, the trace ends here
+            mOffset = mData.size();
+            break;
+        }
+    }
+    return frameApplied;
+}
+
+int ImgTracePlayer::GetFrame() const {
+    return mFrame;
+}
+
+int ImgTracePlayer::GetUnboundWindowCount() const {
+    return static_cast<int>(std::count(mWindows.begin(), mWindows.end(), nullptr));
+}
+
+void ImgTracePlayer::Close() {
+    if (!mData.empty())
+        ImgFrame::Get().ClearInputOverride();
+    mData.clear();
+    mOffset = 0;
+    mFrame = 0;
+    mWindows.clear();
+}
+
+uint64_t ImgTracePlayer::HashDrawData(ImgWindow *window) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void *data, size_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    // windows never shown or hibernating have no context
+    if (window->mImGuiContext == nullptr)
+        return hash;
+    ImGui::SetCurrentContext(window->mImGuiContext);
+    ImDrawData *drawData = ImGui::GetDrawData();
+    if (drawData == nullptr)
+        return hash;
+    for (int n = 0; n < drawData->CmdListsCount; n++) {
+        const ImDrawList *list = drawData->CmdLists[n];
+        add(list->VtxBuffer.Data, list->VtxBuffer.Size * sizeof(ImDrawVert));
+        add(list->IdxBuffer.Data, list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        for (const ImDrawCmd &cmd : list->CmdBuffer) {
+            add(&cmd.ElemCount, sizeof(cmd.ElemCount));
+            add(&cmd.ClipRect, sizeof(cmd.ClipRect));
+            add(&cmd.TextureId, sizeof(cmd.TextureId));
+        }
+    }
+    return hash;
+}
+
+bool ImgTracePlayer::read(void *data, size_t size) {
+    if (mOffset + size > mData.size())
+        return false;
+    memcpy(data, &mData[mOffset], size);
+    mOffset += size;
+    return true;
+}
+
+void ImgTracePlayer::bindWindow(uint16_t id, const std::string &title) {
+    if (mWindows.size() <= id)
+        mWindows.resize(id + 1u, nullptr);
+    for (ImgWindow *live : ImgFrame::Get().Windows()) {
+        if (live->GetWindowTitle() == title &&
+                std::find(mWindows.begin(), mWindows.end(), live) == mWindows.end()) {
+            mWindows[id] = live;
+            return;
+        }
+    }
+}
+
+ImgWindow *ImgTracePlayer::window(uint16_t id) const {
+    if (id >= mWindows.size() || mWindows[id] == nullptr)
+        return nullptr;
+    // the window may have deleted itself since it was bound
+    const std::vector<ImgWindow *> &live = ImgFrame::Get().Windows();
+    if (std::find(live.begin(), live.end(), mWindows[id]) == live.end())
+        return nullptr;
+    return mWindows[id];
+}
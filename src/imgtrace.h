@@ -0,0 +1,165 @@
+/*
+ * imgtrace.h
+ *
+ * Recording and replay of the input of ImgWindows.
+ */
+
+#ifndef IMGTRACE_H
+#define IMGTRACE_H
+
+#include "imgui.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class ImgWindow;
+
+/// \file
+/// This file contains the declaration of the ImgTraceRecorder and
+/// ImgTracePlayer classes
+/// \brief A trace holds everything ImgWindows take from X-Plane that
+/// changes what they build: the sim clock and the mouse location of every
+/// frame, window geometry changes, mouse clicks, mouse wheel and keys.
+///
+/// Windows are identified in the trace by the order of their first
+/// appearance and carry their title, the player binds them to the live
+/// windows with the same titles in creation order. Replaying a trace into
+/// the same windows gives identical ImDrawData on every run, as long as
+/// BuildInterface() itself depends only on ImGui state.
+///
+/// The trace is a little-endian binary file: the header "IMGXTRC" followed
+/// by a version byte, then one record per event, each starting with a type
+/// byte. A frame takes 13 bytes, a click 12 bytes.
+
+/// Writes the input of the plugin windows into a trace file
+class ImgTraceRecorder {
+    friend class ImgFrame;
+    friend class ImgWindow;
+public:
+    /// Returns the recorder of the plugin
+    static ImgTraceRecorder &Get();
+
+    ImgTraceRecorder(const ImgTraceRecorder &) = delete;
+    ImgTraceRecorder &operator=(const ImgTraceRecorder &) = delete;
+
+    /// Starts recording into a file, a recording in progress is stopped
+    /// \param path trace file to create
+    /// \return false if the file can't be created
+    bool Start(const std::string &path);
+
+    /// Stops recording and closes the file
+    void Stop();
+
+    /// Returns true while recording
+    /// \return true while recording
+    bool IsRecording() const;
+
+    /// Returns the number of frames recorded since Start()
+    /// \return recorded frames
+    int GetFrameCount() const;
+
+private:
+    ImgTraceRecorder() = default;
+    ~ImgTraceRecorder();
+
+    void recordFrame(float elapsedTime, int mouseX, int mouseY);
+
+    void recordGeometry(ImgWindow *window, int left, int top, int right,
+                        int bottom);
+
+    void recordMouseClick(ImgWindow *window, int x, int y, int status,
+                          bool right);
+
+    void recordMouseWheel(ImgWindow *window, int x, int y, int wheel,
+                          int clicks);
+
+    void recordKey(ImgWindow *window, char key, int flags, char virtualKey);
+
+    // a destroyed window must not be mistaken for a new one at its address
+    void forget(ImgWindow *window);
+
+    // returns the trace id of a window, writing its record on first use
+    uint16_t windowId(ImgWindow *window);
+
+    void write(const void *data, size_t size);
+
+    template<typename T>
+    void write(T value) {
+        write(&value, sizeof(value));
+    }
+
+    struct WindowEntry {
+        ImgWindow *window;
+        int geometry[4];
+        bool hasGeometry;
+    };
+
+    FILE *mFile = nullptr;
+    int mFrameCount = 0;
+    /// Windows by trace id, forgotten windows keep their slot
+    std::vector<WindowEntry> mWindows;
+};
+
+/// Feeds a trace back into the windows of the plugin frame by frame
+class ImgTracePlayer {
+public:
+    ImgTracePlayer() = default;
+    ~ImgTracePlayer();
+
+    ImgTracePlayer(const ImgTracePlayer &) = delete;
+    ImgTracePlayer &operator=(const ImgTracePlayer &) = delete;
+
+    /// Loads a trace file
+    /// \param path trace file
+    /// \param outError reason of a failure
+    /// \return false if the file can't be read or is no trace
+    bool Open(const std::string &path, std::string &outError);
+
+    /// Applies the input of the next recorded frame: the events received
+    /// before it, its clock and mouse location and the window geometry.
+    /// Call it before the draw callbacks of the sim frame. The clock and
+    /// mouse of the trace replace the sim ones until Close().
+    /// \return false at the end of the trace
+    bool Step();
+
+    /// Returns the number of frames replayed so far
+    /// \return replayed frames
+    int GetFrame() const;
+
+    /// Returns the number of recorded windows without a live window of the
+    /// same title, their events are dropped
+    /// \return unbound windows
+    int GetUnboundWindowCount() const;
+
+    /// Releases the trace and gives the clock and mouse back to the sim
+    void Close();
+
+    /// Computes a hash of the draw data last built by a window. Equal hashes
+    /// mean identical vertices, indices and draw commands.
+    /// \param window window to hash
+    /// \return 64 bit FNV-1a hash
+    static uint64_t HashDrawData(ImgWindow *window);
+
+private:
+    bool read(void *data, size_t size);
+
+    template<typename T>
+    bool read(T &value) {
+        return read(&value, sizeof(value));
+    }
+
+    // binds a recorded window to the first free live window of its title
+    void bindWindow(uint16_t id, const std::string &title);
+
+    ImgWindow *window(uint16_t id) const;
+
+    std::vector<uint8_t> mData;
+    size_t mOffset = 0;
+    int mFrame = 0;
+    /// Live windows by trace id, nullptr if unbound
+    std::vector<ImgWindow *> mWindows;
+};
+
+#endif //IMGTRACE_H
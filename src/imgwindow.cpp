@@ -16,174 +16,76 @@
 #include "XPLMUtilities.h"
 
 #include "imgwindow.h"
-
-#if LIN
-#include <GL/gl.h>
-#include <X11/Xlib.h>
-#include <X11/Xatom.h>
-#elif IBM
-
-#include <gl/GL.h>
-
-#else
-#include <OpenGL/gl.h>
-#endif
+#include "imgarena.h"
+#include "imgclipboard.h"
+#include "imgdispatcher.h"
+#include "imgdrawbatch.h"
+#include "imgfontregistry.h"
+#include "imgframe.h"
+#include "imggl.h"
+#include "imggputimer.h"
+#include "imgglstate.h"
+#include "imgiconregistry.h"
+#include "imgimagecache.h"
+#include "imgshader.h"
+#include "imgstats.h"
+#include "imgstreambuffer.h"
+#include "imgtrace.h"
+#include "imgui_internal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 /// \file
 /// This file contains the definition of the ImgWindow class, which is the
 /// base class for all ImGui driven X-Plane windows
 
-// Dataref's for OpenGL scene data
-static XPLMDataRef gVrEnabledRef = nullptr;
-static XPLMDataRef gModelViewMatrixRef = nullptr;
-static XPLMDataRef gViewportRef = nullptr;
-static XPLMDataRef gProjectionMatrixRef = nullptr;
-
-// OpenGL scene data
-static float mModelView[16], mProjection[16];
-static int mViewport[4];
-
-#if APL
-bool GetOSXClipboard(std::string& outText);
-bool SetOSXClipboard(const std::string& inText);
-#endif
-
-static bool getTextFromClipboard(std::string &outText) {
-#if IBM
-    HGLOBAL hglb;
-    LPSTR lptstr;
-    bool retVal = false;
-    static XPLMDataRef hwndDataRef = XPLMFindDataRef(
-                "sim/operation/windows/system_window");
-    HWND hwndMain = (HWND) (uintptr_t) XPLMGetDatai(hwndDataRef);
-
-    if (!IsClipboardFormatAvailable(CF_TEXT))
-        return false;
-
-    if (!OpenClipboard(hwndMain))
-        return false;
-
-    hglb = GetClipboardData(CF_TEXT);
-    if (hglb != nullptr) {
-        lptstr = (LPSTR) GlobalLock(hglb);
-        if (lptstr != nullptr) {
-            outText = lptstr;
-            GlobalUnlock(hglb);
-            retVal = true;
-        }
-    }
-
-    CloseClipboard();
-
-    return retVal;
-#endif
-#if APL
-    return GetOSXClipboard(outText);
-#endif
-#if LIN
-    Display* display = XOpenDisplay(nullptr);
-    if(display == nullptr) {
-        return false;
+// Current ImGui context of each thread, declared in imgxconfig.h
+thread_local ImGuiContext *gImgxImGuiContext = nullptr;
+
+void ImgxAssertFailed(const char *expression, const char *file, int line) {
+    char message[1024];
+    snprintf(message, sizeof(message), "imgx: ImGui assertion failed: %s, %s:%d\n",
+             expression, file, line);
+    fputs(message, stderr);
+    XPLMDebugString(message);
+    if (gImgxImGuiContext == nullptr) {
+        // contexts are created on the first show and released by
+        // hibernation, ImGui isn't usable before
+        const char *hint = "imgx: no ImGui context is current. ImgWindow creates it when the "
+                           "window is shown, call ImGui in ConfigureImGuiContext() or "
+                           "ConfigureFonts() instead of the constructor\n";
+        fputs(hint, stderr);
+        XPLMDebugString(hint);
     }
-    // Need a window to pass into the conversion request.
-    int black = BlackPixel (display, DefaultScreen (display));
-    Window root = XDefaultRootWindow (display);
-    Window window = XCreateSimpleWindow (display, root, 0, 0, 1, 1, 0, black, black);
-    // Get/create the CLIPBOARD atom.
-    // TODO(jason-watkins): Should we really ever create this atom? My limited knowledge of Linux is failing me here.
-    Atom clipboard = XInternAtom (display, "CLIPBOARD", False);
-    // Get/create an atom to represent datareftool
-    Atom prop = XInternAtom(display, "DRT_DATA", False);
-
-    // Request that the clipboard value be converted to a string
-    XConvertSelection(display, clipboard, XA_STRING, prop, window, CurrentTime);
-    XSync (display, False);
-
-    // Spin several times waiting for the conversion to trigger a SelectionNotify
-    // event.
-    Bool keep_waiting = True;
-    for(int i = 0; keep_waiting && i < 200; ++i)
-    {
-        XEvent event;
-        XNextEvent(display, &event);
-        switch (event.type) {
-        case SelectionNotify:
-            if (event.xselection.selection != clipboard) {
-                break;
-            }
-            if (event.xselection.property == None) {
-                keep_waiting = False;
-            }
-            else {
-                int format;
-                Atom target;
-                unsigned char * value;
-                unsigned long length;
-                unsigned long bytesafter;
-                XGetWindowProperty (event.xselection.display,
-                                    event.xselection.requestor,
-                                    event.xselection.property, 0L, 1000000,
-                                    False, (Atom)AnyPropertyType, &target,
-                                    &format, &length, &bytesafter, &value);
-                outText = (char *)value;
-                XFree(value);
-                keep_waiting = False;
-                XDeleteProperty (event.xselection.display,
-                                 event.xselection.requestor,
-                                 event.xselection.property);
-            }
-            break;
-        default:
-            break;
-        }
-    }
-    XCloseDisplay(display);
-    return true;
-#endif
+    abort();
 }
 
-static bool setTextToClipboard(const std::string &inText) {
-#if IBM
-    LPSTR lptstrCopy;
-    HGLOBAL hglbCopy;
-    static XPLMDataRef hwndDataRef = XPLMFindDataRef(
-                "sim/operation/windows/system_window");
-    HWND hwndMain = (HWND) (uintptr_t) XPLMGetDatai(hwndDataRef);
+static XPLMDataRef gVrEnabledRef = nullptr;
 
-    if (!OpenClipboard(hwndMain))
-        return false;
-    EmptyClipboard();
+// OpenGL scene data of the window being rendered, either shared by the frame
+// or sampled for VR and popped out windows
+static const ImgFrame::Matrices *gMatrices = nullptr;
+static ImgFrame::Matrices gSampledMatrices;
 
-    hglbCopy = GlobalAlloc(GMEM_MOVEABLE,
-                           sizeof(TCHAR) * (inText.length() + 1));
-    if (hglbCopy == nullptr) {
-        CloseClipboard();
-        return false;
-    }
+// Memory used by render cache textures of all windows
+static size_t gRenderCacheBytes = 0;
 
-    lptstrCopy = (LPSTR) GlobalLock(hglbCopy);
-    strcpy(lptstrCopy, inText.c_str());
-    GlobalUnlock(hglbCopy);
+// Streaming buffers shared by all windows, released with the last window
+static ImgStreamBuffer *gVertexBuffer = nullptr;
+static ImgStreamBuffer *gIndexBuffer = nullptr;
 
-    SetClipboardData(CF_TEXT, hglbCopy);
-    CloseClipboard();
-    return true;
-#endif
-#if APL
-    return SetOSXClipboard(inText);
-#endif
-#if LIN
-    std::string command = "echo -n " + inText + " | xclip -sel c";
-    if(0 != system(command.c_str())) {
-        return false;
-    }
-    return true;
-#endif
-}
+// Shader backend objects shared by all windows, released with the last window
+static ImgShaderProgram *gShaderProgram = nullptr;
+static GLuint gVertexArray = 0;
+static void *gVertexArrayContext = nullptr;
 
 const char *ImgWindow::GetClipboardImGuiWrapper(void *user_data) {
-    static std::string text;
-    if (getTextFromClipboard(text))
+    // one buffer per thread, windows may be built on worker threads
+    static thread_local std::string text;
+    if (ImgClipboard::Get().GetText(text))
         return text.c_str();
     else
         return "";
@@ -191,8 +93,7 @@ const char *ImgWindow::GetClipboardImGuiWrapper(void *user_data) {
 
 void ImgWindow::SetClipboardImGuiWrapper(void *user_data, const char
                                          *text) {
-    std::string _text(text);
-    setTextToClipboard(_text);
+    ImgClipboard::Get().SetText(text);
 }
 
 static void
@@ -203,17 +104,42 @@ multMatrixVec4f(GLfloat dst[4], const GLfloat m[16], const GLfloat v[4]) {
     dst[3] = v[0] * m[3] + v[1] * m[7] + v[2] * m[11] + v[3] * m[15];
 }
 
-static void updateMatrices() {
-    // Get the current modelview matrix, viewport, and projection matrix from X-Plane
-    XPLMGetDatavf(gModelViewMatrixRef, mModelView, 0, 16);
-    XPLMGetDatavf(gProjectionMatrixRef, mProjection, 0, 16);
-    XPLMGetDatavi(gViewportRef, mViewport, 0, 4);
+// dst = a * b for column-major matrices
+static void
+multMatrix4f(GLfloat dst[16], const GLfloat a[16], const GLfloat b[16]) {
+    for (int col = 0; col < 4; col++) {
+        multMatrixVec4f(&dst[col * 4], a, &b[col * 4]);
+    }
+}
+
+void ImgWindow::updateMatrices() {
+    // all windows in the main X-Plane window share the matrices of the frame
+    ImgFrame &frame = ImgFrame::Get();
+    if (canSharePass()) {
+        gMatrices = &frame.GetMatrices();
+    } else {
+        frame.SampleMatrices(gSampledMatrices);
+        gMatrices = &gSampledMatrices;
+    }
 }
 
-ImgWindow::ImgWindow(ImFontAtlas *fontAtlas) {
+ImgWindow::ImgWindow(ImFontAtlas *fontAtlas):
+        mImGuiContext(nullptr),
+        mFontAtlas(fontAtlas) {
+    ImgFrame::Get().Register(this);
+    // windows without an own atlas share the default font
     mHasPrebuildFont = fontAtlas != nullptr;
-    mImGuiContext = ImGui::CreateContext(fontAtlas);
-    ImGui::SetCurrentContext(mImGuiContext);
+    mArena = ImgArena::Create();
+}
+
+ImgWindow::ImgWindow(const std::vector<std::string> &fontFiles,
+                     float fontSize):
+        mImGuiContext(nullptr),
+        mFontFiles(fontFiles),
+        mFontSize(fontSize) {
+    ImgFrame::Get().Register(this);
+    mHasPrebuildFont = false;
+    mArena = ImgArena::Create();
 }
 
 void ImgWindow::Init(int width, int height, int x, int y, Anchor anchor,
@@ -223,86 +149,17 @@ void ImgWindow::Init(int width, int height, int x, int y, Anchor anchor,
     mIsInVR = false;
     mPreferredLayer = layer;
     mPreferredPositioningMode = mode;
-    mSelfDestruct = false;
-    mSelfHide = false;
-    mSelfResize = false;
-    mSelfPositioning = false;
     mFirstRender = true;
     mDecoration = decoration;
     mWindowTitle = "Default window title";
-
-    auto &io = ImGui::GetIO();
+    mStats.SetTitle(mWindowTitle);
+    mStats.Publish();
 
     static bool first_init = false;
     if (!first_init) {
         gVrEnabledRef = XPLMFindDataRef("sim/graphics/VR/enabled");
-        gModelViewMatrixRef = XPLMFindDataRef(
-                    "sim/graphics/view/modelview_matrix");
-        gViewportRef = XPLMFindDataRef("sim/graphics/view/viewport");
-        gProjectionMatrixRef = XPLMFindDataRef(
-                    "sim/graphics/view/projection_matrix");
         first_init = true;
     }
-    // clipboard data
-    io.SetClipboardTextFn = SetClipboardImGuiWrapper;
-    io.GetClipboardTextFn = GetClipboardImGuiWrapper;
-
-    // we render ourselves, we don't use the DrawListsFunc
-    io.RenderDrawListsFn = nullptr;
-    // set up the Keymap
-    io.KeyMap[ImGuiKey_Tab] = XPLM_VK_TAB;
-    io.KeyMap[ImGuiKey_LeftArrow] = XPLM_VK_LEFT;
-    io.KeyMap[ImGuiKey_RightArrow] = XPLM_VK_RIGHT;
-    io.KeyMap[ImGuiKey_UpArrow] = XPLM_VK_UP;
-    io.KeyMap[ImGuiKey_DownArrow] = XPLM_VK_DOWN;
-    io.KeyMap[ImGuiKey_PageUp] = XPLM_VK_PRIOR;
-    io.KeyMap[ImGuiKey_PageDown] = XPLM_VK_NEXT;
-    io.KeyMap[ImGuiKey_Home] = XPLM_VK_HOME;
-    io.KeyMap[ImGuiKey_End] = XPLM_VK_END;
-    io.KeyMap[ImGuiKey_Insert] = XPLM_VK_INSERT;
-    io.KeyMap[ImGuiKey_Delete] = XPLM_VK_DELETE;
-    io.KeyMap[ImGuiKey_Backspace] = XPLM_VK_BACK;
-    io.KeyMap[ImGuiKey_Space] = XPLM_VK_SPACE;
-    io.KeyMap[ImGuiKey_Enter] = XPLM_VK_ENTER;
-    io.KeyMap[ImGuiKey_Escape] = XPLM_VK_ESCAPE;
-    io.KeyMap[ImGuiKey_A] = XPLM_VK_A;
-    io.KeyMap[ImGuiKey_C] = XPLM_VK_C;
-    io.KeyMap[ImGuiKey_V] = XPLM_VK_V;
-    io.KeyMap[ImGuiKey_X] = XPLM_VK_X;
-    io.KeyMap[ImGuiKey_Y] = XPLM_VK_Y;
-    io.KeyMap[ImGuiKey_Z] = XPLM_VK_Z;
-
-    // disable window rounding since we're not rendering the frame anyway.
-    auto &style = ImGui::GetStyle();
-    if (decoration == xplm_WindowDecorationRoundRectangle)
-        style.WindowRounding = 0;
-    else
-        style.WindowBorderSize = 0;
-
-    ConfigureImGuiContext();
-
-    // bind default font if not use shared font
-    if (!mHasPrebuildFont) {
-        // bind default font
-        unsigned char *pixels;
-        int fWidth, fHeight;
-        io.Fonts->GetTexDataAsAlpha8(&pixels, &fWidth, &fHeight);
-
-        // slightly stupid dance around the texture number due to XPLM not using GLint here.
-        int texNum = 0;
-        XPLMGenerateTextureNumbers(&texNum, 1);
-
-        // upload texture.
-        XPLMBindTexture2d(texNum, 0);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, fWidth, fHeight, 0, GL_ALPHA,
-                     GL_UNSIGNED_BYTE, pixels);
-        io.Fonts->TexID = (void *) (uintptr_t) texNum;
-    }
-    // disable OSX-like keyboard behaviours always - we don't have the keymapping for it.
-    io.ConfigMacOSXBehaviors = false; // io.OptMacOSXBehaviors = false;
 
     mWidth = width;
     mHeight = height;
@@ -384,30 +241,249 @@ void ImgWindow::Init(int width, int height, int x, int y, Anchor anchor,
     mWindowID = XPLMCreateWindowEx(&windowParams);
     XPLMSetWindowPositioningMode(mWindowID, mPreferredPositioningMode, -1);
 
-    XPLMCreateFlightLoop_t flightLoopParameters = {
-        sizeof(flightLoopParameters),
-        xplm_FlightLoop_Phase_AfterFlightModel,
-        flightLoopHandler,
-        reinterpret_cast<void *>(this)
-    };
+    ImgDispatcher::Get().start();
+}
 
-    flightLoopID = XPLMCreateFlightLoop(&flightLoopParameters);
-    XPLMScheduleFlightLoop(flightLoopID, -1.0f, true);
+void
+ImgWindow::ConfigureFonts(ImFontAtlas *) {
 }
 
 void
 ImgWindow::ConfigureImGuiContext() {
 }
 
-ImgWindow::~ImgWindow() {
+void ImgWindow::createContext() {
+    if (mImGuiContext != nullptr)
+        return;
+
+    // the fonts of the window are set up once and kept through hibernation
+    if (!mHasPrebuildFont && !mFontsConfigured) {
+        mFontsConfigured = true;
+        ImGui::SetCurrentContext(nullptr);
+        ImgArena::Scope scope(mArena);
+        ImFontAtlas *fontAtlas = IM_NEW(ImFontAtlas)();
+        ConfigureFonts(fontAtlas);
+        if (fontAtlas->ConfigData.Size > 0) {
+            buildFontAtlas(fontAtlas);
+            mWindowFontAtlas = fontAtlas;
+        } else {
+            IM_DELETE(fontAtlas);
+        }
+    }
+
+    // an atlas kept between the contexts is used as it is. Otherwise the
+    // context starts with an empty atlas of its own, fonts added by
+    // ConfigureImGuiContext() go there and never into an atlas shared with
+    // other windows.
+    ImFontAtlas *contextAtlas = mHasPrebuildFont ? mFontAtlas : mWindowFontAtlas;
+    bool ownAtlas = contextAtlas == nullptr;
+    {
+        ImgArena::Scope scope(mArena);
+        if (ownAtlas)
+            contextAtlas = IM_NEW(ImFontAtlas)();
+        mImGuiContext = ImGui::CreateContext(contextAtlas);
+    }
+    int keptFonts = contextAtlas->ConfigData.Size;
+    mArena->Attach(mImGuiContext);
     ImGui::SetCurrentContext(mImGuiContext);
     auto &io = ImGui::GetIO();
-    if (!mHasPrebuildFont) {
-        auto t = (GLuint) (uintptr_t) io.Fonts->TexID;
-        glDeleteTextures(1, &t);
+
+    // clipboard data
+    io.SetClipboardTextFn = SetClipboardImGuiWrapper;
+    io.GetClipboardTextFn = GetClipboardImGuiWrapper;
+
+    // we render ourselves, we don't use the DrawListsFunc
+    io.RenderDrawListsFn = nullptr;
+    // set up the Keymap
+    io.KeyMap[ImGuiKey_Tab] = XPLM_VK_TAB;
+    io.KeyMap[ImGuiKey_LeftArrow] = XPLM_VK_LEFT;
+    io.KeyMap[ImGuiKey_RightArrow] = XPLM_VK_RIGHT;
+    io.KeyMap[ImGuiKey_UpArrow] = XPLM_VK_UP;
+    io.KeyMap[ImGuiKey_DownArrow] = XPLM_VK_DOWN;
+    io.KeyMap[ImGuiKey_PageUp] = XPLM_VK_PRIOR;
+    io.KeyMap[ImGuiKey_PageDown] = XPLM_VK_NEXT;
+    io.KeyMap[ImGuiKey_Home] = XPLM_VK_HOME;
+    io.KeyMap[ImGuiKey_End] = XPLM_VK_END;
+    io.KeyMap[ImGuiKey_Insert] = XPLM_VK_INSERT;
+    io.KeyMap[ImGuiKey_Delete] = XPLM_VK_DELETE;
+    io.KeyMap[ImGuiKey_Backspace] = XPLM_VK_BACK;
+    io.KeyMap[ImGuiKey_Space] = XPLM_VK_SPACE;
+    io.KeyMap[ImGuiKey_Enter] = XPLM_VK_ENTER;
+    io.KeyMap[ImGuiKey_Escape] = XPLM_VK_ESCAPE;
+    io.KeyMap[ImGuiKey_A] = XPLM_VK_A;
+    io.KeyMap[ImGuiKey_C] = XPLM_VK_C;
+    io.KeyMap[ImGuiKey_V] = XPLM_VK_V;
+    io.KeyMap[ImGuiKey_X] = XPLM_VK_X;
+    io.KeyMap[ImGuiKey_Y] = XPLM_VK_Y;
+    io.KeyMap[ImGuiKey_Z] = XPLM_VK_Z;
+
+    // disable window rounding since we're not rendering the frame anyway.
+    auto &style = ImGui::GetStyle();
+    if (mDecoration == xplm_WindowDecorationRoundRectangle)
+        style.WindowRounding = 0;
+    else
+        style.WindowBorderSize = 0;
+
+    ConfigureImGuiContext();
+
+    if (!ownAtlas && !mKeepContext && contextAtlas->ConfigData.Size != keptFonts) {
+        // the hook would add the fonts again with every context, so the
+        // window keeps its first one
+        XPLMDebugString("imgx: fonts added to a shared atlas in ConfigureImGuiContext(), "
+                        "hibernation disabled, add them in ConfigureFonts()\n");
+        mKeepContext = true;
+    }
+
+    if (ownAtlas) {
+        if (contextAtlas->ConfigData.Size > 0) {
+            // built for this context only, like the atlas of a context
+            // created without a shared one
+            buildFontAtlas(contextAtlas);
+            mContextFontAtlas = contextAtlas;
+        } else {
+            {
+                ImgArena::Scope scope(mArena);
+                IM_DELETE(contextAtlas);
+            }
+            mRegistryFontAtlas = ImgFontRegistry::Get().Acquire(mFontFiles, mFontSize);
+            io.Fonts = mRegistryFontAtlas;
+        }
+    }
+
+    // disable OSX-like keyboard behaviours always - we don't have the keymapping for it.
+    io.ConfigMacOSXBehaviors = false; // io.OptMacOSXBehaviors = false;
+
+    // a context recreated after hibernation continues with the style and
+    // the ImGui window settings of the released one
+    if (mHasSavedState) {
+        style = mSavedStyle;
+        ImGui::LoadIniSettingsFromMemory(mSavedSettings.data(), mSavedSettings.size());
+        mSavedSettings.clear();
+        mSavedSettings.shrink_to_fit();
+        mHasSavedState = false;
+    }
+    mFirstRender = true;
+
+    mLastTimeShown = ImgFrame::Get().GetCurrentTime();
+    scheduleHibernation(mHibernateTime);
+}
+
+void ImgWindow::destroyContext() {
+    if (mImGuiContext == nullptr)
+        return;
+
+    ImGui::SetCurrentContext(mImGuiContext);
+    size_t settingsSize = 0;
+    const char *settings = ImGui::SaveIniSettingsToMemory(&settingsSize);
+    mSavedSettings.assign(settings, settingsSize);
+    mSavedStyle = ImGui::GetStyle();
+    mHasSavedState = true;
+
+    // the draw data of the context goes with it
+    releaseRenderCache();
+    mDrawBatcher = ImgDrawBatcher();
+    mOversizedFrames.clear();
+    mPoolOversizedFrames = 0;
+    {
+        ImgArena::Scope scope(mArena);
+        ImGui::DestroyContext();
+    }
+    mImGuiContext = nullptr;
+    mArena->Attach(nullptr);
+    mArena->Trim();
+    if (mRegistryFontAtlas != nullptr) {
+        ImgFontRegistry::Get().Release(mRegistryFontAtlas);
+        mRegistryFontAtlas = nullptr;
+    }
+    if (mContextFontAtlas != nullptr) {
+        destroyFontAtlas(mContextFontAtlas);
+        mContextFontAtlas = nullptr;
+    }
+}
+
+void ImgWindow::buildFontAtlas(ImFontAtlas *fontAtlas) {
+    ImgArena::Scope scope(mArena);
+    ImgIconRegistry::Get().BuildAtlas(fontAtlas);
+    CreateFontTexture(fontAtlas);
+    // the pixels are in the texture now
+    fontAtlas->ClearTexData();
+}
+
+void ImgWindow::destroyFontAtlas(ImFontAtlas *fontAtlas) {
+    ImgArena::Scope scope(mArena);
+    DestroyFontTexture(fontAtlas);
+    ImgIconRegistry::Get().ForgetAtlas(fontAtlas);
+    IM_DELETE(fontAtlas);
+}
+
+void ImgWindow::CreateFontTexture(ImFontAtlas *fontAtlas) {
+    unsigned char *pixels;
+    int width, height;
+    fontAtlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    // slightly stupid dance around the texture number due to XPLM not using GLint here.
+    int texNum = 0;
+    XPLMGenerateTextureNumbers(&texNum, 1);
+
+    // upload texture.
+    XPLMBindTexture2d(texNum, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (ImgGL::Get().HasTextureSwizzle) {
+        // GL_ALPHA is a legacy format, a swizzled single channel texture
+        // samples the same in both the fixed function and the shader backend
+        const GLint swizzle[4] = {GL_ONE, GL_ONE, GL_ONE, GL_RED};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED,
+                     GL_UNSIGNED_BYTE, pixels);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA,
+                     GL_UNSIGNED_BYTE, pixels);
+    }
+    fontAtlas->TexID = (void *) (uintptr_t) texNum;
+}
+
+void ImgWindow::DestroyFontTexture(ImFontAtlas *fontAtlas) {
+    auto t = (GLuint) (uintptr_t) fontAtlas->TexID;
+    glDeleteTextures(1, &t);
+    fontAtlas->TexID = nullptr;
+}
+
+ImgWindow::~ImgWindow() {
+    if (mImGuiContext != nullptr)
+        ImGui::SetCurrentContext(mImGuiContext);
+    releaseRenderCache();
+    ImgFrame::Get().Unregister(this);
+    ImgTraceRecorder::Get().forget(this);
+    ImgDispatcher::Get().Cancel(this);
+    if (ImgFrame::Get().Windows().empty()) {
+        delete gVertexBuffer;
+        gVertexBuffer = nullptr;
+        delete gIndexBuffer;
+        gIndexBuffer = nullptr;
+        delete gShaderProgram;
+        gShaderProgram = nullptr;
+        if (gVertexArray != 0 && gVertexArrayContext == ImgGL::CurrentContext())
+            ImgGL::Get().DeleteVertexArrays(1, &gVertexArray);
+        gVertexArray = 0;
+        ImgClipboard::Get().Shutdown();
+        ImgFrame::Get().shutdownPool();
+        ImgImageCache::Get().shutdown();
+        ImgDispatcher::Get().shutdown();
+    }
+    if (mImGuiContext != nullptr) {
+        ImgArena::Scope scope(mArena);
+        ImGui::DestroyContext();
     }
-    ImGui::DestroyContext();
-    XPLMDestroyFlightLoop(flightLoopID);
+    if (mContextFontAtlas != nullptr)
+        destroyFontAtlas(mContextFontAtlas);
+    if (mWindowFontAtlas != nullptr)
+        destroyFontAtlas(mWindowFontAtlas);
+    mArena->Release();
+    if (mRegistryFontAtlas != nullptr)
+        ImgFontRegistry::Get().Release(mRegistryFontAtlas);
     XPLMDestroyWindow(mWindowID);
 }
 
@@ -416,92 +492,572 @@ ImgWindow::boxelsToNative(int x, int y, int &outX, int &outY) {
     GLfloat boxelPos[4] = {(GLfloat) x, (GLfloat) y, 0, 1};
     GLfloat eye[4], ndc[4];
 
-    multMatrixVec4f(eye, mModelView, boxelPos);
-    multMatrixVec4f(ndc, mProjection, eye);
+    multMatrixVec4f(eye, gMatrices->modelView, boxelPos);
+    multMatrixVec4f(ndc, gMatrices->projection, eye);
     ndc[3] = 1.0f / ndc[3];
     ndc[0] *= ndc[3];
     ndc[1] *= ndc[3];
 
-    outX = static_cast<int>((ndc[0] * 0.5f + 0.5f) * mViewport[2] +
-            mViewport[0]);
-    outY = static_cast<int>((ndc[1] * 0.5f + 0.5f) * mViewport[3] +
-            mViewport[1]);
+    const int *viewport = gMatrices->viewport;
+    outX = static_cast<int>((ndc[0] * 0.5f + 0.5f) * viewport[2] +
+            viewport[0]);
+    outY = static_cast<int>((ndc[1] * 0.5f + 0.5f) * viewport[3] +
+            viewport[1]);
 }
 
 void
 ImgWindow::renderImGui() {
-    // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
-    ImGui::SetCurrentContext(mImGuiContext);
-    ImGuiIO &io = ImGui::GetIO();
-    ImDrawData *draw_data = ImGui::GetDrawData();
-    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+    selectRenderBackend();
+    beginRenderPass(mActiveRenderBackend);
+    renderContent();
+    endRenderPass(mActiveRenderBackend);
+}
 
-    updateMatrices();
+void
+ImgWindow::renderPass(const std::vector<ImgWindow *> &windows) {
+    // consecutive windows with the same backend share the state setup
+    bool open = false;
+    RenderBackend backend = FixedFunction;
+    for (ImgWindow *window : windows) {
+        window->selectRenderBackend();
+        if (open && window->mActiveRenderBackend != backend) {
+            endRenderPass(backend);
+            open = false;
+        }
+        if (!open) {
+            backend = window->mActiveRenderBackend;
+            beginRenderPass(backend);
+            open = true;
+        }
+        window->renderContent();
+    }
+    if (open)
+        endRenderPass(backend);
+}
 
-    // We are using the OpenGL fixed pipeline because messing with the
-    // shader-state in X-Plane is not very well documented, but using the fixed
-    // function pipeline is.
+bool
+ImgWindow::canSharePass() const {
+    return !mIsInVR && !mIsPoppedOut;
+}
 
+void
+ImgWindow::selectRenderBackend() {
+    // the render cache composites with the fixed function pipeline
+    mActiveRenderBackend = FixedFunction;
+    if (mRenderBackend == Shader && !mRenderCache && initShaderBackend())
+        mActiveRenderBackend = Shader;
+}
+
+void
+ImgWindow::beginRenderPass(RenderBackend backend) {
     // 1TU + Alpha settings, no depth, no fog.
     XPLMSetGraphicsState(0, 1, 0, 1, 1, 0, 0);
-    GLint last_texture;
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-    glPushClientAttrib(GL_CLIENT_ALL_ATTRIB_BITS);
+    // X-Plane or other plugins may have changed the state since the last pass
+    ImgGLState::Get().Invalidate();
+
+    // textures are bound through XPLMBindTexture2d and need no restoring.
+    // The shader backend avoids the attribute stack of the compatibility
+    // profile, the state cache puts back the capabilities it changes.
+    if (backend == Shader) {
+        ImgGLState &state = ImgGLState::Get();
+        state.SetCapability(GL_CULL_FACE, false);
+        state.SetCapability(GL_SCISSOR_TEST, true);
+        return;
+    }
+
+    // We are using the OpenGL fixed pipeline because messing with the
+    // shader-state in X-Plane is not very well documented, but using the fixed
+    // function pipeline is.
     glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TRANSFORM_BIT);
     glDisable(GL_CULL_FACE);
-    glEnable(GL_SCISSOR_TEST);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
     glEnable(GL_TEXTURE_2D);
+}
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glScalef(1.0f, -1.0f, 1.0f);
-    glTranslatef(static_cast<GLfloat>(mLeft), static_cast<GLfloat>(-mTop), 0.0f);
+void
+ImgWindow::endRenderPass(RenderBackend backend) {
+    if (backend == Shader) {
+        gShaderProgram->Release();
+        ImgGLState::Get().RestoreCapabilities();
+        return;
+    }
+    ImgGLState::Get().RestoreClientState();
+
+    // Restore modified state
+    glPopAttrib();
+}
+
+void
+ImgWindow::renderContent() {
+    ImGui::SetCurrentContext(mImGuiContext);
+    ImDrawData *draw_data = ImGui::GetDrawData();
+
+    updateMatrices();
+
+    ImgStats::TimePoint start = ImgStats::Now();
+    mDrawTimePending = true;
+
+    if (mGpuTiming) {
+        // results of earlier frames, the GPU is not waited for
+        float gpuTime;
+        while (mGpuTimer.Poll(gpuTime))
+            mStats.Push(ImgStats::GpuTime, gpuTime);
+        mGpuTimer.Begin();
+    }
+
+    if (mActiveRenderBackend == Shader) {
+        renderShader(draw_data);
+    } else if (mRenderCache && updateRenderCache(draw_data)) {
+        drawRenderCache();
+    } else {
+        glEnable(GL_SCISSOR_TEST);
+
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glScalef(1.0f, -1.0f, 1.0f);
+        glTranslatef(static_cast<GLfloat>(mLeft), static_cast<GLfloat>(-mTop), 0.0f);
+
+        renderDrawLists(draw_data, false);
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        // the next window of the pass may be a render cache quad
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    if (mGpuTiming)
+        mGpuTimer.End();
+    mDrawTime += ImgStats::Elapsed(start);
+}
+
+void
+ImgWindow::renderDrawLists(ImDrawData *draw_data, bool toTexture) {
+    if (toTexture) {
+        // ImGui space -> render cache texture, upside down
+        const GLfloat ortho[16] = {
+                2.0f / mWidth, 0.0f, 0.0f, 0.0f,
+                0.0f, -2.0f / mHeight, 0.0f, 0.0f,
+                0.0f, 0.0f, -1.0f, 0.0f,
+                -1.0f, 1.0f, 0.0f, 1.0f
+        };
+        const int viewport[4] = {0, 0, mCacheTextureWidth, mCacheTextureHeight};
+        buildDrawBatches(draw_data, ortho, viewport);
+    } else {
+        GLfloat transform[16];
+        imguiToClip(transform);
+        buildDrawBatches(draw_data, transform, gMatrices->viewport);
+    }
+
+    // the arrays stay enabled for the next window of the pass
+    ImgGLState &state = ImgGLState::Get();
+    state.EnableClientState(GL_VERTEX_ARRAY);
+    state.EnableClientState(GL_TEXTURE_COORD_ARRAY);
+    state.EnableClientState(GL_COLOR_ARRAY);
+
+    // with buffer objects the pointers are offsets into the streaming buffers
+    bool useBuffers = mVertexBuffers && uploadDrawData(draw_data);
+    GLenum idxType = sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    const std::vector<ImgDrawBatch> &batches = mDrawBatcher.Batches();
 
     // Render command lists
-    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    for (const ImgDrawBatchList &list : mDrawBatcher.Lists())
     {
-        const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        const ImDrawVert* vtx_buffer = cmd_list->VtxBuffer.Data;
-        const ImDrawIdx* idx_buffer = cmd_list->IdxBuffer.Data;
-        glVertexPointer(2, GL_FLOAT, sizeof(ImDrawVert), (const GLvoid*)((const char*)vtx_buffer + IM_OFFSETOF(ImDrawVert, pos)));
-        glTexCoordPointer(2, GL_FLOAT, sizeof(ImDrawVert), (const GLvoid*)((const char*)vtx_buffer + IM_OFFSETOF(ImDrawVert, uv)));
-        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ImDrawVert), (const GLvoid*)((const char*)vtx_buffer + IM_OFFSETOF(ImDrawVert, col)));
-
-        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        const ImDrawList* cmd_list = list.cmdList;
+        const char* vtx_buffer = (const char*)cmd_list->VtxBuffer.Data;
+        const char* idx_buffer = (const char*)cmd_list->IdxBuffer.Data;
+        if (useBuffers) {
+            vtx_buffer = (const char*)(mUploadVtxOffset + list.vtxOffset * sizeof(ImDrawVert));
+            idx_buffer = (const char*)(mUploadIdxOffset + list.idxOffset * sizeof(ImDrawIdx));
+        }
+        glVertexPointer(2, GL_FLOAT, sizeof(ImDrawVert), (const GLvoid*)(vtx_buffer + IM_OFFSETOF(ImDrawVert, pos)));
+        glTexCoordPointer(2, GL_FLOAT, sizeof(ImDrawVert), (const GLvoid*)(vtx_buffer + IM_OFFSETOF(ImDrawVert, uv)));
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ImDrawVert), (const GLvoid*)(vtx_buffer + IM_OFFSETOF(ImDrawVert, col)));
+
+        for (int b = list.firstBatch; b < list.firstBatch + list.batchCount; b++)
         {
-            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-            if (pcmd->UserCallback) {
-                pcmd->UserCallback(cmd_list, pcmd);
+            const ImgDrawBatch &batch = batches[b];
+            if (batch.callback) {
+                batch.callback->UserCallback(cmd_list, batch.callback);
+                state.Invalidate();
             } else {
-                glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->TextureId);
-
-                // Scissors work in viewport space - must translate the coordinates from ImGui -> Boxels, then Boxels -> Native.
-                //FIXME: it must be possible to apply the scale+transform manually to the projection matrix so we don't need to doublestep.
-                int bTop, bLeft, bRight, bBottom;
-                translateImGuiToBoxel(pcmd->ClipRect.x, pcmd->ClipRect.y, bLeft, bTop);
-                translateImGuiToBoxel(pcmd->ClipRect.z, pcmd->ClipRect.w, bRight, bBottom);
-                int nTop, nLeft, nRight, nBottom;
-                boxelsToNative(bLeft, bTop, nLeft, nTop);
-                boxelsToNative(bRight, bBottom, nRight, nBottom);
-                glScissor(nLeft, nBottom, nRight-nLeft, nTop-nBottom);
-                glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, idx_buffer);
+                state.BindTexture((GLuint)(intptr_t)batch.textureId);
+                state.Scissor(batch.clipX, batch.clipY, batch.clipWidth, batch.clipHeight);
+                glDrawElements(GL_TRIANGLES, (GLsizei)batch.elemCount, idxType,
+                               idx_buffer + batch.idxOffset * sizeof(ImDrawIdx));
+            }
+        }
+    }
+
+    if (useBuffers) {
+        gVertexBuffer->Unbind();
+        gIndexBuffer->Unbind();
+    }
+}
+
+void
+ImgWindow::imguiToClip(GLfloat outTransform[16]) {
+    // ImGui -> Boxels -> Native in a single matrix
+    const GLfloat imguiToBoxel[16] = {
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, -1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            static_cast<GLfloat>(mLeft), static_cast<GLfloat>(mTop), 0.0f, 1.0f
+    };
+    GLfloat modelView[16];
+    multMatrix4f(modelView, gMatrices->modelView, imguiToBoxel);
+    multMatrix4f(outTransform, gMatrices->projection, modelView);
+}
+
+void
+ImgWindow::buildDrawBatches(ImDrawData *draw_data, const GLfloat transform[16],
+                            const int viewport[4]) {
+    mDrawBatcher.Build(draw_data, transform, viewport);
+    mDrawStats.commands = mDrawBatcher.CommandsIn();
+    mDrawStats.draws = mDrawBatcher.DrawsOut();
+    mDrawStats.culled = mDrawBatcher.Culled();
+}
+
+ImgWindow::DrawStats ImgWindow::GetDrawStats() const {
+    return mDrawStats;
+}
+
+
+bool
+ImgWindow::uploadDrawData(ImDrawData *draw_data) {
+    if (!ImgGL::Get().HasBufferObject)
+        return false;
+    if (gVertexBuffer == nullptr) {
+        gVertexBuffer = new ImgStreamBuffer(GL_ARRAY_BUFFER, 1 << 20);
+        gIndexBuffer = new ImgStreamBuffer(GL_ELEMENT_ARRAY_BUFFER, 1 << 19);
+    }
+
+    // the frame is already in the buffers if it was drawn before and no
+    // window has orphaned the buffers since
+    if (mUploadSerial == mFrameSerial &&
+            mUploadVtxGeneration == gVertexBuffer->Generation() &&
+            mUploadIdxGeneration == gIndexBuffer->Generation()) {
+        gVertexBuffer->Bind();
+        gIndexBuffer->Bind();
+        return true;
+    }
+
+    size_t vtxSize = draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    size_t idxSize = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    if (vtxSize == 0 || idxSize == 0)
+        return false;
+
+    auto vtxDst = static_cast<char *>(gVertexBuffer->Map(vtxSize, mUploadVtxOffset,
+                                                                 sizeof(ImDrawVert)));
+    if (vtxDst == nullptr)
+        return false;
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList *cmd_list = draw_data->CmdLists[n];
+        size_t size = cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        memcpy(vtxDst, cmd_list->VtxBuffer.Data, size);
+        vtxDst += size;
+    }
+    gVertexBuffer->Unmap();
+
+    auto idxDst = static_cast<char *>(gIndexBuffer->Map(idxSize, mUploadIdxOffset));
+    if (idxDst == nullptr) {
+        gVertexBuffer->Unbind();
+        return false;
+    }
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList *cmd_list = draw_data->CmdLists[n];
+        size_t size = cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        memcpy(idxDst, cmd_list->IdxBuffer.Data, size);
+        idxDst += size;
+    }
+    gIndexBuffer->Unmap();
+
+    mUploadSerial = mFrameSerial;
+    mUploadVtxGeneration = gVertexBuffer->Generation();
+    mUploadIdxGeneration = gIndexBuffer->Generation();
+    return true;
+}
+
+void ImgWindow::SetVertexBuffers(bool inEnable) {
+    mVertexBuffers = inEnable;
+    mUploadSerial = 0;
+}
+
+bool ImgWindow::GetVertexBuffers() const {
+    return mVertexBuffers;
+}
+
+bool
+ImgWindow::initShaderBackend() {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasShaders || !gl.HasBufferObject || !gl.HasTextureSwizzle)
+        return false;
+    if (gShaderProgram == nullptr)
+        gShaderProgram = new ImgShaderProgram();
+    return gShaderProgram->IsValid();
+}
+
+bool
+ImgWindow::bindVertexArray() {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasVertexArrayObject || !gl.HasDrawElementsBaseVertex)
+        return false;
+
+    // vertex arrays are not shared between contexts
+    void *context = ImgGL::CurrentContext();
+    if (gVertexArray != 0 && gVertexArrayContext != context)
+        return false;
+
+    if (gVertexArray == 0) {
+        gl.GenVertexArrays(1, &gVertexArray);
+        gVertexArrayContext = context;
+        gl.BindVertexArray(gVertexArray);
+        // the vertex buffer is bound by uploadDrawData(), the pointers stay
+        // valid when it is orphaned, frames are addressed by base vertex
+        setVertexAttributes(0);
+    } else {
+        gl.BindVertexArray(gVertexArray);
+    }
+    // the vertex array keeps the element buffer binding
+    gIndexBuffer->Bind();
+    return true;
+}
+
+void
+ImgWindow::setVertexAttributes(size_t offset) {
+    const ImgGL &gl = ImgGL::Get();
+    gl.EnableVertexAttribArray(ImgShaderProgram::PositionAttribute);
+    gl.EnableVertexAttribArray(ImgShaderProgram::UVAttribute);
+    gl.EnableVertexAttribArray(ImgShaderProgram::ColorAttribute);
+    gl.VertexAttribPointer(ImgShaderProgram::PositionAttribute, 2, GL_FLOAT,
+                           GL_FALSE, sizeof(ImDrawVert),
+                           (const GLvoid *) (offset + IM_OFFSETOF(ImDrawVert, pos)));
+    gl.VertexAttribPointer(ImgShaderProgram::UVAttribute, 2, GL_FLOAT,
+                           GL_FALSE, sizeof(ImDrawVert),
+                           (const GLvoid *) (offset + IM_OFFSETOF(ImDrawVert, uv)));
+    gl.VertexAttribPointer(ImgShaderProgram::ColorAttribute, 4,
+                           GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert),
+                           (const GLvoid *) (offset + IM_OFFSETOF(ImDrawVert, col)));
+}
+
+void
+ImgWindow::renderShader(ImDrawData *draw_data) {
+    const ImgGL &gl = ImgGL::Get();
+
+    GLfloat projection[16];
+    imguiToClip(projection);
+    buildDrawBatches(draw_data, projection, gMatrices->viewport);
+
+    gShaderProgram->Use(projection);
+
+    if (uploadDrawData(draw_data)) {
+        ImgGLState &state = ImgGLState::Get();
+        bool useVertexArray = bindVertexArray();
+        GLenum idxType = sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        const std::vector<ImgDrawBatch> &batches = mDrawBatcher.Batches();
+
+        for (const ImgDrawBatchList &list : mDrawBatcher.Lists()) {
+            const ImDrawList *cmd_list = list.cmdList;
+            size_t vtx_offset = mUploadVtxOffset + list.vtxOffset * sizeof(ImDrawVert);
+            size_t idx_offset = mUploadIdxOffset + list.idxOffset * sizeof(ImDrawIdx);
+            auto baseVertex = static_cast<GLint>(vtx_offset / sizeof(ImDrawVert));
+            if (!useVertexArray)
+                setVertexAttributes(vtx_offset);
+
+            for (int b = list.firstBatch; b < list.firstBatch + list.batchCount; b++) {
+                const ImgDrawBatch &batch = batches[b];
+                if (batch.callback) {
+                    batch.callback->UserCallback(cmd_list, batch.callback);
+                    state.Invalidate();
+                    continue;
+                }
+                state.BindTexture((GLuint) (intptr_t) batch.textureId);
+                state.Scissor(batch.clipX, batch.clipY, batch.clipWidth, batch.clipHeight);
+                auto indices = (const GLvoid *) (idx_offset + batch.idxOffset * sizeof(ImDrawIdx));
+                if (useVertexArray)
+                    gl.DrawElementsBaseVertex(GL_TRIANGLES, (GLsizei) batch.elemCount,
+                                              idxType, indices, baseVertex);
+                else
+                    glDrawElements(GL_TRIANGLES, (GLsizei) batch.elemCount,
+                                   idxType, indices);
             }
-            idx_buffer += pcmd->ElemCount;
         }
+
+        if (useVertexArray) {
+            gl.BindVertexArray(0);
+        } else {
+            gl.DisableVertexAttribArray(ImgShaderProgram::PositionAttribute);
+            gl.DisableVertexAttribArray(ImgShaderProgram::UVAttribute);
+            gl.DisableVertexAttribArray(ImgShaderProgram::ColorAttribute);
+        }
+        gVertexBuffer->Unbind();
+        gIndexBuffer->Unbind();
     }
+}
+
+void ImgWindow::SetRenderBackend(RenderBackend inBackend) {
+    mRenderBackend = inBackend;
+}
 
+ImgWindow::RenderBackend ImgWindow::GetRenderBackend() const {
+    return mRenderBackend;
+}
+
+ImgWindow::RenderBackend ImgWindow::GetActiveRenderBackend() const {
+    return mActiveRenderBackend;
+}
+
+bool
+ImgWindow::updateRenderCache(ImDrawData *draw_data) {
+    const ImgGL &gl = ImgGL::Get();
+    if (!gl.HasFramebufferObject || mWidth <= 0 || mHeight <= 0)
+        return false;
+
+    // the texture matches the native size of the window to stay sharp on
+    // scaled and VR displays
+    int nLeft, nTop, nRight, nBottom;
+    boxelsToNative(mLeft, mTop, nLeft, nTop);
+    boxelsToNative(mRight, mBottom, nRight, nBottom);
+    int width = nRight - nLeft;
+    int height = nTop - nBottom;
+    if (width <= 0 || height <= 0) {
+        width = mWidth;
+        height = mHeight;
+    }
+
+    if (mCacheTexture != 0 && mCacheSerial == mFrameSerial &&
+            mCacheTextureWidth == width && mCacheTextureHeight == height) {
+        mCacheHits++;
+        return true;
+    }
+    mCacheMisses++;
+
+    if (mCacheTexture == 0 || mCacheTextureWidth != width ||
+            mCacheTextureHeight != height) {
+        releaseRenderCache();
+
+        glGenTextures(1, &mCacheTexture);
+        ImgGLState::Get().BindTexture(mCacheTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        mCacheTextureWidth = width;
+        mCacheTextureHeight = height;
+        // counted with the texture, releaseRenderCache() subtracts it
+        gRenderCacheBytes += static_cast<size_t>(width) * height * 4;
+
+        gl.GenFramebuffers(1, &mCacheFramebuffer);
+        gl.BindFramebuffer(GL_FRAMEBUFFER, mCacheFramebuffer);
+        gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                GL_TEXTURE_2D, mCacheTexture, 0);
+        GLenum status = gl.CheckFramebufferStatus(GL_FRAMEBUFFER);
+        gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            // do not try again, render directly from now on
+            releaseRenderCache();
+            mRenderCache = false;
+            return false;
+        }
+    }
+
+    // render the command lists into the texture
+    GLint last_framebuffer;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+    gl.BindFramebuffer(GL_FRAMEBUFFER, mCacheFramebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT | GL_COLOR_BUFFER_BIT);
+    glViewport(0, 0, mCacheTextureWidth, mCacheTextureHeight);
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_SCISSOR_TEST);
+
+    // keep the texture premultiplied so it composites like direct rendering
+    gl.BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                         GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, mWidth, mHeight, 0.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    renderDrawLists(draw_data, true);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
-    // Restore modified state
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-    glBindTexture(GL_TEXTURE_2D, last_texture);
+
     glPopAttrib();
-    glPopClientAttrib();
+    gl.BindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(last_framebuffer));
+    // the scissor box was restored behind the back of the state cache
+    ImgGLState::Get().Invalidate();
+
+    mCacheSerial = mFrameSerial;
+    return true;
+}
+
+void
+ImgWindow::drawRenderCache() {
+    // blending is restored for the next window of the pass
+    glPushAttrib(GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT);
+    ImgGLState::Get().BindTexture(mCacheTexture);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2i(mLeft, mBottom);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2i(mRight, mBottom);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2i(mRight, mTop);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2i(mLeft, mTop);
+    glEnd();
+    glPopAttrib();
+}
+
+void
+ImgWindow::releaseRenderCache() {
+    if (mCacheFramebuffer != 0) {
+        ImgGL::Get().DeleteFramebuffers(1, &mCacheFramebuffer);
+        mCacheFramebuffer = 0;
+    }
+    if (mCacheTexture != 0) {
+        glDeleteTextures(1, &mCacheTexture);
+        mCacheTexture = 0;
+        gRenderCacheBytes -= static_cast<size_t>(mCacheTextureWidth) *
+                             mCacheTextureHeight * 4;
+    }
+    mCacheTextureWidth = 0;
+    mCacheTextureHeight = 0;
+}
+
+void ImgWindow::SetRenderCache(bool inEnable) {
+    mRenderCache = inEnable;
+    if (!inEnable)
+        releaseRenderCache();
+}
+
+bool ImgWindow::GetRenderCache() const {
+    return mRenderCache;
+}
+
+ImgWindow::RenderCacheStats ImgWindow::GetRenderCacheStats() const {
+    RenderCacheStats stats;
+    stats.hits = mCacheHits;
+    stats.misses = mCacheMisses;
+    stats.textureBytes = static_cast<size_t>(mCacheTextureWidth) *
+                         mCacheTextureHeight * 4;
+    return stats;
+}
+
+size_t ImgWindow::GetRenderCacheTotalBytes() {
+    return gRenderCacheBytes;
 }
 
 void
@@ -563,20 +1119,11 @@ ImgWindow::translateImGuiToBoxel(float inX, float inY, int &outX, int &outY) {
 
 
 void
-ImgWindow::updateImGui() {
-
+ImgWindow::prepareImGui() {
     ImGui::SetCurrentContext(mImGuiContext);
     auto &io = ImGui::GetIO();
 
-    // check the window is within the screen size (for self decorated)
-    checkScreenAndPlace();
-
     // transfer the window geometry to ImGui
-    XPLMGetWindowGeometry(mWindowID, &mLeft, &mTop, &mRight, &mBottom);
-
-    mWidth = mRight - mLeft;
-    mHeight = mTop - mBottom;
-
     io.DisplaySize = ImVec2(static_cast<float>(mWidth),
                             static_cast<float>(mHeight));
     // in boxels, we're always scale 1, 1.
@@ -586,23 +1133,38 @@ ImgWindow::updateImGui() {
     // do not update mouse coordinates when window is not in front
     if (XPLMIsWindowInFront(mWindowID)) {
         int mouse_x, mouse_y;
-        XPLMGetMouseLocationGlobal(&mouse_x, &mouse_y);
+        ImgFrame::Get().GetMouseLocation(mouse_x, mouse_y);
         float outX, outY;
         translateToImGuiSpace(mouse_x, mouse_y, outX, outY);
         io.MousePos = ImVec2(outX, outY);
     }
 
-    float time = XPLMGetElapsedTime();
+    float time = ImgFrame::Get().GetElapsedTime();
     io.DeltaTime = time - mLastTimeDrawn;
     mLastTimeDrawn = time;
+}
+
+void
+ImgWindow::updateImGui() {
+    ImgStats::TimePoint start = ImgStats::Now();
 
+    ImGui::SetCurrentContext(mImGuiContext);
     ImGui::NewFrame();
 
     PreBuildInterface();
 
+    ImgStats::TimePoint buildStart = ImgStats::Now();
     BuildInterface();
+    mStats.Push(ImgStats::BuildInterfaceTime, ImgStats::Elapsed(buildStart));
 
     PostBuildInterface();
+    mStats.Push(ImgStats::UpdateTime, ImgStats::Elapsed(start));
+}
+
+void
+ImgWindow::finishImGui() {
+    ImGui::SetCurrentContext(mImGuiContext);
+    auto &io = ImGui::GetIO();
 
     // finally, handle window focus.
     int hasKeyboardFocus = XPLMHasKeyboardFocus(mWindowID);
@@ -616,6 +1178,117 @@ ImgWindow::updateImGui() {
         }
     }
     mFirstRender = false;
+    if (mRedrawFrames > 0)
+        mRedrawFrames--;
+    mFrameSerial++;
+
+    // the images stay loaded while the draw data is drawn again
+    ImgImageCache::Get().collectDrawn(ImGui::GetDrawData(), mImageTextures, mImageSerial);
+}
+
+void
+ImgWindow::updateGeometry() {
+    // check the window is within the screen size (for self decorated)
+    checkScreenAndPlace();
+
+    XPLMGetWindowGeometry(mWindowID, &mLeft, &mTop, &mRight, &mBottom);
+    mIsPoppedOut = XPLMWindowIsPoppedOut(mWindowID) != 0;
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording())
+        recorder.recordGeometry(this, mLeft, mTop, mRight, mBottom);
+
+    mWidth = mRight - mLeft;
+    mHeight = mTop - mBottom;
+}
+
+bool
+ImgWindow::needsRebuild() {
+    // polled on every frame, so data written while the window rebuilds
+    // anyway doesn't trigger another build
+    bool channelsWritten = pollChannels();
+    if (!mIdleMode || mFirstRender || mRedrawFrames > 0 || channelsWritten)
+        return true;
+
+    ImGui::SetCurrentContext(mImGuiContext);
+    auto &io = ImGui::GetIO();
+    if (ImGui::GetDrawData() == nullptr)
+        return true;
+
+    // an image of the last frame was evicted
+    if (!ImgImageCache::Get().markDrawn(mImageTextures, mImageSerial))
+        return true;
+
+    // window was resized
+    if (io.DisplaySize.x != static_cast<float>(mWidth) ||
+            io.DisplaySize.y != static_cast<float>(mHeight))
+        return true;
+
+    // text cursor blinks, item is dragged or edited
+    if (io.WantTextInput || ImGui::IsAnyItemActive() ||
+            ImGui::IsAnyMouseDown())
+        return true;
+
+    // hovering effects: rebuild while the mouse is over the window and
+    // once more after it leaves
+    int mouse_x, mouse_y;
+    ImgFrame::Get().GetMouseLocation(mouse_x, mouse_y);
+    bool mouseInside = mouse_x >= mLeft && mouse_x <= mRight &&
+                       mouse_y >= mBottom && mouse_y <= mTop;
+    bool mouseWasInside = mMouseWasInside;
+    mMouseWasInside = mouseInside;
+    if (mouseInside || mouseWasInside)
+        return true;
+
+    return mMaxIdleTime > 0.0f &&
+           ImgFrame::Get().GetElapsedTime() - mLastTimeDrawn >= mMaxIdleTime;
+}
+
+void ImgWindow::SetIdleMode(bool inEnable, float inMaxIdleTime) {
+    mIdleMode = inEnable;
+    mMaxIdleTime = inMaxIdleTime;
+    RequestRedraw();
+}
+
+bool ImgWindow::GetIdleMode() const {
+    return mIdleMode;
+}
+
+void ImgWindow::RequestRedraw() {
+    // ImGui may need a couple of frames to settle after a change
+    // (auto-resizing, opening popups), so rebuild a few frames in a row
+    mRedrawFrames = 3;
+}
+
+void ImgWindow::WatchChannel(const ImgChannel &channel) {
+    for (const WatchedChannel &watched : mWatchedChannels) {
+        if (watched.channel == &channel)
+            return;
+    }
+    WatchedChannel watched = {&channel, channel.GetSerial()};
+    mWatchedChannels.push_back(watched);
+    // show the data written before
+    RequestRedraw();
+}
+
+void ImgWindow::UnwatchChannel(const ImgChannel &channel) {
+    mWatchedChannels.erase(
+                std::remove_if(mWatchedChannels.begin(), mWatchedChannels.end(),
+                               [&channel](const WatchedChannel &watched) {
+                                   return watched.channel == &channel;
+                               }),
+                mWatchedChannels.end());
+}
+
+bool ImgWindow::pollChannels() {
+    bool written = false;
+    for (WatchedChannel &watched : mWatchedChannels) {
+        unsigned int serial = watched.channel->GetSerial();
+        if (serial != watched.serial) {
+            watched.serial = serial;
+            written = true;
+        }
+    }
+    return written;
 }
 
 void ImgWindow::PostBuildInterface() {
@@ -639,25 +1312,181 @@ void ImgWindow::PreBuildInterface() {
 /// Main loop function to update ImGui and render the window
 void ImgWindow::drawWindowCB(XPLMWindowID inWindowID, void *inRefcon) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+
+    // X-Plane calls this several times per frame for VR eyes and popped out
+    // windows. The interface is built on the first call of the frame only
+    // and the resulting draw data is rendered on every call.
+    ImgFrame &frame = ImgFrame::Get();
+    frame.Update();
+    // shown without SetVisible(), e.g. by X-Plane moving it to VR
+    thisWindow->createContext();
+    // the parallel build of the frame switches the current context
     ImGui::SetCurrentContext(thisWindow->mImGuiContext);
+    if (frame.GetCycle() != thisWindow->mLastBuildCycle) {
+        // windows with parallel build were built by frame.Update()
+        thisWindow->mLastTimeShown = frame.GetElapsedTime();
+        thisWindow->beginCycle(frame.GetCycle());
+        if (thisWindow->beginBuild()) {
+            thisWindow->buildImGui();
+            thisWindow->finishImGui();
+        }
+    }
+
+    // with the shared pass the window is rendered together with the other
+    // windows of its layer
+    if (!frame.Submit(thisWindow))
+        thisWindow->renderImGui();
+}
+
+void ImgWindow::beginCycle(int cycle) {
+    mLastBuildCycle = cycle;
+    // the draw callbacks of the last frame are complete
+    if (mDrawTimePending) {
+        mStats.Push(ImgStats::DrawTime, mDrawTime);
+        mDrawTime = 0.0f;
+        mDrawTimePending = false;
+    }
+
+    // allocations of the build and the draw callbacks of the last cycle
+    mArena->EndFrame();
+    ImgArena::Stats memory = mArena->GetStats();
+    mStats.Push(ImgStats::MemoryKiB, static_cast<float>(memory.liveBytes) / 1024.0f);
+    mStats.Push(ImgStats::Allocations, static_cast<float>(memory.frameAllocations));
+    trimMemory();
+}
+
+// Draw lists and pools smaller than this are never trimmed, they would
+// only grow again
+static const size_t gTrimSlackBytes = 64 * 1024;
+
+static size_t drawListBytes(const ImDrawList *list, bool capacity) {
+    if (capacity) {
+        return list->CmdBuffer.Capacity * sizeof(ImDrawCmd) +
+               list->IdxBuffer.Capacity * sizeof(ImDrawIdx) +
+               list->VtxBuffer.Capacity * sizeof(ImDrawVert);
+    }
+    return list->CmdBuffer.Size * sizeof(ImDrawCmd) +
+           list->IdxBuffer.Size * sizeof(ImDrawIdx) +
+           list->VtxBuffer.Size * sizeof(ImDrawVert);
+}
+
+// Reallocates a buffer to its size, keeping the content
+template<typename T>
+static void shrinkToFit(ImVector<T> &buffer) {
+    ImVector<T> fitted;
+    if (buffer.Size > 0) {
+        fitted.resize(buffer.Size);
+        memcpy(fitted.Data, buffer.Data, buffer.Size * sizeof(T));
+    }
+    buffer.swap(fitted);
+}
+
+void ImgWindow::trimMemory() {
+    if (mTrimFrames <= 0)
+        return;
+    // the draw lists are trimmed between frames, the draw data of the last
+    // frame may be rendered again in idle mode, so active lists keep their
+    // content
+    ImGui::SetCurrentContext(mImGuiContext);
+    ImGuiContext &g = *ImGui::GetCurrentContext();
+    size_t trimmed = 0;
+    auto trim = [&](ImDrawList *list, bool active) {
+        size_t capacity = drawListBytes(list, true);
+        size_t used = active ? drawListBytes(list, false) : 0;
+        int &frames = mOversizedFrames[list];
+        if (capacity <= 2 * used + gTrimSlackBytes) {
+            frames = 0;
+            return;
+        }
+        if (++frames < mTrimFrames)
+            return;
+        frames = 0;
+        if (active) {
+            shrinkToFit(list->CmdBuffer);
+            shrinkToFit(list->IdxBuffer);
+            shrinkToFit(list->VtxBuffer);
+        } else {
+            // windows not shown in the last frame, e.g. closed popups, are
+            // not part of the draw data
+            list->ClearFreeMemory();
+        }
+        trimmed += capacity - drawListBytes(list, true);
+    };
+    for (ImGuiWindow *window : g.Windows)
+        trim(window->DrawList, window->Active);
+    trim(&g.OverlayDrawList, true);
+    if (trimmed > 0)
+        mArena->CountTrimmed(trimmed);
+
+    ImgArena::Stats memory = mArena->GetStats();
+    if (memory.pooledBytes <= memory.liveBytes / 2 + gTrimSlackBytes) {
+        mPoolOversizedFrames = 0;
+    } else if (++mPoolOversizedFrames >= mTrimFrames) {
+        mPoolOversizedFrames = 0;
+        mArena->Trim();
+    }
+}
+
+ImgArena::Stats ImgWindow::GetMemoryStats() const {
+    return mArena->GetStats();
+}
+
+void ImgWindow::SetMemoryTrim(int inFrames) {
+    mTrimFrames = inFrames;
+}
+
+int ImgWindow::GetMemoryTrim() const {
+    return mTrimFrames;
+}
+
+bool ImgWindow::beginBuild() {
+    updateGeometry();
 
-    thisWindow->updateImGui();
+    // in idle mode the last frame is rendered again without rebuilding
+    if (!needsRebuild())
+        return false;
+
+    prepareImGui();
+    return true;
+}
 
+void ImgWindow::buildImGui() {
+    updateImGui();
+
+    ImgStats::TimePoint start = ImgStats::Now();
     ImGui::Render();
+    mStats.Push(ImgStats::RenderTime, ImgStats::Elapsed(start));
 
-    thisWindow->renderImGui();
+    // scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
+    // once, the draw data must not change until the next frame is built
+    ImGuiIO &io = ImGui::GetIO();
+    ImDrawData *draw_data = ImGui::GetDrawData();
+    draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+
+    int commands = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+        commands += draw_data->CmdLists[n]->CmdBuffer.Size;
+    mStats.Push(ImgStats::Vertices, static_cast<float>(draw_data->TotalVtxCount));
+    mStats.Push(ImgStats::Indices, static_cast<float>(draw_data->TotalIdxCount));
+    mStats.Push(ImgStats::Commands, static_cast<float>(commands));
 }
 
 int ImgWindow::handleMouseClickCB(XPLMWindowID inWindowID, int x, int y,
                                   XPLMMouseStatus inMouse, void *inRefcon) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording())
+        recorder.recordMouseClick(thisWindow, x, y, inMouse, false);
     return thisWindow->handleMouseClickGeneric(x, y, inMouse, 0);
 }
 
 int ImgWindow::handleMouseClickGeneric(int x, int y, XPLMMouseStatus inMouse,
                                        int button) {
+    if (mImGuiContext == nullptr)
+        return 1;
     ImGui::SetCurrentContext(mImGuiContext);
     ImGuiIO &io = ImGui::GetIO();
+    RequestRedraw();
     static int lastX = x, lastY = y;
     int dx, dy;
     static int gDragging = 0;
@@ -701,44 +1530,20 @@ int ImgWindow::handleMouseClickGeneric(int x, int y, XPLMMouseStatus inMouse,
     return 1;
 }
 
-float ImgWindow::flightLoopHandler(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void * inRefcon)
-{
-    auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
-
-    if (thisWindow->mSelfHide) {
-        XPLMSetWindowIsVisible(thisWindow->mWindowID, false);
-        thisWindow->mSelfHide = false;
-    }
-
-    if (thisWindow->mSelfResize) {
-        thisWindow->Resize(thisWindow->mResizeWidth, thisWindow->mResizeHeight,
-                           thisWindow->mResizeAnchor);
-        thisWindow->mSelfResize = false;
-    }
-
-    if (thisWindow->mSelfPositioning) {
-        XPLMSetWindowPositioningMode(thisWindow->mWindowID, thisWindow->tempPositioningMode,
-                                     thisWindow->tempMonitorIndex);
-        thisWindow->mSelfPositioning = false;
-    }
-
-    if (thisWindow->mSelfPlace) {
-        thisWindow->Place(thisWindow->mX, thisWindow->mY, thisWindow->mPlaceAnchor);
-        thisWindow->mSelfPlace = false;
-    }
-
-    if (thisWindow->mSelfDestruct) {
-        delete thisWindow;
-    }
-    return -1.0f;
-}
-
 void ImgWindow::handleKeyFuncCB(XPLMWindowID inWindowID, char inKey,
                                 XPLMKeyFlags inFlags, char inVirtualKey,
                                 void *inRefcon, int losingFocus) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+    // losing the focus follows from other input, it is not recorded
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording() && !losingFocus)
+        recorder.recordKey(thisWindow, inKey, inFlags, inVirtualKey);
+    // a hidden window may lose the keyboard focus after hibernating
+    if (thisWindow->mImGuiContext == nullptr)
+        return;
     ImGui::SetCurrentContext(thisWindow->mImGuiContext);
     ImGuiIO &io = ImGui::GetIO();
+    thisWindow->RequestRedraw();
     if (io.WantCaptureKeyboard) {
         auto vk = static_cast<unsigned char>(inVirtualKey);
         io.KeysDown[vk] = (inFlags & xplm_DownFlag) == xplm_DownFlag;
@@ -759,6 +1564,8 @@ void ImgWindow::handleKeyFuncCB(XPLMWindowID inWindowID, char inKey,
 XPLMCursorStatus ImgWindow::handleCursorFuncCB(XPLMWindowID inWindowID,
                                                int x, int y, void *inRefcon) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+    if (thisWindow->mImGuiContext == nullptr)
+        return xplm_CursorDefault;
     ImGui::SetCurrentContext(thisWindow->mImGuiContext);
     ImGuiIO &io = ImGui::GetIO();
     //float outX, outY;
@@ -771,8 +1578,14 @@ XPLMCursorStatus ImgWindow::handleCursorFuncCB(XPLMWindowID inWindowID,
 int ImgWindow::handleMouseWheelFuncCB(XPLMWindowID inWindowID, int x, int y,
                                       int wheel, int clicks, void *inRefcon) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording())
+        recorder.recordMouseWheel(thisWindow, x, y, wheel, clicks);
+    if (thisWindow->mImGuiContext == nullptr)
+        return 1;
     ImGui::SetCurrentContext(thisWindow->mImGuiContext);
     ImGuiIO &io = ImGui::GetIO();
+    thisWindow->RequestRedraw();
 
     float outX, outY;
     thisWindow->translateToImGuiSpace(x, y, outX, outY);
@@ -794,11 +1607,15 @@ int ImgWindow::handleMouseWheelFuncCB(XPLMWindowID inWindowID, int x, int y,
 int ImgWindow::handleRightClickFuncCB(XPLMWindowID inWindowID, int x, int y,
                                       XPLMMouseStatus inMouse, void *inRefcon) {
     auto *thisWindow = reinterpret_cast<ImgWindow *>(inRefcon);
+    ImgTraceRecorder &recorder = ImgTraceRecorder::Get();
+    if (recorder.IsRecording())
+        recorder.recordMouseClick(thisWindow, x, y, inMouse, true);
     return thisWindow->handleMouseClickGeneric(x, y, inMouse, 1);
 }
 
 void ImgWindow::SetWindowTitle(const std::string &title) {
     mWindowTitle = title;
+    mStats.SetTitle(mWindowTitle);
     XPLMSetWindowTitle(mWindowID, mWindowTitle.c_str());
 }
 
@@ -817,9 +1634,9 @@ void ImgWindow::SetPositioningMode(XPLMWindowPositioningMode mode, int inMonitor
 
 void ImgWindow::SafePositioningModeSet(XPLMWindowPositioningMode mode,
                                        int inMonitorIndex) {
-    tempPositioningMode = mode;
-    tempMonitorIndex = inMonitorIndex;
-    mSelfPositioning = true;
+    SafeCall([this, mode, inMonitorIndex] {
+        XPLMSetWindowPositioningMode(mWindowID, mode, inMonitorIndex);
+    });
 }
 
 void ImgWindow::SetGravity(float inLeftGravity, float inTopGravity,
@@ -908,10 +1725,7 @@ void ImgWindow::Place(int x, int y, ImgWindow::Anchor anchor) {
 
 void ImgWindow::SafePlace(int x, int y, ImgWindow::Anchor anchor)
 {
-    mX = x;
-    mY = y;
-    mPlaceAnchor = anchor;
-    mSelfPlace = true;
+    SafeCall([this, x, y, anchor] { Place(x, y, anchor); });
 }
 
 void ImgWindow::SetVisible(bool inIsVisible) {
@@ -926,10 +1740,51 @@ void ImgWindow::SetVisible(bool inIsVisible) {
             // chance to early abort.
             return;
         }
+        createContext();
+    } else {
+        mLastTimeShown = ImgFrame::Get().GetCurrentTime();
     }
     XPLMSetWindowIsVisible(mWindowID, inIsVisible);
 }
 
+void ImgWindow::SetHibernation(float inHiddenTime) {
+    mHibernateTime = inHiddenTime;
+    scheduleHibernation(inHiddenTime);
+}
+
+float ImgWindow::GetHibernation() const {
+    return mHibernateTime;
+}
+
+bool ImgWindow::IsHibernating() const {
+    return mImGuiContext == nullptr;
+}
+
+void ImgWindow::scheduleHibernation(float delay) {
+    if (mHibernateTime <= 0.0f || mImGuiContext == nullptr || mHibernationScheduled ||
+            mKeepContext)
+        return;
+    mHibernationScheduled = true;
+    ImgDispatcher::Get().PostDelayed(delay, [this] {
+        mHibernationScheduled = false;
+        checkHibernation();
+    }, this);
+}
+
+void ImgWindow::checkHibernation() {
+    // the check repeats while the window has a context, so windows closed
+    // by X-Plane hibernate as well as those hidden by SetVisible(). The
+    // sim time is the one replayed by ImgTracePlayer.
+    float now = ImgFrame::Get().GetCurrentTime();
+    if (GetVisible())
+        mLastTimeShown = now;
+    float hidden = now - mLastTimeShown;
+    if (hidden >= mHibernateTime && mHibernateTime > 0.0f)
+        destroyContext();
+    else
+        scheduleHibernation(mHibernateTime - hidden);
+}
+
 void ImgWindow::MoveForVR() {
     // if we're trying to display the window, check the state of the VR flag
     // - if we're VR enabled, explicitly move the window to the VR world.
@@ -949,6 +1804,34 @@ bool ImgWindow::IsInVR()
     return mIsInVR;
 }
 
+const std::string &ImgWindow::GetWindowTitle() const {
+    return mWindowTitle;
+}
+
+const ImgStats &ImgWindow::GetStats() const {
+    return mStats;
+}
+
+void ImgWindow::SetGpuTiming(bool inEnable) {
+    mGpuTiming = inEnable;
+}
+
+bool ImgWindow::GetGpuTiming() const {
+    return mGpuTiming;
+}
+
+void ImgWindow::SetParallelBuild(bool inEnable) {
+    mParallelBuild = inEnable;
+}
+
+bool ImgWindow::GetParallelBuild() const {
+    return mParallelBuild;
+}
+
+bool ImgWindow::IsGpuTimingAvailable() {
+    return ImgGpuTimer::IsAvailable();
+}
+
 bool ImgWindow::GetVisible() const {
     return XPLMGetWindowIsVisible(mWindowID) != 0;
 }
@@ -958,16 +1841,21 @@ bool ImgWindow::OnShow() {
 }
 
 void ImgWindow::SafeDelete() {
-    mSelfDestruct = true;
+    SafeCall([this] { delete this; });
 }
 
 void ImgWindow::SafeHide() {
-    mSelfHide = true;
+    SafeCall([this] { XPLMSetWindowIsVisible(mWindowID, false); });
 }
 
 void ImgWindow::SafeResize(int width, int height, Anchor anchor) {
-    mSelfResize = true;
-    mResizeWidth = width;
-    mResizeHeight = height;
-    mResizeAnchor = anchor;
+    SafeCall([this, width, height, anchor] { Resize(width, height, anchor); });
+}
+
+void ImgWindow::SafeSetWindowTitle(const std::string &title) {
+    SafeCall([this, title] { SetWindowTitle(title); });
+}
+
+void ImgWindow::SafeCall(std::function<void()> command) {
+    ImgDispatcher::Get().Post(std::move(command), this);
 }
@@ -14,10 +14,18 @@
 #define IMGWINDOW_H
 
 #include "XPLMDisplay.h"
-#include "XPLMProcessing.h"
 #include "imgui.h"
-
+#include "imgarena.h"
+#include "imgchannel.h"
+#include "imgdrawbatch.h"
+#include "imggputimer.h"
+#include "imgstats.h"
+
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 /// \file
 /// This file contains the declaration of the ImgWindow class, which is the
@@ -40,12 +48,20 @@
 /// 3. There is no way to detect if the window is hidden without a per-frame
 /// processing loop or similar.
 ///
+/// 4. The ImGui context, and the font atlas it uses, are created when the
+/// window is shown for the first time, and released again by hibernation.
+/// Add fonts in ConfigureFonts() and set up the context in
+/// ConfigureImGuiContext(), ImGui calls in the constructor have no context
+/// to work on and fail an assertion.
+///
 /// \note It should be possible to map globally on XP9 & XP10 letting you run
 /// popups as large as you need, or to use the ImGui native titlebars instead of
 /// the XP10 ones - source for this may be provided later, but could also be
 /// trivially adapted from this one by adjusting the way the space is translated
 /// and mapped in the DrawWindowCB and constructor.
 class ImgWindow {
+    friend class ImgFrame;
+    friend class ImgTracePlayer;
 public:
     /// Anchor point used to place the window in X-Plane world
     enum Anchor {
@@ -56,6 +72,14 @@ public:
         Center
     };
 
+    /// Rendering backend used to draw the window
+    enum RenderBackend {
+        /// OpenGL fixed function pipeline, works everywhere
+        FixedFunction,
+        /// GLSL program with buffer and vertex array objects
+        Shader
+    };
+
     virtual ~ImgWindow();
 
     /// Makes the window visible after making the onShow() call.
@@ -86,6 +110,184 @@ public:
     /// \param anchor anchor point to place the window
     void SafePlace(int x, int y, Anchor anchor = TopLeft);
 
+    /// Enables or disables idle mode. In idle mode the window does not
+    /// rebuild its interface while nothing happens to it: no input events,
+    /// no mouse over the window, no active item or text cursor and no
+    /// RequestRedraw() call. The last built frame is rendered instead.
+    /// \param inEnable true to enable idle mode, false to rebuild every frame
+    /// \param inMaxIdleTime max time in seconds the window may stay idle
+    /// before it is rebuilt anyway (0 - no limit)
+    void SetIdleMode(bool inEnable, float inMaxIdleTime = 0.0f);
+
+    /// Returns true if idle mode is enabled
+    /// \return true if idle mode is enabled, false otherwise
+    bool GetIdleMode() const;
+
+    /// Forces the window interface to be rebuilt on the next frame. Use it in
+    /// idle mode when the data displayed by the window has changed.
+    void RequestRedraw();
+
+    /// Rebuilds the window in idle mode whenever data is written to a
+    /// channel, which may happen on any thread. Call UnwatchChannel()
+    /// before the channel is destroyed.
+    /// \param channel channel read by BuildInterface()
+    void WatchChannel(const ImgChannel &channel);
+
+    /// Stops rebuilding the window on writes to a channel
+    /// \param channel watched channel
+    void UnwatchChannel(const ImgChannel &channel);
+
+    /// Draw call statistics of the last rendered frame
+    struct DrawStats {
+        /// ImDrawCmd in the frame
+        int commands;
+        /// draw calls issued after culling and merging
+        int draws;
+        /// commands dropped because their clip rect was empty
+        int culled;
+    };
+
+    /// Render cache statistics
+    struct RenderCacheStats {
+        /// frames composited from the cached texture
+        unsigned long hits;
+        /// frames rendered into the cached texture
+        unsigned long misses;
+        /// memory used by the cached texture in bytes
+        size_t textureBytes;
+    };
+
+    /// Enables or disables the render cache. With the render cache the
+    /// window content is rendered into an offscreen texture only when it was
+    /// rebuilt and the texture is drawn as a single quad on all other frames
+    /// (idle frames, VR and multi-pass drawing). Falls back to direct
+    /// rendering when framebuffer objects are not supported.
+    /// \param inEnable true to enable the render cache
+    void SetRenderCache(bool inEnable);
+
+    /// Returns true if the render cache is enabled
+    /// \return true if the render cache is enabled, false otherwise
+    bool GetRenderCache() const;
+
+    /// Returns render cache statistics of the window
+    /// \return render cache statistics
+    RenderCacheStats GetRenderCacheStats() const;
+
+    /// Returns memory used by render cache textures of all windows
+    /// \return memory in bytes
+    static size_t GetRenderCacheTotalBytes();
+
+    /// Enables or disables drawing from buffer objects. The vertices and
+    /// indices of every built frame are uploaded once into streaming buffers
+    /// shared by all windows instead of being read by the driver from client
+    /// memory on every draw call. Falls back to client memory when buffer
+    /// objects are not supported.
+    /// \param inEnable true to draw from buffer objects
+    void SetVertexBuffers(bool inEnable);
+
+    /// Returns true if drawing from buffer objects is enabled
+    /// \return true if drawing from buffer objects is enabled
+    bool GetVertexBuffers() const;
+
+    /// Selects the rendering backend. The shader backend falls back to the
+    /// fixed function backend when the context lacks the required features
+    /// or when the render cache is enabled.
+    /// \param inBackend backend to use
+    void SetRenderBackend(RenderBackend inBackend);
+
+    /// Returns the selected rendering backend
+    /// \return selected backend
+    RenderBackend GetRenderBackend() const;
+
+    /// Returns the rendering backend used to draw the last frame
+    /// \return backend in use
+    RenderBackend GetActiveRenderBackend() const;
+
+    /// Returns draw call statistics of the last rendered frame
+    /// \return draw call statistics
+    DrawStats GetDrawStats() const;
+
+    /// Returns the frame time metrics of the window
+    /// \return metrics of the recent frames
+    const ImgStats &GetStats() const;
+
+    /// Lets the window hibernate once it has been hidden for the given
+    /// time: the ImGui context, its draw buffers, the render cache texture
+    /// and the reference to a shared font atlas are released. The next
+    /// SetVisible(true) creates them again, with the style and the ImGui
+    /// window settings of the released context; other ImGui state, like
+    /// scroll positions, starts over and mFirstRender is set again.
+    /// \param inHiddenTime seconds hidden before the window hibernates, 0
+    /// to never hibernate
+    void SetHibernation(float inHiddenTime);
+
+    /// Returns the time hidden before the window hibernates
+    /// \return seconds, 0 if the window never hibernates
+    float GetHibernation() const;
+
+    /// Returns true if the window has no ImGui context, because it wasn't
+    /// shown yet or hibernates
+    /// \return true without a context
+    bool IsHibernating() const;
+
+    /// Returns the memory counters of the ImGui context of the window, also
+    /// published as the MemoryKiB and Allocations metrics
+    /// \return counters of the arena of the window
+    ImgArena::Stats GetMemoryStats() const;
+
+    /// Sets after how many frames oversized memory is trimmed. A draw list
+    /// more than twice and 64 KiB larger than its content, or than nothing
+    /// for windows no longer shown like closed popups, is shrunk once it
+    /// stayed oversized for that many frames; the same holds for the
+    /// blocks pooled by the arena of the window.
+    /// \param inFrames frames, 0 to never trim
+    void SetMemoryTrim(int inFrames);
+
+    /// Returns after how many frames oversized memory is trimmed
+    /// \return frames, 0 if memory is never trimmed
+    int GetMemoryTrim() const;
+
+    /// Enables or disables measuring the GPU time of the window rendering
+    /// into the GpuTime metric. The results are read back a few frames
+    /// later, so measuring doesn't stall the pipeline.
+    /// \param inEnable true to measure GPU time
+    void SetGpuTiming(bool inEnable);
+
+    /// Returns true if GPU time measuring is enabled
+    /// \return true if GPU time measuring is enabled
+    bool GetGpuTiming() const;
+
+    /// Lets ImgFrame build the interface of this window on a worker thread
+    /// together with other windows, see ImgFrame::SetBuildThreads(). The
+    /// BuildInterface(), PreBuildInterface() and PostBuildInterface()
+    /// callbacks of the window then must not call the XPLM API, OpenGL or
+    /// shared state of the plugin without their own locking, and must not
+    /// throw.
+    /// \param inEnable true to allow building on a worker thread
+    void SetParallelBuild(bool inEnable);
+
+    /// Returns true if the window may be built on a worker thread
+    /// \return true if parallel build is enabled
+    bool GetParallelBuild() const;
+
+    /// Returns true if the OpenGL context supports timer queries. Must be
+    /// called with the X-Plane OpenGL context current.
+    /// \return false if GPU times are unavailable
+    static bool IsGpuTimingAvailable();
+
+    /// Returns the title of the window
+    /// \return window title
+    const std::string &GetWindowTitle() const;
+
+    /// Builds the alpha texture of the font atlas and uploads it. The texture
+    /// can be used with all rendering backends.
+    /// \param fontAtlas font atlas to upload, its TexID is set
+    static void CreateFontTexture(ImFontAtlas *fontAtlas);
+
+    /// Deletes the texture created by CreateFontTexture()
+    /// \param fontAtlas font atlas to release, its TexID is reset
+    static void DestroyFontTexture(ImFontAtlas *fontAtlas);
+
     /// Get a text from clipboard
     /// \param user_data - not used here
     /// \return clipboard text
@@ -97,9 +299,16 @@ public:
     static void SetClipboardImGuiWrapper(void *user_data, const char *text);
 protected:
     /// Constructs a window with optional FontAtlas
-    /// \param fontAtlas shared ImFontAtlas
+    /// \param fontAtlas shared ImFontAtlas, nullptr to use the default font
+    /// shared by all windows
     explicit ImgWindow(ImFontAtlas *fontAtlas = nullptr);
 
+    /// Constructs a window using fonts from files. The atlas is shared with
+    /// all windows using the same fonts, see ImgFontRegistry.
+    /// \param fontFiles TrueType files merged into the atlas in order
+    /// \param fontSize font size in pixels
+    ImgWindow(const std::vector<std::string> &fontFiles, float fontSize);
+
     /// Initialise a window with the specified parameters. Call this function
     /// in derived class constructor.
     /// \param width width of the window
@@ -115,7 +324,23 @@ protected:
               XPLMWindowLayer layer = xplm_WindowLayerFloatingWindows,
               XPLMWindowPositioningMode mode = xplm_WindowPositionFree);
 
-    /// can be used to customise ImGui context for user needs
+    /// can be used to add the fonts of the window, called once before the
+    /// first context is created, with no context current. The fonts added
+    /// are built into an atlas of the window, kept through hibernation.
+    /// Without fonts the window uses the atlas shared through
+    /// ImgFontRegistry. Not called for windows constructed with a prebuilt
+    /// atlas.
+    /// \param fontAtlas empty atlas of the window
+    virtual void ConfigureFonts(ImFontAtlas *fontAtlas);
+
+    /// can be used to customise ImGui context for user needs, called with
+    /// the context current whenever it is created, on the first show and
+    /// after hibernation. io.Fonts is the prebuilt atlas or the one of
+    /// ConfigureFonts() if there is one, fonts must not be added to it
+    /// here: a window which does keeps its context and never hibernates.
+    /// Otherwise io.Fonts is an empty atlas of the context: fonts added to
+    /// it are built and uploaded for this context only, without fonts the
+    /// context uses the atlas shared through ImgFontRegistry.
     virtual void ConfigureImGuiContext();
 
     /// Override this method if you want to define your own ImGui window
@@ -146,7 +371,9 @@ protected:
     void SetWindowTitle(const std::string &title);
 
     /// Can be used within buildInterface() to get the object to self-delete
-    /// once it's finished rendering this frame.
+    /// once it's finished rendering this frame. Like all Safe* methods it
+    /// may be called from any thread, the operation is queued on
+    /// ImgDispatcher and runs on the sim thread.
     void SafeDelete();
 
     /// Can be used within buildInterface() to hide the window once it's
@@ -160,6 +387,17 @@ protected:
     /// \param anchor anchor point to resize
     void SafeResize(int width, int height, Anchor anchor = TopLeft);
 
+    /// Can be used within buildInterface() to change the title of the
+    /// window once it's finished rendering this frame.
+    /// \param title title to set
+    void SafeSetWindowTitle(const std::string &title);
+
+    /// Runs a function on the sim thread once the window has finished
+    /// rendering this frame. The function is dropped if the window is
+    /// deleted before.
+    /// \param command function to run
+    void SafeCall(std::function<void()> command);
+
     /// Set window resizing limits
     /// \param inMinWidthBoxels min windows width in boxels
     /// \param inMinHeightBoxels min windows height in boxels
@@ -208,7 +446,7 @@ protected:
 
     /// Is active when IngWindow is created with shared FontAtlas. User
     /// should load the fonts and build the texture before creating the
-    /// window. Otherwise ImgWindow will build default font.
+    /// window. Otherwise ImgWindow takes its atlas from ImgFontRegistry.
     bool mHasPrebuildFont;
 
     /// Can be checked during buildInterface() to see if we're being rendered
@@ -266,16 +504,105 @@ private:
             XPLMMouseStatus inMouse,
             int button = 0);
 
-    static float flightLoopHandler(
-            float                inElapsedSinceLastCall,
-            float                inElapsedTimeSinceLastFlightLoop,
-            int                  inCounter,
-            void *               inRefcon);
-
     void renderImGui();
 
+    // renders windows of the same frame with shared state setup
+    static void renderPass(const std::vector<ImgWindow *> &windows);
+
+    // returns true if the window is drawn with the matrices of the frame
+    bool canSharePass() const;
+
+    void selectRenderBackend();
+
+    static void beginRenderPass(RenderBackend backend);
+
+    static void endRenderPass(RenderBackend backend);
+
+    // renders the window, the state is set up by beginRenderPass()
+    void renderContent();
+
+    void updateMatrices();
+
+    void renderDrawLists(ImDrawData *draw_data, bool toTexture);
+
+    // computes the ImGui -> clip space matrix of the window
+    void imguiToClip(float outTransform[16]);
+
+    void buildDrawBatches(ImDrawData *draw_data, const float transform[16],
+                          const int viewport[4]);
+
+    // returns false if the shader backend can't be used
+    bool initShaderBackend();
+
+    void renderShader(ImDrawData *draw_data);
+
+    // binds the shared vertex array, returns false if it can't be used
+    bool bindVertexArray();
+
+    void setVertexAttributes(size_t offset);
+
+    // returns false if the render cache can't be used
+    bool updateRenderCache(ImDrawData *draw_data);
+
+    void drawRenderCache();
+
+    // uploads the draw data into streaming buffers and binds them, returns
+    // false if buffer objects can't be used
+    bool uploadDrawData(ImDrawData *draw_data);
+
+    void releaseRenderCache();
+
+    // the build of a frame is split so the ImGui part can run on a worker
+    // thread, the other steps call XPLM and run on the sim thread
+
+    // sets up the ImGui input of the frame, sim thread
+    void prepareImGui();
+
+    // runs the interface callbacks, any thread
     void updateImGui();
 
+    // hands the keyboard focus requested by ImGui to X-Plane, sim thread
+    void finishImGui();
+
+    // creates the ImGui context if the window has none, sim thread
+    void createContext();
+
+    // saves the settings of the context and releases it with the
+    // resources of the window depending on it, sim thread
+    void destroyContext();
+
+    // adds the icons to an atlas of the window, builds and uploads it
+    void buildFontAtlas(ImFontAtlas *fontAtlas);
+
+    // deletes an atlas built by buildFontAtlas() and its texture
+    void destroyFontAtlas(ImFontAtlas *fontAtlas);
+
+    // runs checkHibernation() after the delay unless it's scheduled
+    void scheduleHibernation(float delay);
+
+    // hibernates the window if it's been hidden long enough
+    void checkHibernation();
+
+    // starts a new sim cycle, pushes the draw time of the last one
+    void beginCycle(int cycle);
+
+    // shrinks draw lists and pools oversized for mTrimFrames, sim thread
+    void trimMemory();
+
+    // returns true if the interface must be built this frame, sim thread
+    bool beginBuild();
+
+    // builds and renders the ImGui frame into draw data, any thread
+    void buildImGui();
+
+    void updateGeometry();
+
+    // returns true if the interface must be rebuilt this frame
+    bool needsRebuild();
+
+    // returns true if a watched channel was written since the last call
+    bool pollChannels();
+
     void boxelsToNative(int x, int y, int &outX, int &outY);
 
     void translateImGuiToBoxel(float inX, float inY, int &outX, int &outY);
@@ -286,30 +613,103 @@ private:
     // If true, the window position is updated to match screen size
     bool checkScreenAndPlace();
 
-    bool mSelfDestruct, mSelfHide, mSelfResize, mSelfPositioning, mSelfPlace;
-
+    /// ImGui context, nullptr until the window is shown and while it
+    /// hibernates
     ImGuiContext *mImGuiContext;
+    /// Allocations of the contexts, released with the window
+    ImgArena *mArena;
+    /// Fonts of the context, an atlas of the plugin or registry fonts
+    ImFontAtlas *mFontAtlas = nullptr;
+    std::vector<std::string> mFontFiles;
+    float mFontSize = 13.0f;
+    /// Atlas acquired from ImgFontRegistry, released with the context
+    ImFontAtlas *mRegistryFontAtlas = nullptr;
+    /// Atlas of the fonts added by ConfigureImGuiContext(), released with
+    /// the context
+    ImFontAtlas *mContextFontAtlas = nullptr;
+    /// Atlas of the fonts added by ConfigureFonts(), released with the
+    /// window
+    ImFontAtlas *mWindowFontAtlas = nullptr;
+    bool mFontsConfigured = false;
+
+    /// Variables to support hibernation
+    float mHibernateTime = 0.0f;
+    float mLastTimeShown = 0.0f;
+    bool mHibernationScheduled = false;
+    /// Fonts were added to a kept atlas with the context, it isn't released
+    bool mKeepContext = false;
+    /// Style and ImGui ini settings of the released context
+    bool mHasSavedState = false;
+    ImGuiStyle mSavedStyle;
+    std::string mSavedSettings;
     XPLMWindowID mWindowID;
     bool mIsInVR;
-
-    /// Variables to hold the size of the window and coordinates which must be set after calling
-    /// SafeResize() and SafePlace()
-    int mResizeWidth, mResizeHeight, mX, mY;
-
-    /// Variable to hold resize and place anchor
-    Anchor mResizeAnchor, mPlaceAnchor;
-
-    /// Variables to provide safe positioning mode set
-    XPLMWindowPositioningMode tempPositioningMode;
-    int tempMonitorIndex;
+    bool mIsPoppedOut = false;
 
     float mLastTimeDrawn = 0;
 
+    /// Sim cycle of the last built frame
+    int mLastBuildCycle = -1;
+    /// Sim cycle the window was last submitted to the shared pass
+    int mLastDrawCycle = -1;
+    bool mParallelBuild = false;
+
+    /// Variables to support idle mode
+    bool mIdleMode = false;
+    float mMaxIdleTime = 0.0f;
+    int mRedrawFrames = 0;
+    bool mMouseWasInside = false;
+
+    /// Channels watched for new data and their serials at the last poll
+    struct WatchedChannel {
+        const ImgChannel *channel;
+        unsigned int serial;
+    };
+    std::vector<WatchedChannel> mWatchedChannels;
+
+    /// Counter of built frames, used to check the render cache is up to date
+    unsigned long mFrameSerial = 0;
+
+    /// Textures of ImgImageCache in the draw data of the last built frame
+    std::vector<ImTextureID> mImageTextures;
+    unsigned long mImageSerial = 0;
+
+    /// Variables to support render cache
+    bool mRenderCache = false;
+    unsigned int mCacheTexture = 0, mCacheFramebuffer = 0;
+    int mCacheTextureWidth = 0, mCacheTextureHeight = 0;
+    unsigned long mCacheSerial = 0;
+    unsigned long mCacheHits = 0, mCacheMisses = 0;
+
+    /// Frame time metrics, draw time is summed over the callbacks of a frame
+    ImgStats mStats;
+    float mDrawTime = 0.0f;
+    bool mDrawTimePending = false;
+    bool mGpuTiming = false;
+    ImgGpuTimer mGpuTimer;
+
+    /// Frames the draw lists and the arena pools have been oversized
+    int mTrimFrames = 300;
+    std::unordered_map<const ImDrawList *, int> mOversizedFrames;
+    int mPoolOversizedFrames = 0;
+
+    /// Draw calls of the last rendered frame
+    ImgDrawBatcher mDrawBatcher;
+    DrawStats mDrawStats = {0, 0, 0};
+
+    /// Selected and used rendering backends
+    RenderBackend mRenderBackend = FixedFunction;
+    RenderBackend mActiveRenderBackend = FixedFunction;
+
+    /// Variables to support drawing from streaming buffers
+    bool mVertexBuffers = false;
+    unsigned long mUploadSerial = 0;
+    unsigned long mUploadVtxGeneration = 0, mUploadIdxGeneration = 0;
+    size_t mUploadVtxOffset = 0, mUploadIdxOffset = 0;
+
     XPLMWindowLayer mPreferredLayer;
     XPLMWindowDecoration mDecoration;
     XPLMWindowPositioningMode mPreferredPositioningMode;
-
-    XPLMFlightLoopID flightLoopID;
 };
 
 #endif //IMGWINDOW_H
@@ -0,0 +1,78 @@
+/*
+ * imgworkerpool.cpp
+ *
+ * Worker threads building ImgWindow interfaces in parallel.
+ */
+
+#include "imgworkerpool.h"
+
+/// \file
+/// This file contains the definition of the ImgWorkerPool class
+
+ImgWorkerPool::ImgWorkerPool(int threads) {
+    for (int i = 0; i < threads; i++)
+        mThreads.emplace_back(&ImgWorkerPool::workerLoop, this);
+}
+
+ImgWorkerPool::~ImgWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (std::thread &thread : mThreads)
+        thread.join();
+}
+
+int ImgWorkerPool::GetThreadCount() const {
+    return static_cast<int>(mThreads.size());
+}
+
+void ImgWorkerPool::Run(int count, const std::function<void(int)> &task) {
+    if (count <= 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mNext.store(0, std::memory_order_relaxed);
+        mActiveWorkers = static_cast<int>(mThreads.size());
+        mBatch++;
+    }
+    mWake.notify_all();
+
+    runTasks();
+
+    // the workers may still run the last tasks they claimed
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mActiveWorkers == 0; });
+    mTask = nullptr;
+}
+
+void ImgWorkerPool::workerLoop() {
+    unsigned int batch = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this, batch] { return mStop || mBatch != batch; });
+            if (mStop)
+                return;
+            batch = mBatch;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mActiveWorkers == 0)
+            mDone.notify_one();
+    }
+}
+
+void ImgWorkerPool::runTasks() {
+    for (;;) {
+        int index = mNext.fetch_add(1, std::memory_order_relaxed);
+        if (index >= mCount)
+            return;
+        (*mTask)(index);
+    }
+}
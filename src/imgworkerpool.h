@@ -0,0 +1,69 @@
+/*
+ * imgworkerpool.h
+ *
+ * Worker threads building ImgWindow interfaces in parallel.
+ */
+
+#ifndef IMGWORKERPOOL_H
+#define IMGWORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// \file
+/// This file contains the declaration of the ImgWorkerPool class
+/// \brief ImgWorkerPool runs a batch of independent tasks on a few worker
+/// threads and the calling thread.
+///
+/// Run() hands out the task indices of a batch from a shared counter: every
+/// thread takes the next unclaimed task as soon as it is done with the last
+/// one, so a few heavy tasks don't leave the other threads idle. The calling
+/// thread works on the batch as well and returns once all tasks are done.
+/// Tasks must not throw.
+class ImgWorkerPool {
+public:
+    /// Starts the worker threads
+    /// \param threads number of worker threads besides the calling thread
+    explicit ImgWorkerPool(int threads);
+
+    /// Stops and joins the worker threads
+    ~ImgWorkerPool();
+
+    ImgWorkerPool(const ImgWorkerPool &) = delete;
+    ImgWorkerPool &operator=(const ImgWorkerPool &) = delete;
+
+    /// Returns the number of worker threads
+    /// \return worker threads
+    int GetThreadCount() const;
+
+    /// Runs task(0) ... task(count - 1) and waits for all of them
+    /// \param count number of tasks
+    /// \param task function called with the task index
+    void Run(int count, const std::function<void(int)> &task);
+
+private:
+    void workerLoop();
+
+    // claims and runs tasks of the current batch until none are left
+    void runTasks();
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    bool mStop = false;
+
+    /// Current batch, guarded by mMutex except for the claim counter
+    const std::function<void(int)> *mTask = nullptr;
+    int mCount = 0;
+    unsigned int mBatch = 0;
+    int mActiveWorkers = 0;
+    std::atomic<int> mNext{0};
+};
+
+#endif //IMGWORKERPOOL_H
@@ -0,0 +1,32 @@
+/*
+ * imgxconfig.h
+ *
+ * dear imgui configuration of imgx, included by imgui.h through
+ * IMGUI_USER_CONFIG.
+ */
+
+#ifndef IMGXCONFIG_H
+#define IMGXCONFIG_H
+
+/// \file
+/// The current ImGui context is thread-local, so worker threads can build
+/// the interfaces of several ImgWindows, each in its own context, at the
+/// same time. Code using imgx must be compiled with
+/// IMGUI_USER_CONFIG="imgxconfig.h" like imgx and imgui themselves.
+
+struct ImGuiContext;
+
+/// Current ImGui context of the calling thread
+extern thread_local ImGuiContext *gImgxImGuiContext;
+
+#define GImGui gImgxImGuiContext
+
+/// Logs a failed ImGui assertion, with a hint when no context is current,
+/// and aborts
+[[noreturn]] void ImgxAssertFailed(const char *expression, const char *file, int line);
+
+#if !defined(IM_ASSERT) && !defined(NDEBUG)
+#define IM_ASSERT(_EXPR) ((_EXPR) ? (void) 0 : ImgxAssertFailed(#_EXPR, __FILE__, __LINE__))
+#endif
+
+#endif //IMGXCONFIG_H
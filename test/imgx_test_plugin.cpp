@@ -13,48 +13,14 @@
 #include "XPLMPlugin.h"
 #include "XPLMUtilities.h"
 
+#include "imgstatswindow.h"
 #include "testwindow.h"
 
-#if LIN
-#include <GL/gl.h>
 #include <cstring>
-#elif IBM
-#include <gl/GL.h>
-#else
-#include <OpenGL/gl.h>
-#endif
-
 #include <memory>
 
 std::shared_ptr<TestWindow> window, window2;
-ImFontAtlas *fontAtlas = nullptr;
-
-static void setupImGuiFonts() {
-    // bind default font
-    unsigned char *pixels;
-    int width, height;
-
-    fontAtlas = new ImFontAtlas();
-    fontAtlas->GetTexDataAsAlpha8(&pixels, &width, &height);
-
-    // slightly stupid dance around the texture number due to XPLM not using GLint here.
-    int texNum = 0;
-    XPLMGenerateTextureNumbers(&texNum, 1);
-
-    // upload texture.
-    XPLMBindTexture2d(texNum, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA,
-                 GL_UNSIGNED_BYTE, pixels);
-    fontAtlas->TexID = (void *) (uintptr_t) texNum;
-}
-
-static void deleteImGuiFonts() {
-    auto t = (GLuint) (uintptr_t) fontAtlas->TexID;
-    glDeleteTextures(1, &t);
-}
+std::shared_ptr<ImgStatsWindow> statsWindow;
 
 PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
     XPLMDebugString("imgx_test: ver " VERSION_NUMBER  "\n");
@@ -64,17 +30,30 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
 
     XPLMEnableFeature("XPLM_USE_NATIVE_PATHS", 1);
 
-    setupImGuiFonts();
-    window = std::make_shared<TestWindow>(fontAtlas);
+    // frame metrics of the windows below as imgx_test/stats/window<N>/...
+    ImgStats::SetPublishPrefix("imgx_test/stats");
+
+    // both windows share the default font atlas
+    window = std::make_shared<TestWindow>();
+    window->SetVertexBuffers(true);
     window->SetVisible(true);
-    window2 = std::make_shared<TestWindow>(fontAtlas);
+    window2 = std::make_shared<TestWindow>();
+    // second window is rebuilt only on user activity or once a second
+    window2->SetIdleMode(true, 1.0f);
+    window2->SetRenderCache(true);
     window2->SetVisible(true);
+    statsWindow = std::make_shared<ImgStatsWindow>();
+    statsWindow->SetVisible(true);
 
     return 1;
 }
 
 PLUGIN_API void XPluginStop(void) {
-    deleteImGuiFonts();
+    // the last window frees the font texture, X-Plane's OpenGL context is
+    // still alive here
+    window.reset();
+    window2.reset();
+    statsWindow.reset();
 }
 
 PLUGIN_API void XPluginDisable(void) {
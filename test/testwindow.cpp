@@ -7,6 +7,8 @@
  */
 
 #include "testwindow.h"
+#include "imgframe.h"
+#include "imgglstate.h"
 
 TestWindow::TestWindow(ImFontAtlas *fontAtlas) : ImgWindow(fontAtlas) {
     Init(600, 200, 600, 600);
@@ -22,4 +24,28 @@ void TestWindow::BuildInterface() {
     ImGui::Text("Mouse position X-Plane: x = %i  y = %i", mouse_x, mouse_y);
     ImGui::Text("Mouse position ImGui: x = %f  y = %f", io.MousePos.x, io.MousePos.y);
     ImGui::Text("Is any items active or hovered: %i", ImGui::IsAnyItemHovered());
+    bool useShader = GetRenderBackend() == Shader;
+    if (ImGui::Checkbox("Shader backend", &useShader))
+        SetRenderBackend(useShader ? Shader : FixedFunction);
+    ImGui::SameLine();
+    ImGui::Text("(active: %s)",
+                GetActiveRenderBackend() == Shader ? "shader" : "fixed function");
+    bool gpuTiming = GetGpuTiming();
+    if (ImGui::Checkbox("GPU timing", &gpuTiming))
+        SetGpuTiming(gpuTiming);
+    bool sharedPass = ImgFrame::Get().GetSharedPass();
+    if (ImGui::Checkbox("Shared render pass", &sharedPass))
+        ImgFrame::Get().SetSharedPass(sharedPass);
+    auto drawStats = GetDrawStats();
+    ImGui::Text("Draw commands: %i  draw calls: %i  culled: %i",
+                drawStats.commands, drawStats.draws, drawStats.culled);
+    auto stateStats = ImgGLState::Get().GetStats();
+    ImGui::Text("GL state changes: issued = %lu  skipped = %lu",
+                stateStats.issued, stateStats.skipped);
+    if (GetRenderCache()) {
+        auto stats = GetRenderCacheStats();
+        ImGui::Text("Render cache: hits = %lu  misses = %lu  memory = %lu KB",
+                    stats.hits, stats.misses,
+                    static_cast<unsigned long>(stats.textureBytes / 1024));
+    }
 }